@@ -0,0 +1,157 @@
+// Compares the two ways a post listing envelope can be produced: building a
+// Json::Value tree and serialising it the way drogon's newHttpJsonResponse
+// does, against streaming it with utils::JsonWriter. Both outputs are parsed
+// back and compared before timing, so the numbers are for equal documents.
+//
+//   cmake -S . -B build -DBLOG_BUILD_BENCHMARKS=ON && cmake --build build --target json_writer_bench
+//   ./build/json_writer_bench [pageSize] [iterations]
+
+#include <json/json.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "controllers/ModelJson.h"
+#include "utils/JsonWriter.h"
+
+namespace {
+
+using blog::Post;
+
+std::vector<Post> makePosts(int count) {
+  std::vector<Post> posts;
+  posts.reserve(static_cast<size_t>(count));
+  for (int i = 0; i < count; ++i) {
+    Post post;
+    post.id = 1000 + i;
+    post.title = "Notes on \"streaming\" JSON, part " + std::to_string(i);
+    post.authorId = 7;
+    post.authorUsername = "writer_" + std::to_string(i % 5);
+    post.createdAt = "2024-05-01 12:00:00";
+    post.updatedAt = "2024-05-02 08:30:00";
+    for (int line = 0; line < 40; ++line) {
+      post.contentMarkdown += "Line " + std::to_string(line) + " of a markdown body with `code`, \\paths\\ and\ttabs.\n";
+    }
+    posts.push_back(std::move(post));
+  }
+  return posts;
+}
+
+Json::Value postToJson(const Post& post) {
+  Json::Value item(Json::objectValue);
+  item["id"] = Json::Int64(post.id);
+  item["title"] = post.title;
+  item["contentMarkdown"] = post.contentMarkdown;
+  item["authorId"] = Json::Int64(post.authorId);
+  item["authorUsername"] = post.authorUsername;
+  item["createdAt"] = post.createdAt;
+  item["updatedAt"] = post.updatedAt;
+  item["isDeleted"] = post.isDeleted;
+  return item;
+}
+
+std::string buildWithTree(const std::vector<Post>& posts, const std::string& requestId) {
+  Json::Value items(Json::arrayValue);
+  for (const auto& post : posts) {
+    items.append(postToJson(post));
+  }
+  Json::Value data(Json::objectValue);
+  data["items"] = items;
+  data["page"] = 1;
+  data["pageSize"] = static_cast<int>(posts.size());
+  data["total"] = 1000;
+
+  Json::Value body(Json::objectValue);
+  body["code"] = "OK";
+  body["message"] = "success";
+  body["data"] = data;
+  body["requestId"] = requestId;
+
+  static const std::unique_ptr<Json::StreamWriter> writer = [] {
+    Json::StreamWriterBuilder builder;
+    builder["commentStyle"] = "None";
+    builder["indentation"] = "";
+    builder["emitUTF8"] = true;
+    return std::unique_ptr<Json::StreamWriter>(builder.newStreamWriter());
+  }();
+  std::ostringstream out;
+  writer->write(body, &out);
+  return out.str();
+}
+
+std::string buildWithWriter(const std::vector<Post>& posts, const std::string& requestId) {
+  blog::utils::JsonWriter writer(4096);
+  writer.beginObject();
+  writer.field("code", "OK");
+  writer.field("message", "success");
+  writer.key("data").beginObject();
+  writer.key("items").beginArray();
+  size_t estimate = 0;
+  for (const auto& post : posts) {
+    estimate += blog::estimatePostJsonBytes(post);
+  }
+  writer.reserveMore(estimate);
+  for (const auto& post : posts) {
+    blog::writePost(writer, post);
+  }
+  writer.endArray();
+  writer.field("page", 1);
+  writer.field("pageSize", static_cast<int>(posts.size()));
+  writer.field("total", 1000);
+  writer.endObject();
+  writer.field("requestId", requestId);
+  writer.endObject();
+  return writer.release();
+}
+
+Json::Value parse(const std::string& text) {
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::Value value;
+  std::string errors;
+  if (!reader->parse(text.data(), text.data() + text.size(), &value, &errors)) {
+    std::fprintf(stderr, "parse failed: %s\n", errors.c_str());
+    std::exit(1);
+  }
+  return value;
+}
+
+template <typename Build>
+double microsPerResponse(Build build, int iterations, size_t& bytes) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    bytes += build().size();
+  }
+  const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int pageSize = argc > 1 ? std::atoi(argv[1]) : 50;
+  const int iterations = argc > 2 ? std::atoi(argv[2]) : 2000;
+  const std::vector<Post> posts = makePosts(pageSize);
+  const std::string requestId = "3f0b2c4e-1a2b-4c3d-9e8f-0a1b2c3d4e5f";
+
+  const std::string tree = buildWithTree(posts, requestId);
+  const std::string streamed = buildWithWriter(posts, requestId);
+  if (parse(tree) != parse(streamed)) {
+    std::fprintf(stderr, "outputs differ\n");
+    return 1;
+  }
+
+  size_t sink = 0;
+  const double treeMicros = microsPerResponse([&] { return buildWithTree(posts, requestId); }, iterations, sink);
+  const double writerMicros = microsPerResponse([&] { return buildWithWriter(posts, requestId); }, iterations, sink);
+
+  std::printf("%d posts, %zu bytes per response, %d iterations\n", pageSize, streamed.size(), iterations);
+  std::printf("Json::Value + StreamWriter: %8.1f us/response\n", treeMicros);
+  std::printf("JsonWriter:                 %8.1f us/response (%.1fx)\n", writerMicros, treeMicros / writerMicros);
+  return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,4 @@
+-- Access tokens carry the user's token_version; bumping it revokes every
+-- outstanding access token for that user without a per-request lookup.
+
+ALTER TABLE users ADD COLUMN token_version INTEGER NOT NULL DEFAULT 0;
@@ -0,0 +1,18 @@
+-- Per-post interaction counters, maintained by InteractionRepository in the
+-- same transaction as the like/favorite/comment write that changes them.
+
+CREATE TABLE IF NOT EXISTS post_stats (
+  post_id INTEGER PRIMARY KEY,
+  like_count INTEGER NOT NULL DEFAULT 0,
+  favorite_count INTEGER NOT NULL DEFAULT 0,
+  comment_count INTEGER NOT NULL DEFAULT 0,
+  FOREIGN KEY (post_id) REFERENCES posts(id)
+);
+
+INSERT OR REPLACE INTO post_stats(post_id, like_count, favorite_count, comment_count)
+SELECT
+  p.id,
+  (SELECT COUNT(1) FROM post_likes l WHERE l.post_id = p.id),
+  (SELECT COUNT(1) FROM post_favorites f WHERE f.post_id = p.id),
+  (SELECT COUNT(1) FROM comments c WHERE c.post_id = p.id AND c.is_deleted = 0)
+FROM posts p;
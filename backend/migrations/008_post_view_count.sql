@@ -0,0 +1,4 @@
+-- Post view counts. Views are counted in memory by PostViewCounter and added
+-- here in batches, so this column lags reads by up to one flush interval.
+
+ALTER TABLE post_stats ADD COLUMN view_count INTEGER NOT NULL DEFAULT 0;
@@ -0,0 +1,10 @@
+-- Snapshot of TrendingTracker's decayed scores, rewritten periodically and on
+-- shutdown so a restart does not begin with an empty ranking. `score` is the
+-- value at `snapshot_at_ms`; readers decay it forward to their own clock.
+
+CREATE TABLE IF NOT EXISTS trending_scores (
+  post_id INTEGER PRIMARY KEY,
+  score REAL NOT NULL,
+  snapshot_at_ms INTEGER NOT NULL,
+  FOREIGN KEY (post_id) REFERENCES posts(id)
+);
@@ -0,0 +1,8 @@
+-- Keyset pagination for comments: newest first, ties broken by id, live rows
+-- only. Replaces idx_comments_post, whose order had no tiebreaker.
+
+DROP INDEX IF EXISTS idx_comments_post;
+
+CREATE INDEX IF NOT EXISTS idx_comments_post_keyset
+ON comments(post_id, created_at DESC, id DESC)
+WHERE is_deleted = 0;
@@ -0,0 +1,14 @@
+-- Threaded replies. path is the chain of ancestor ids ending with the
+-- comment's own id, each zero-padded to 10 digits and followed by '/', so a
+-- thread sorts depth-first (siblings oldest first) by path and a subtree is
+-- the range [path, path || '~'). reply_count is the number of live
+-- descendants, maintained on every insert and soft delete below it.
+
+ALTER TABLE comments ADD COLUMN parent_id INTEGER REFERENCES comments(id);
+ALTER TABLE comments ADD COLUMN depth INTEGER NOT NULL DEFAULT 0;
+ALTER TABLE comments ADD COLUMN path TEXT NOT NULL DEFAULT '';
+ALTER TABLE comments ADD COLUMN reply_count INTEGER NOT NULL DEFAULT 0;
+
+UPDATE comments SET path = printf('%010d/', id) WHERE path = '';
+
+CREATE INDEX IF NOT EXISTS idx_comments_post_path ON comments(post_id, path);
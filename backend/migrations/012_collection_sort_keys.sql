@@ -0,0 +1,26 @@
+-- Gapped ordering keys for collection members. sort_key only orders rows
+-- within a collection: appends take MAX(sort_key) + 2^20, a move takes the
+-- midpoint between its new neighbours, and a removal deletes one row. The
+-- repository renumbers a collection when two neighbours run out of room.
+-- The public 1-based position is the row's rank among live posts, computed
+-- on read. SQLite cannot drop the old UNIQUE(collection_id, position)
+-- constraint in place, so the table is rebuilt.
+
+CREATE TABLE collection_posts_sorted (
+  collection_id INTEGER NOT NULL,
+  post_id INTEGER NOT NULL,
+  sort_key INTEGER NOT NULL,
+  created_at TEXT NOT NULL DEFAULT (strftime('%Y-%m-%dT%H:%M:%SZ','now')),
+  PRIMARY KEY (collection_id, post_id),
+  FOREIGN KEY (collection_id) REFERENCES collections(id),
+  FOREIGN KEY (post_id) REFERENCES posts(id)
+);
+
+INSERT INTO collection_posts_sorted(collection_id, post_id, sort_key, created_at)
+SELECT collection_id, post_id, position * 1048576, created_at FROM collection_posts;
+
+DROP TABLE collection_posts;
+ALTER TABLE collection_posts_sorted RENAME TO collection_posts;
+
+CREATE INDEX IF NOT EXISTS idx_collection_posts_order ON collection_posts(collection_id, sort_key, post_id);
+CREATE INDEX IF NOT EXISTS idx_collection_posts_post ON collection_posts(post_id);
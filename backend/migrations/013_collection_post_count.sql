@@ -0,0 +1,20 @@
+-- Number of live posts in each collection, read directly by collection
+-- listings. CollectionRepository adjusts it in the same transaction as each
+-- add or remove; the trigger below follows posts being soft-deleted (or
+-- restored) while they are members.
+
+ALTER TABLE collections ADD COLUMN post_count INTEGER NOT NULL DEFAULT 0;
+
+UPDATE collections SET post_count = (
+  SELECT COUNT(1) FROM collection_posts cp
+  JOIN posts p ON p.id = cp.post_id
+  WHERE cp.collection_id = collections.id AND p.is_deleted = 0
+);
+
+CREATE TRIGGER IF NOT EXISTS posts_collection_count_au AFTER UPDATE OF is_deleted ON posts
+WHEN old.is_deleted <> new.is_deleted
+BEGIN
+  UPDATE collections
+  SET post_count = post_count + CASE WHEN new.is_deleted = 0 THEN 1 ELSE -1 END
+  WHERE id IN (SELECT collection_id FROM collection_posts WHERE post_id = new.id);
+END;
@@ -25,6 +25,14 @@ int getenvIntOrDefault(const char* key, int defaultValue) {
   }
 }
 
+bool getenvBoolOrDefault(const char* key, bool defaultValue) {
+  const std::string value = getenvOrDefault(key, "");
+  if (value.empty()) {
+    return defaultValue;
+  }
+  return value == "1" || value == "true" || value == "TRUE" || value == "yes";
+}
+
 }  // namespace
 
 bool AppConfig::isProduction() const {
@@ -48,6 +56,55 @@ AppConfig AppConfig::fromEnv() {
   cfg.adminSeedUsername = getenvOrDefault("ADMIN_SEED_USERNAME", "admin");
   cfg.adminSeedPassword = getenvOrDefault("ADMIN_SEED_PASSWORD", "ChangeMe123!");
   cfg.logLevel = getenvOrDefault("LOG_LEVEL", "INFO");
+  cfg.rateLimitEnabled = getenvBoolOrDefault("RATE_LIMIT_ENABLED", true);
+  cfg.trustProxyHeaders = getenvBoolOrDefault("TRUST_PROXY_HEADERS", false);
+  cfg.rateLimitWindowSeconds = getenvIntOrDefault("RATE_LIMIT_WINDOW_SECONDS", 60);
+  cfg.rateLimitLoginPerIp = getenvIntOrDefault("RATE_LIMIT_LOGIN_PER_IP", 30);
+  cfg.rateLimitLoginPerUsername = getenvIntOrDefault("RATE_LIMIT_LOGIN_PER_USERNAME", 10);
+  cfg.rateLimitRegisterPerIp = getenvIntOrDefault("RATE_LIMIT_REGISTER_PER_IP", 10);
+  cfg.argon2Calibrate = getenvBoolOrDefault("ARGON2_CALIBRATE", false);
+  cfg.argon2TargetMillis = getenvIntOrDefault("ARGON2_TARGET_MS", 50);
+  cfg.argon2TimeCost = getenvIntOrDefault("ARGON2_T_COST", 2);
+  cfg.argon2MemoryKiB = getenvIntOrDefault("ARGON2_MEMORY_KIB", 1 << 16);
+  cfg.argon2Parallelism = getenvIntOrDefault("ARGON2_PARALLELISM", 1);
+  cfg.interactionWriteMode = getenvOrDefault("INTERACTION_WRITE_MODE", "sync");
+  cfg.interactionFlushIntervalMs = getenvIntOrDefault("INTERACTION_FLUSH_INTERVAL_MS", 200);
+  cfg.interactionFlushMaxPending = getenvIntOrDefault("INTERACTION_FLUSH_MAX_PENDING", 256);
+  cfg.interactionMembershipCacheUsers = getenvIntOrDefault("INTERACTION_MEMBERSHIP_CACHE_USERS", 10000);
+  cfg.viewCountFlushIntervalSeconds = getenvIntOrDefault("VIEW_COUNT_FLUSH_INTERVAL_SECONDS", 5);
+  cfg.trendingHalfLifeMinutes = getenvIntOrDefault("TRENDING_HALF_LIFE_MINUTES", 720);
+  cfg.trendingMaxTracked = getenvIntOrDefault("TRENDING_MAX_TRACKED", 10000);
+  cfg.trendingSnapshotIntervalSeconds = getenvIntOrDefault("TRENDING_SNAPSHOT_INTERVAL_SECONDS", 60);
+  cfg.commentPageCachePosts = getenvIntOrDefault("COMMENT_PAGE_CACHE_POSTS", 1024);
+  cfg.collectionOrderCacheCollections = getenvIntOrDefault("COLLECTION_ORDER_CACHE_COLLECTIONS", 1024);
+  cfg.liveUpdateIntervalMs = getenvIntOrDefault("LIVE_UPDATE_INTERVAL_MS", 250);
+  cfg.liveUpdateMaxSubscriptions = getenvIntOrDefault("LIVE_UPDATE_MAX_SUBSCRIPTIONS", 200);
+  cfg.postStreamBufferEvents = getenvIntOrDefault("POST_STREAM_BUFFER_EVENTS", 32);
+  cfg.postStreamHeartbeatSeconds = getenvIntOrDefault("POST_STREAM_HEARTBEAT_SECONDS", 15);
+  cfg.postStreamMaxClients = getenvIntOrDefault("POST_STREAM_MAX_CLIENTS", 1000);
+  cfg.ioThreads = getenvIntOrDefault("IO_THREADS", 0);
+  cfg.listenReusePort = getenvBoolOrDefault("LISTEN_REUSE_PORT", true);
+  cfg.ioCpuAffinity = getenvOrDefault("IO_CPU_AFFINITY", "");
+  cfg.backgroundCpuAffinity = getenvOrDefault("BACKGROUND_CPU_AFFINITY", "");
+  cfg.metricsPort = getenvIntOrDefault("METRICS_PORT", 0);
+  cfg.metricsBindAddress = getenvOrDefault("METRICS_BIND_ADDRESS", "127.0.0.1");
+  cfg.accessLogEnabled = getenvBoolOrDefault("ACCESS_LOG_ENABLED", true);
+  cfg.accessLogPath = getenvOrDefault("ACCESS_LOG_PATH", "");
+  cfg.accessLogSample2xxPercent = getenvIntOrDefault("ACCESS_LOG_SAMPLE_2XX_PERCENT", 100);
+  cfg.accessLogSlowMs = getenvIntOrDefault("ACCESS_LOG_SLOW_MS", 500);
+  cfg.accessLogBufferRecords = getenvIntOrDefault("ACCESS_LOG_BUFFER_RECORDS", 8192);
+  cfg.accessLogFlushIntervalMs = getenvIntOrDefault("ACCESS_LOG_FLUSH_INTERVAL_MS", 200);
+  cfg.accessLogMaxMegabytes = getenvIntOrDefault("ACCESS_LOG_MAX_MB", 100);
+  cfg.accessLogMaxFiles = getenvIntOrDefault("ACCESS_LOG_MAX_FILES", 5);
+  cfg.traceEnabled = getenvBoolOrDefault("TRACE_ENABLED", false);
+  cfg.traceServerTiming = getenvBoolOrDefault("TRACE_SERVER_TIMING", true);
+  cfg.traceExportPath = getenvOrDefault("TRACE_EXPORT_PATH", "");
+  cfg.traceExportSamplePercent = getenvIntOrDefault("TRACE_EXPORT_SAMPLE_PERCENT", 10);
+  cfg.traceExportMaxMegabytes = getenvIntOrDefault("TRACE_EXPORT_MAX_MB", 100);
+  cfg.traceExportMaxFiles = getenvIntOrDefault("TRACE_EXPORT_MAX_FILES", 5);
+  cfg.admissionControlEnabled = getenvBoolOrDefault("ADMISSION_CONTROL_ENABLED", false);
+  cfg.admissionExpensiveLoopPercent = getenvIntOrDefault("ADMISSION_EXPENSIVE_LOOP_PERCENT", 50);
+  cfg.admissionTargetDelayMs = getenvIntOrDefault("ADMISSION_TARGET_DELAY_MS", 20);
   return cfg;
 }
 
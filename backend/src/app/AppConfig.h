@@ -16,6 +16,55 @@ struct AppConfig {
   std::string adminSeedUsername;
   std::string adminSeedPassword;
   std::string logLevel;
+  bool rateLimitEnabled;
+  bool trustProxyHeaders;
+  int rateLimitWindowSeconds;
+  int rateLimitLoginPerIp;
+  int rateLimitLoginPerUsername;
+  int rateLimitRegisterPerIp;
+  bool argon2Calibrate;
+  int argon2TargetMillis;
+  int argon2TimeCost;
+  int argon2MemoryKiB;
+  int argon2Parallelism;
+  std::string interactionWriteMode;
+  int interactionFlushIntervalMs;
+  int interactionFlushMaxPending;
+  int interactionMembershipCacheUsers;
+  int viewCountFlushIntervalSeconds;
+  int trendingHalfLifeMinutes;
+  int trendingMaxTracked;
+  int trendingSnapshotIntervalSeconds;
+  int commentPageCachePosts;
+  int collectionOrderCacheCollections;
+  int liveUpdateIntervalMs;
+  int liveUpdateMaxSubscriptions;
+  int postStreamBufferEvents;
+  int postStreamHeartbeatSeconds;
+  int postStreamMaxClients;
+  int ioThreads;
+  bool listenReusePort;
+  std::string ioCpuAffinity;
+  std::string backgroundCpuAffinity;
+  int metricsPort;
+  std::string metricsBindAddress;
+  bool accessLogEnabled;
+  std::string accessLogPath;
+  int accessLogSample2xxPercent;
+  int accessLogSlowMs;
+  int accessLogBufferRecords;
+  int accessLogFlushIntervalMs;
+  int accessLogMaxMegabytes;
+  int accessLogMaxFiles;
+  bool traceEnabled;
+  bool traceServerTiming;
+  std::string traceExportPath;
+  int traceExportSamplePercent;
+  int traceExportMaxMegabytes;
+  int traceExportMaxFiles;
+  bool admissionControlEnabled;
+  int admissionExpensiveLoopPercent;
+  int admissionTargetDelayMs;
 
   bool isProduction() const;
   bool refreshCookieSecure() const;
@@ -0,0 +1,188 @@
+#include "app/ServerTopology.h"
+
+#include <drogon/drogon.h>
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace blog {
+namespace {
+
+std::string formatCpus(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return "any";
+  }
+  std::ostringstream out;
+  for (size_t i = 0; i < cpus.size(); ++i) {
+    if (i > 0) {
+      out << ',';
+    }
+    out << cpus[i];
+  }
+  return out.str();
+}
+
+#ifdef __linux__
+// Affinity of the process at startup, before pinBackgroundThreads() narrows
+// the main thread's; IO loops without an IO set go back to it.
+cpu_set_t& startupMask() {
+  static cpu_set_t mask = [] {
+    cpu_set_t initial;
+    CPU_ZERO(&initial);
+    pthread_getaffinity_np(pthread_self(), sizeof(initial), &initial);
+    return initial;
+  }();
+  return mask;
+}
+
+bool setCurrentThreadMask(const cpu_set_t& mask, std::string& error) {
+  const int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+  if (rc != 0) {
+    error = "pthread_setaffinity_np failed with error " + std::to_string(rc);
+    return false;
+  }
+  return true;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus, std::string& error) {
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (const int cpu : cpus) {
+    CPU_SET(cpu, &mask);
+  }
+  return setCurrentThreadMask(mask, error);
+}
+#endif
+
+}  // namespace
+
+bool parseCpuList(const std::string& spec, std::vector<int>& cpus, std::string& error) {
+  cpus.clear();
+  std::istringstream in(spec);
+  std::string part;
+  while (std::getline(in, part, ',')) {
+    part.erase(std::remove(part.begin(), part.end(), ' '), part.end());
+    if (part.empty()) {
+      continue;
+    }
+    int first = 0;
+    int last = 0;
+    try {
+      const size_t dash = part.find('-');
+      size_t used = 0;
+      first = std::stoi(part.substr(0, dash), &used);
+      if (used != (dash == std::string::npos ? part.size() : dash)) {
+        throw std::invalid_argument(part);
+      }
+      last = first;
+      if (dash != std::string::npos) {
+        const std::string tail = part.substr(dash + 1);
+        last = std::stoi(tail, &used);
+        if (used != tail.size()) {
+          throw std::invalid_argument(part);
+        }
+      }
+    } catch (...) {
+      error = "invalid cpu list entry '" + part + "'";
+      return false;
+    }
+    if (first < 0 || last < first || last >= 1024) {
+      error = "invalid cpu range '" + part + "'";
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end()) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return true;
+}
+
+bool ServerTopology::fromConfig(const AppConfig& config, ServerTopology& out, std::string& error) {
+  out = ServerTopology{};
+  out.hardwareThreads = std::thread::hardware_concurrency();
+  if (config.ioThreads > 0) {
+    out.ioThreads = static_cast<size_t>(config.ioThreads);
+  } else {
+    out.ioThreads = std::max<size_t>(1, out.hardwareThreads);
+  }
+  out.reusePort = config.listenReusePort;
+
+  if (!parseCpuList(config.ioCpuAffinity, out.ioCpus, error)) {
+    error = "IO_CPU_AFFINITY: " + error;
+    return false;
+  }
+  if (!parseCpuList(config.backgroundCpuAffinity, out.backgroundCpus, error)) {
+    error = "BACKGROUND_CPU_AFFINITY: " + error;
+    return false;
+  }
+#ifndef __linux__
+  if (!out.ioCpus.empty() || !out.backgroundCpus.empty()) {
+    error = "CPU affinity is only supported on Linux";
+    return false;
+  }
+#endif
+  return true;
+}
+
+void ServerTopology::applyToApp(const std::string& host, uint16_t port) const {
+  drogon::app().setThreadNum(ioThreads);
+  drogon::app().enableReusePort(reusePort);
+  drogon::app().addListener(host, port);
+}
+
+void ServerTopology::pinBackgroundThreads() const {
+#ifdef __linux__
+  startupMask();
+  if (backgroundCpus.empty()) {
+    return;
+  }
+  std::string error;
+  if (!pinCurrentThread(backgroundCpus, error)) {
+    LOG_WARN << "failed to pin background threads to cpus " << formatCpus(backgroundCpus) << ": " << error;
+  }
+#endif
+}
+
+void ServerTopology::pinIoLoops() const {
+#ifdef __linux__
+  if (ioCpus.empty() && backgroundCpus.empty()) {
+    return;
+  }
+  const size_t loops = drogon::app().getThreadNum();
+  for (size_t i = 0; i < loops; ++i) {
+    const std::vector<int> cpus = ioCpus.empty() ? std::vector<int>{} : std::vector<int>{ioCpus[i % ioCpus.size()]};
+    drogon::app().getIOLoop(i)->queueInLoop([i, cpus]() {
+      std::string error;
+      // IO threads inherit the background mask from the main thread; without
+      // an IO set they get the startup mask back.
+      const bool ok = cpus.empty() ? setCurrentThreadMask(startupMask(), error) : pinCurrentThread(cpus, error);
+      if (!ok) {
+        LOG_WARN << "io loop " << i << ": failed to set cpu affinity: " << error;
+      } else if (!cpus.empty()) {
+        LOG_DEBUG << "io loop " << i << " pinned to cpu " << cpus.front();
+      }
+    });
+  }
+#endif
+}
+
+std::string ServerTopology::describe() const {
+  std::ostringstream out;
+  out << "io_threads=" << ioThreads << " hardware_threads=" << hardwareThreads
+      << " reuse_port=" << (reusePort ? "on" : "off")
+      << " accept_sockets=" << (reusePort ? ioThreads : 1) << " io_cpus=" << formatCpus(ioCpus)
+      << " background_cpus=" << formatCpus(backgroundCpus);
+  return out.str();
+}
+
+}  // namespace blog
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "app/AppConfig.h"
+
+namespace blog {
+
+// How the HTTP server maps onto the host: IO loop count, which CPUs the IO
+// loops and the background threads (main loop timers, interaction flusher)
+// may run on, and whether every IO loop accepts on its own SO_REUSEPORT
+// socket so the kernel spreads new connections across them.
+struct ServerTopology {
+  size_t ioThreads = 1;
+  size_t hardwareThreads = 0;
+  bool reusePort = false;
+  // Empty means "leave the inherited mask alone". IO loop i runs on
+  // ioCpus[i % ioCpus.size()].
+  std::vector<int> ioCpus;
+  std::vector<int> backgroundCpus;
+
+  static bool fromConfig(const AppConfig& config, ServerTopology& out, std::string& error);
+
+  // Configures drogon's IO threads, listener and reuse-port mode. Call once
+  // before app().run().
+  void applyToApp(const std::string& host, uint16_t port) const;
+
+  // Pins the calling (main) thread to backgroundCpus, so threads it starts
+  // afterwards inherit that mask; IO loops re-pin themselves in pinIoLoops().
+  // Must run before app().run() and before background threads start.
+  void pinBackgroundThreads() const;
+
+  // Queues the per-loop pinning on every IO loop. Call from a beginning
+  // advice, once the loops exist.
+  void pinIoLoops() const;
+
+  std::string describe() const;
+};
+
+// Parses "0-3,8,10-11" into {0,1,2,3,8,10,11}. An empty spec is an empty
+// list.
+bool parseCpuList(const std::string& spec, std::vector<int>& cpus, std::string& error);
+
+}  // namespace blog
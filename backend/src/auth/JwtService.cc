@@ -123,8 +123,10 @@ int64_t nowEpochSeconds() {
 
 }  // namespace
 
-JwtService::JwtService(const AppConfig& config)
-    : secret_(config.jwtSecret), accessExpireMinutes_(config.jwtAccessExpireMinutes) {}
+JwtService::JwtService(const AppConfig& config, const TokenVersionStore& tokenVersions)
+    : secret_(config.jwtSecret),
+      accessExpireMinutes_(config.jwtAccessExpireMinutes),
+      tokenVersions_(tokenVersions) {}
 
 std::string JwtService::generateAccessToken(const TokenPayload& payload) const {
   Json::Value header(Json::objectValue);
@@ -138,6 +140,7 @@ std::string JwtService::generateAccessToken(const TokenPayload& payload) const {
   body["sub"] = Json::Int64(payload.userId);
   body["username"] = payload.username;
   body["role"] = payload.role;
+  body["ver"] = Json::Int64(tokenVersions_.current(payload.userId));
   body["iat"] = Json::Int64(now);
   body["exp"] = Json::Int64(exp);
 
@@ -216,7 +219,29 @@ bool JwtService::verifyAccessToken(const std::string& token,
     return false;
   }
 
+  // Tokens minted before versioning carry no "ver" and count as version 0.
+  const Json::Value& version = body["ver"];
+  if (!version.isNull() && !version.isInt64()) {
+    errorCode = "AUTH_INVALID_TOKEN";
+    errorMessage = "token payload missing required fields";
+    return false;
+  }
+
   payload.userId = body["sub"].asInt64();
+  payload.tokenVersion = version.isNull() ? 0 : version.asInt64();
+  if (payload.tokenVersion != tokenVersions_.current(payload.userId)) {
+    // Banning revokes every token, so this is the only path a banned user's
+    // token can take.
+    if (tokenVersions_.banned(payload.userId)) {
+      errorCode = "USER_BANNED";
+      errorMessage = "user is banned";
+      return false;
+    }
+    errorCode = "AUTH_INVALID_TOKEN";
+    errorMessage = "token revoked";
+    return false;
+  }
+
   payload.username = body["username"].asString();
   payload.role = body["role"].asString();
   return true;
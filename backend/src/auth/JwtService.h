@@ -4,6 +4,7 @@
 #include <string>
 
 #include "app/AppConfig.h"
+#include "auth/TokenVersionStore.h"
 
 namespace blog {
 
@@ -11,13 +12,18 @@ struct TokenPayload {
   int64_t userId = 0;
   std::string username;
   std::string role;
+  int64_t tokenVersion = 0;
 };
 
 class JwtService {
  public:
-  explicit JwtService(const AppConfig& config);
+  JwtService(const AppConfig& config, const TokenVersionStore& tokenVersions);
 
+  // Stamps the user's current token version, so tokens issued after a
+  // revocation stay valid while older ones are rejected.
   std::string generateAccessToken(const TokenPayload& payload) const;
+  // errorCode is USER_BANNED when a revoked token belongs to a banned user,
+  // AUTH_INVALID_TOKEN otherwise.
   bool verifyAccessToken(const std::string& token,
                          TokenPayload& payload,
                          std::string& errorCode,
@@ -26,6 +32,7 @@ class JwtService {
  private:
   std::string secret_;
   int accessExpireMinutes_;
+  const TokenVersionStore& tokenVersions_;
 };
 
 }  // namespace blog
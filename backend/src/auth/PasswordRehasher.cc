@@ -0,0 +1,61 @@
+#include "auth/PasswordRehasher.h"
+
+#include <openssl/crypto.h>
+#include <trantor/utils/Logger.h>
+
+#include <memory>
+
+namespace blog {
+
+PasswordRehasher::PasswordRehasher(const PasswordService& passwordService, const UserRepository& userRepository)
+    : passwordService_(passwordService), userRepository_(userRepository), queue_(1, "argon2-rehash") {}
+
+void PasswordRehasher::scheduleIfOutdated(int64_t userId,
+                                          const std::string& password,
+                                          const std::string& currentHash) {
+  if (!passwordService_.needsRehash(currentHash)) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() >= kMaxPending || !pending_.insert(userId).second) {
+      return;
+    }
+  }
+
+  // The task is copied on its way into the queue, so every copy shares one
+  // buffer that is wiped when the last of them goes.
+  const std::shared_ptr<std::string> secret(new std::string(password), [](std::string* value) {
+    OPENSSL_cleanse(value->data(), value->size());
+    delete value;
+  });
+  queue_.runTaskInQueue([this, userId, secret, currentHash]() { rehash(userId, *secret, currentHash); });
+}
+
+size_t PasswordRehasher::pendingCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.size();
+}
+
+void PasswordRehasher::rehash(int64_t userId, const std::string& password, const std::string& currentHash) {
+  std::string hashError;
+  const std::string newHash = passwordService_.hashPassword(password, hashError);
+
+  if (newHash.empty()) {
+    LOG_WARN << "password rehash failed: user_id=" << userId << " error=" << hashError;
+  } else {
+    bool replaced = false;
+    std::string dbError;
+    if (!userRepository_.replacePasswordHash(userId, currentHash, newHash, replaced, dbError)) {
+      LOG_WARN << "password rehash not stored: user_id=" << userId << " error=" << dbError;
+    } else if (replaced) {
+      LOG_INFO << "password hash upgraded: user_id=" << userId;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.erase(userId);
+}
+
+}  // namespace blog
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <trantor/utils/ConcurrentTaskQueue.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "auth/PasswordService.h"
+#include "repositories/UserRepository.h"
+
+namespace blog {
+
+// Upgrades password hashes encoded with outdated Argon2 parameters after a
+// successful login, off the request thread. Work is deduplicated per user and
+// bounded; a dropped or lost job just means the next login tries again.
+//
+// The job's copy of the password is wiped when the job is destroyed. The
+// request's own copies (body, parsed JSON) are not this class's to wipe.
+class PasswordRehasher {
+ public:
+  PasswordRehasher(const PasswordService& passwordService, const UserRepository& userRepository);
+
+  void scheduleIfOutdated(int64_t userId, const std::string& password, const std::string& currentHash);
+  // Rehash jobs queued or running.
+  size_t pendingCount();
+
+ private:
+  void rehash(int64_t userId, const std::string& password, const std::string& currentHash);
+
+  static constexpr size_t kMaxPending = 32;
+
+  const PasswordService& passwordService_;
+  const UserRepository& userRepository_;
+  std::mutex mutex_;
+  std::unordered_set<int64_t> pending_;
+  trantor::ConcurrentTaskQueue queue_;
+};
+
+}  // namespace blog
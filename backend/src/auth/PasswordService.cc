@@ -3,35 +3,72 @@
 #include <argon2.h>
 #include <openssl/rand.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <vector>
 
+#include "tracing/RequestTrace.h"
+
 namespace blog {
+namespace {
 
-std::string PasswordService::hashPassword(const std::string& password, std::string& error) const {
-  constexpr uint32_t tCost = 2;
-  constexpr uint32_t mCost = 1 << 16;
-  constexpr uint32_t parallelism = 1;
-  constexpr size_t hashLen = 32;
-  constexpr size_t saltLen = 16;
+constexpr size_t kHashLen = 32;
+constexpr size_t kSaltLen = 16;
+constexpr uint32_t kMinMemoryKiB = 1 << 13;
+constexpr uint32_t kMaxTimeCost = 10;
+
+double measureHashMillis(const Argon2Params& params) {
+  const std::string password = "calibration-password";
+  const std::vector<uint8_t> salt(kSaltLen, 0x5a);
+  std::vector<uint8_t> hash(kHashLen);
+
+  const auto start = std::chrono::steady_clock::now();
+  const int rc = argon2id_hash_raw(params.timeCost,
+                                   params.memoryKiB,
+                                   params.parallelism,
+                                   password.c_str(),
+                                   password.size(),
+                                   salt.data(),
+                                   salt.size(),
+                                   hash.data(),
+                                   hash.size());
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  if (rc != ARGON2_OK) {
+    return -1;
+  }
+  return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+}  // namespace
+
+PasswordService::PasswordService(const Argon2Params& params) : params_(params) {}
+
+const Argon2Params& PasswordService::params() const {
+  return params_;
+}
 
-  std::vector<uint8_t> salt(saltLen);
+std::string PasswordService::hashPassword(const std::string& password, std::string& error) const {
+  const tracing::ScopedSpan span(tracing::Stage::PasswordHash);
+  std::vector<uint8_t> salt(kSaltLen);
   if (RAND_bytes(salt.data(), static_cast<int>(salt.size())) != 1) {
     error = "failed to generate random salt";
     return "";
   }
 
-  const size_t encodedLen = argon2_encodedlen(tCost, mCost, parallelism, saltLen, hashLen, Argon2_id);
+  const size_t encodedLen =
+      argon2_encodedlen(params_.timeCost, params_.memoryKiB, params_.parallelism, kSaltLen, kHashLen, Argon2_id);
   std::string encoded(encodedLen, '\0');
 
-  const int rc = argon2id_hash_encoded(tCost,
-                                       mCost,
-                                       parallelism,
+  const int rc = argon2id_hash_encoded(params_.timeCost,
+                                       params_.memoryKiB,
+                                       params_.parallelism,
                                        password.c_str(),
                                        password.size(),
                                        salt.data(),
                                        salt.size(),
-                                       hashLen,
+                                       kHashLen,
                                        encoded.data(),
                                        encoded.size());
   if (rc != ARGON2_OK) {
@@ -44,8 +81,53 @@ std::string PasswordService::hashPassword(const std::string& password, std::stri
 }
 
 bool PasswordService::verifyPassword(const std::string& password, const std::string& encodedHash) const {
+  const tracing::ScopedSpan span(tracing::Stage::PasswordHash);
   const int rc = argon2id_verify(encodedHash.c_str(), password.c_str(), password.size());
   return rc == ARGON2_OK;
 }
 
+bool PasswordService::needsRehash(const std::string& encodedHash) const {
+  unsigned version = 0;
+  unsigned memoryKiB = 0;
+  unsigned timeCost = 0;
+  // Lanes change the layout, not the strength, so p is not compared.
+  if (std::sscanf(encodedHash.c_str(), "$argon2id$v=%u$m=%u,t=%u,p=%*u$", &version, &memoryKiB, &timeCost) != 3) {
+    return true;
+  }
+  const uint64_t work = static_cast<uint64_t>(memoryKiB) * timeCost;
+  const uint64_t targetWork = static_cast<uint64_t>(params_.memoryKiB) * params_.timeCost;
+  return version != ARGON2_VERSION_NUMBER || memoryKiB < params_.memoryKiB || work < targetWork;
+}
+
+Argon2Params PasswordService::calibrate(int targetMillis,
+                                        uint32_t maxMemoryKiB,
+                                        uint32_t parallelism,
+                                        double& measuredMillis) {
+  Argon2Params params;
+  params.parallelism = std::max<uint32_t>(1, parallelism);
+  params.memoryKiB = std::max(kMinMemoryKiB, maxMemoryKiB);
+  params.timeCost = 1;
+
+  // Memory first: halve it until a single pass fits the latency budget.
+  double elapsed = measureHashMillis(params);
+  while (elapsed > targetMillis && params.memoryKiB / 2 >= kMinMemoryKiB) {
+    params.memoryKiB /= 2;
+    elapsed = measureHashMillis(params);
+  }
+
+  // Then passes: cost grows roughly linearly with t, so extrapolate once and
+  // back off if the estimate overshoots.
+  if (elapsed > 0 && elapsed < targetMillis) {
+    params.timeCost = std::clamp<uint32_t>(static_cast<uint32_t>(targetMillis / elapsed), 1, kMaxTimeCost);
+    elapsed = measureHashMillis(params);
+    while (params.timeCost > 1 && elapsed > targetMillis) {
+      params.timeCost--;
+      elapsed = measureHashMillis(params);
+    }
+  }
+
+  measuredMillis = elapsed;
+  return params;
+}
+
 }  // namespace blog
@@ -1,13 +1,41 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace blog {
 
+struct Argon2Params {
+  uint32_t timeCost = 2;
+  uint32_t memoryKiB = 1 << 16;
+  uint32_t parallelism = 1;
+};
+
 class PasswordService {
  public:
+  PasswordService() = default;
+  explicit PasswordService(const Argon2Params& params);
+
   std::string hashPassword(const std::string& password, std::string& error) const;
   bool verifyPassword(const std::string& password, const std::string& encodedHash) const;
+
+  // True when the encoded hash is weaker than the current parameters (less
+  // memory or less total work, or another Argon2 version), so a successful
+  // login should re-hash the password. Calibration varies between boots and
+  // hosts, so hashes at least as strong are kept rather than churned.
+  bool needsRehash(const std::string& encodedHash) const;
+
+  const Argon2Params& params() const;
+
+  // Picks the largest cost that stays within targetMillis per hash on this
+  // machine, preferring memory up to maxMemoryKiB before adding passes.
+  static Argon2Params calibrate(int targetMillis,
+                                uint32_t maxMemoryKiB,
+                                uint32_t parallelism,
+                                double& measuredMillis);
+
+ private:
+  Argon2Params params_;
 };
 
 }  // namespace blog
@@ -12,6 +12,15 @@ namespace {
 
 constexpr char kHex[] = "0123456789abcdef";
 
+constexpr const char* kInsertTokenSql =
+    "INSERT INTO refresh_tokens(user_id, token_hash, expires_at, created_at) "
+    "VALUES(?, ?, datetime('now', ?), datetime('now'));";
+
+constexpr const char* kClaimTokenSql =
+    "UPDATE refresh_tokens SET revoked_at = datetime('now') "
+    "WHERE token_hash = ? AND revoked_at IS NULL AND expires_at > datetime('now') "
+    "RETURNING user_id;";
+
 std::string trim(const std::string& input) {
   size_t start = 0;
   while (start < input.size() && std::isspace(static_cast<unsigned char>(input[start]))) {
@@ -64,21 +73,13 @@ bool RefreshTokenService::issueToken(int64_t userId, std::string& rawToken, std:
     return false;
   }
 
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    error = dbError;
+  auto conn = db_.acquire(error);
+  if (!conn) {
     return false;
   }
 
-  const char* sql =
-      "INSERT INTO refresh_tokens(user_id, token_hash, expires_at, created_at) "
-      "VALUES(?, ?, datetime('now', ?), datetime('now'));";
-
-  sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    error = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* stmt = conn.prepare(kInsertTokenSql, error);
+  if (stmt == nullptr) {
     return false;
   }
 
@@ -89,16 +90,10 @@ bool RefreshTokenService::issueToken(int64_t userId, std::string& rawToken, std:
   sqlite3_bind_text(stmt, 2, tokenHash.c_str(), -1, SQLITE_TRANSIENT);
   sqlite3_bind_text(stmt, 3, modifier.c_str(), -1, SQLITE_TRANSIENT);
 
-  const int rc = sqlite3_step(stmt);
-  if (rc != SQLITE_DONE) {
-    error = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    error = sqlite3_errmsg(conn.get());
     return false;
   }
-
-  sqlite3_finalize(stmt);
-  sqlite3_close(db);
   return true;
 }
 
@@ -107,119 +102,89 @@ bool RefreshTokenService::rotateToken(const std::string& oldRawToken,
                                       std::string& newRawToken,
                                       std::string& errorCode,
                                       std::string& errorMessage) {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorCode = "DB_ERROR";
-    errorMessage = dbError;
+  newRawToken = generateToken();
+  if (newRawToken.empty()) {
+    errorCode = "INTERNAL_ERROR";
+    errorMessage = "failed to generate refresh token";
     return false;
   }
 
   const std::string oldHash = sha256Hex(oldRawToken);
+  const std::string newHash = sha256Hex(newRawToken);
+  const std::string modifier = "+" + std::to_string(refreshExpireDays_) + " days";
 
-  sqlite3_stmt* selectStmt = nullptr;
-  const char* selectSql =
-      "SELECT id, user_id FROM refresh_tokens "
-      "WHERE token_hash = ? AND revoked_at IS NULL AND expires_at > datetime('now') "
-      "LIMIT 1;";
-
-  if (sqlite3_prepare_v2(db, selectSql, -1, &selectStmt, nullptr) != SQLITE_OK) {
+  std::string dbError;
+  auto conn = db_.acquire(dbError);
+  if (!conn) {
     errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
-    return false;
-  }
-
-  sqlite3_bind_text(selectStmt, 1, oldHash.c_str(), -1, SQLITE_TRANSIENT);
-  const int rcSelect = sqlite3_step(selectStmt);
-  if (rcSelect != SQLITE_ROW) {
-    sqlite3_finalize(selectStmt);
-    sqlite3_close(db);
-    errorCode = "AUTH_INVALID_TOKEN";
-    errorMessage = "refresh token invalid or expired";
+    errorMessage = dbError;
     return false;
   }
 
-  const int64_t tokenId = sqlite3_column_int64(selectStmt, 0);
-  userId = sqlite3_column_int64(selectStmt, 1);
-  sqlite3_finalize(selectStmt);
-
-  std::string sqlError;
-  if (!db_.exec(db, "BEGIN;", sqlError)) {
-    sqlite3_close(db);
+  // Take the write lock up front so concurrent refreshes of the same token
+  // serialize on the claim below and exactly one of them wins.
+  if (!db_.exec(conn.get(), "BEGIN IMMEDIATE;", dbError)) {
     errorCode = "DB_ERROR";
-    errorMessage = sqlError;
+    errorMessage = dbError;
     return false;
   }
 
-  sqlite3_stmt* revokeStmt = nullptr;
-  const char* revokeSql = "UPDATE refresh_tokens SET revoked_at = datetime('now') WHERE id = ?;";
-  if (sqlite3_prepare_v2(db, revokeSql, -1, &revokeStmt, nullptr) != SQLITE_OK) {
-    db_.exec(db, "ROLLBACK;", sqlError);
-    sqlite3_close(db);
+  sqlite3_stmt* claimStmt = conn.prepare(kClaimTokenSql, dbError);
+  if (claimStmt == nullptr) {
+    db_.exec(conn.get(), "ROLLBACK;", dbError);
     errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
+    errorMessage = dbError;
     return false;
   }
-  sqlite3_bind_int64(revokeStmt, 1, tokenId);
-  if (sqlite3_step(revokeStmt) != SQLITE_DONE) {
-    sqlite3_finalize(revokeStmt);
-    db_.exec(db, "ROLLBACK;", sqlError);
-    sqlite3_close(db);
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    return false;
+
+  sqlite3_bind_text(claimStmt, 1, oldHash.c_str(), -1, SQLITE_TRANSIENT);
+  const int rcClaim = sqlite3_step(claimStmt);
+  if (rcClaim == SQLITE_ROW) {
+    userId = sqlite3_column_int64(claimStmt, 0);
   }
-  sqlite3_finalize(revokeStmt);
+  sqlite3_reset(claimStmt);
 
-  newRawToken = generateToken();
-  if (newRawToken.empty()) {
-    db_.exec(db, "ROLLBACK;", sqlError);
-    sqlite3_close(db);
-    errorCode = "INTERNAL_ERROR";
-    errorMessage = "failed to generate refresh token";
+  if (rcClaim != SQLITE_ROW) {
+    const bool claimFailed = rcClaim != SQLITE_DONE;
+    if (claimFailed) {
+      errorMessage = sqlite3_errmsg(conn.get());
+    }
+    db_.exec(conn.get(), "ROLLBACK;", dbError);
+    if (claimFailed) {
+      errorCode = "DB_ERROR";
+      return false;
+    }
+    errorCode = "AUTH_INVALID_TOKEN";
+    errorMessage = "refresh token invalid or expired";
     return false;
   }
 
-  sqlite3_stmt* insertStmt = nullptr;
-  const char* insertSql =
-      "INSERT INTO refresh_tokens(user_id, token_hash, expires_at, created_at) "
-      "VALUES(?, ?, datetime('now', ?), datetime('now'));";
-
-  if (sqlite3_prepare_v2(db, insertSql, -1, &insertStmt, nullptr) != SQLITE_OK) {
-    db_.exec(db, "ROLLBACK;", sqlError);
-    sqlite3_close(db);
+  sqlite3_stmt* insertStmt = conn.prepare(kInsertTokenSql, dbError);
+  if (insertStmt == nullptr) {
+    db_.exec(conn.get(), "ROLLBACK;", dbError);
     errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
+    errorMessage = dbError;
     return false;
   }
 
-  const std::string modifier = "+" + std::to_string(refreshExpireDays_) + " days";
-  const std::string newHash = sha256Hex(newRawToken);
-
   sqlite3_bind_int64(insertStmt, 1, userId);
   sqlite3_bind_text(insertStmt, 2, newHash.c_str(), -1, SQLITE_TRANSIENT);
   sqlite3_bind_text(insertStmt, 3, modifier.c_str(), -1, SQLITE_TRANSIENT);
 
   if (sqlite3_step(insertStmt) != SQLITE_DONE) {
-    sqlite3_finalize(insertStmt);
-    db_.exec(db, "ROLLBACK;", sqlError);
-    sqlite3_close(db);
+    errorMessage = sqlite3_errmsg(conn.get());
+    db_.exec(conn.get(), "ROLLBACK;", dbError);
     errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
     return false;
   }
-  sqlite3_finalize(insertStmt);
 
-  if (!db_.exec(db, "COMMIT;", sqlError)) {
-    db_.exec(db, "ROLLBACK;", sqlError);
-    sqlite3_close(db);
+  if (!db_.exec(conn.get(), "COMMIT;", dbError)) {
+    errorMessage = dbError;
+    db_.exec(conn.get(), "ROLLBACK;", dbError);
     errorCode = "DB_ERROR";
-    errorMessage = sqlError;
     return false;
   }
 
-  sqlite3_close(db);
   return true;
 }
 
@@ -0,0 +1,44 @@
+#include "auth/TokenVersionStore.h"
+
+#include <mutex>
+#include <vector>
+
+namespace blog {
+
+TokenVersionStore::TokenVersionStore(const UserRepository& userRepository) : userRepository_(userRepository) {}
+
+bool TokenVersionStore::load(std::string& error) {
+  std::vector<UserTokenState> rows;
+  if (!userRepository_.listTokenStates(rows, error)) {
+    return false;
+  }
+
+  for (const auto& state : rows) {
+    publish(state);
+  }
+  return true;
+}
+
+int64_t TokenVersionStore::current(int64_t userId) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto it = users_.find(userId);
+  return it == users_.end() ? 0 : it->second.version;
+}
+
+bool TokenVersionStore::banned(int64_t userId) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const auto it = users_.find(userId);
+  return it != users_.end() && it->second.banned;
+}
+
+void TokenVersionStore::publish(const UserTokenState& state) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto& entry = users_[state.userId];
+  // Users loaded only for a ban start at version 0, hence >=.
+  if (state.tokenVersion >= entry.version) {
+    entry.version = state.tokenVersion;
+    entry.banned = state.isBanned;
+  }
+}
+
+}  // namespace blog
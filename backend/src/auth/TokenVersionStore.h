@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "models/User.h"
+#include "repositories/UserRepository.h"
+
+namespace blog {
+
+// In-memory mirror of users.token_version and is_banned. Access tokens embed
+// the version they were issued under; bumping it revokes them all without the
+// request path touching the database. Users that were never revoked sit at 0
+// and are not stored.
+class TokenVersionStore {
+ public:
+  explicit TokenVersionStore(const UserRepository& userRepository);
+
+  bool load(std::string& error);
+
+  int64_t current(int64_t userId) const;
+  // Ban status as of the user's current version, so a revoked token can be
+  // told apart from a banned user's.
+  bool banned(int64_t userId) const;
+  // Records a state the caller committed together with a version bump.
+  // States older than the one held are ignored.
+  void publish(const UserTokenState& state);
+
+ private:
+  struct Entry {
+    int64_t version = 0;
+    bool banned = false;
+  };
+
+  const UserRepository& userRepository_;
+  // Writes are admin actions and password changes; a plain shared_mutex
+  // keeps version and ban status consistent with each other.
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<int64_t, Entry> users_;
+};
+
+}  // namespace blog
@@ -1,5 +1,6 @@
 #include "controllers/AdminController.h"
 
+#include "controllers/ModelJson.h"
 #include "middleware/AdminMiddleware.h"
 #include "middleware/AuthMiddleware.h"
 #include "utils/JsonResponse.h"
@@ -7,18 +8,12 @@
 
 namespace blog {
 
-AdminController::AdminController(const UserRepository& userRepository, const JwtService& jwtService)
-    : userRepository_(userRepository), jwtService_(jwtService) {}
-
-Json::Value AdminController::userToJson(const User& user) const {
-  Json::Value value(Json::objectValue);
-  value["id"] = Json::Int64(user.id);
-  value["username"] = user.username;
-  value["role"] = user.role;
-  value["isBanned"] = user.isBanned;
-  value["createdAt"] = user.createdAt;
-  return value;
-}
+AdminController::AdminController(const UserRepository& userRepository,
+                                 TokenVersionStore& tokenVersionStore,
+                                 const metrics::MetricsRegistry& metricsRegistry)
+    : userRepository_(userRepository),
+      tokenVersionStore_(tokenVersionStore),
+      metricsRegistry_(metricsRegistry) {}
 
 void AdminController::listUsers(const drogon::HttpRequestPtr& req,
                                 std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
@@ -26,7 +21,7 @@ void AdminController::listUsers(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -53,18 +48,20 @@ void AdminController::listUsers(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& user : users) {
-    items.append(userToJson(user));
-  }
-
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-  data["page"] = pagination.page;
-  data["pageSize"] = pagination.pageSize;
-  data["total"] = total;
-
-  callback(utils::makeSuccess(data, requestId));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items").beginArray();
+        for (const auto& user : users) {
+          writeUser(writer, user);
+        }
+        writer.endArray();
+        writer.field("page", pagination.page);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        writer.endObject();
+      },
+      requestId));
 }
 
 void AdminController::updateRole(const drogon::HttpRequestPtr& req,
@@ -80,7 +77,7 @@ void AdminController::updateRole(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -105,7 +102,8 @@ void AdminController::updateRole(const drogon::HttpRequestPtr& req,
   }
 
   std::string dbError;
-  if (!userRepository_.updateRole(targetId, role, dbError)) {
+  UserTokenState tokenState;
+  if (!userRepository_.updateRole(targetId, role, tokenState, dbError)) {
     if (dbError == "user not found") {
       callback(utils::makeError(ApiError(404, "USER_NOT_FOUND", dbError), requestId));
       return;
@@ -113,6 +111,7 @@ void AdminController::updateRole(const drogon::HttpRequestPtr& req,
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
+  tokenVersionStore_.publish(tokenState);
 
   const auto user = userRepository_.findById(targetId);
   if (!user.has_value()) {
@@ -120,7 +119,8 @@ void AdminController::updateRole(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  callback(utils::makeSuccess(userToJson(*user), requestId, 200, "role updated"));
+  callback(utils::makeSuccessWith([&](utils::JsonWriter& writer) { writeUser(writer, *user); },
+                                  requestId, 200, "role updated"));
 }
 
 void AdminController::updateBan(const drogon::HttpRequestPtr& req,
@@ -136,7 +136,7 @@ void AdminController::updateBan(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -155,7 +155,8 @@ void AdminController::updateBan(const drogon::HttpRequestPtr& req,
 
   const bool isBanned = (*body)["isBanned"].asBool();
   std::string dbError;
-  if (!userRepository_.updateBanStatus(targetId, isBanned, dbError)) {
+  UserTokenState tokenState;
+  if (!userRepository_.updateBanStatus(targetId, isBanned, tokenState, dbError)) {
     if (dbError == "user not found") {
       callback(utils::makeError(ApiError(404, "USER_NOT_FOUND", dbError), requestId));
       return;
@@ -163,6 +164,7 @@ void AdminController::updateBan(const drogon::HttpRequestPtr& req,
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
+  tokenVersionStore_.publish(tokenState);
 
   const auto user = userRepository_.findById(targetId);
   if (!user.has_value()) {
@@ -170,7 +172,41 @@ void AdminController::updateBan(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  callback(utils::makeSuccess(userToJson(*user), requestId, 200, "ban status updated"));
+  callback(utils::makeSuccessWith([&](utils::JsonWriter& writer) { writeUser(writer, *user); },
+                                  requestId, 200, "ban status updated"));
+}
+
+void AdminController::metrics(const drogon::HttpRequestPtr& req,
+                              std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
+  const std::string requestId = utils::getRequestId(req);
+
+  RequestUser authUser;
+  ApiError authError(401, "AUTH_REQUIRED", "auth required");
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
+    callback(utils::makeError(authError, requestId));
+    return;
+  }
+
+  ApiError adminError(403, "FORBIDDEN", "admin role required");
+  if (!AdminMiddleware::ensureAdmin(authUser, adminError)) {
+    callback(utils::makeError(adminError, requestId));
+    return;
+  }
+
+  callback(metricsResponse());
+}
+
+void AdminController::scrapeMetrics(const drogon::HttpRequestPtr&,
+                                    std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
+  callback(metricsResponse());
+}
+
+drogon::HttpResponsePtr AdminController::metricsResponse() const {
+  auto response = drogon::HttpResponse::newHttpResponse();
+  response->setStatusCode(drogon::k200OK);
+  response->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+  response->setBody(metricsRegistry_.renderPrometheus());
+  return response;
 }
 
 }  // namespace blog
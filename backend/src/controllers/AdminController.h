@@ -2,14 +2,17 @@
 
 #include <drogon/drogon.h>
 
-#include "auth/JwtService.h"
+#include "auth/TokenVersionStore.h"
+#include "metrics/MetricsRegistry.h"
 #include "repositories/UserRepository.h"
 
 namespace blog {
 
 class AdminController {
  public:
-  AdminController(const UserRepository& userRepository, const JwtService& jwtService);
+  AdminController(const UserRepository& userRepository,
+                  TokenVersionStore& tokenVersionStore,
+                  const metrics::MetricsRegistry& metricsRegistry);
 
   void listUsers(const drogon::HttpRequestPtr& req,
                  std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
@@ -22,11 +25,20 @@ class AdminController {
                  std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                  const std::string& userId) const;
 
+  void metrics(const drogon::HttpRequestPtr& req,
+               std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
+
+  // Unauthenticated scrape for the dedicated METRICS_PORT listener; the route
+  // only answers requests that arrived on that port.
+  void scrapeMetrics(const drogon::HttpRequestPtr& req,
+                     std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
+
  private:
-  const UserRepository& userRepository_;
-  const JwtService& jwtService_;
+  drogon::HttpResponsePtr metricsResponse() const;
 
-  Json::Value userToJson(const User& user) const;
+  const UserRepository& userRepository_;
+  TokenVersionStore& tokenVersionStore_;
+  const metrics::MetricsRegistry& metricsRegistry_;
 };
 
 }  // namespace blog
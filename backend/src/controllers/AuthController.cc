@@ -1,29 +1,43 @@
 #include "controllers/AuthController.h"
 
+#include "controllers/ModelJson.h"
 #include "middleware/AuthMiddleware.h"
 #include "utils/JsonResponse.h"
 #include "utils/Validation.h"
 
 namespace blog {
+namespace {
+
+drogon::HttpResponsePtr makeSessionResponse(const std::string& accessToken,
+                                            const User& user,
+                                            const std::string& requestId,
+                                            int status,
+                                            const std::string& message) {
+  return utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.field("accessToken", accessToken);
+        writer.key("user");
+        writeUser(writer, user);
+        writer.endObject();
+      },
+      requestId, status, message, 1024);
+}
+
+}  // namespace
 
 AuthController::AuthController(const UserRepository& userRepository,
                                const PasswordService& passwordService,
                                const JwtService& jwtService,
-                               RefreshTokenService& refreshTokenService)
+                               RefreshTokenService& refreshTokenService,
+                               TokenVersionStore& tokenVersionStore,
+                               PasswordRehasher& passwordRehasher)
     : userRepository_(userRepository),
       passwordService_(passwordService),
       jwtService_(jwtService),
-      refreshTokenService_(refreshTokenService) {}
-
-Json::Value AuthController::userToJson(const User& user) const {
-  Json::Value value(Json::objectValue);
-  value["id"] = Json::Int64(user.id);
-  value["username"] = user.username;
-  value["role"] = user.role;
-  value["isBanned"] = user.isBanned;
-  value["createdAt"] = user.createdAt;
-  return value;
-}
+      refreshTokenService_(refreshTokenService),
+      tokenVersionStore_(tokenVersionStore),
+      passwordRehasher_(passwordRehasher) {}
 
 void AuthController::registerUser(const drogon::HttpRequestPtr& req,
                                   std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
@@ -78,11 +92,7 @@ void AuthController::registerUser(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["accessToken"] = accessToken;
-  data["user"] = userToJson(user);
-
-  auto response = utils::makeSuccess(data, requestId, 201, "registered");
+  auto response = makeSessionResponse(accessToken, user, requestId, 201, "registered");
   response->addHeader("Set-Cookie", refreshTokenService_.buildSetCookie(refreshRawToken, false));
   callback(response);
 }
@@ -118,6 +128,8 @@ void AuthController::login(const drogon::HttpRequestPtr& req,
     return;
   }
 
+  passwordRehasher_.scheduleIfOutdated(user->id, password, user->passwordHash);
+
   TokenPayload payload;
   payload.userId = user->id;
   payload.username = user->username;
@@ -132,11 +144,7 @@ void AuthController::login(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["accessToken"] = accessToken;
-  data["user"] = userToJson(*user);
-
-  auto response = utils::makeSuccess(data, requestId, 200, "logged in");
+  auto response = makeSessionResponse(accessToken, *user, requestId, 200, "logged in");
   response->addHeader("Set-Cookie", refreshTokenService_.buildSetCookie(refreshRawToken, false));
   callback(response);
 }
@@ -177,11 +185,8 @@ void AuthController::refresh(const drogon::HttpRequestPtr& req,
   payload.username = user->username;
   payload.role = user->role;
 
-  Json::Value data(Json::objectValue);
-  data["accessToken"] = jwtService_.generateAccessToken(payload);
-  data["user"] = userToJson(*user);
-
-  auto response = utils::makeSuccess(data, requestId, 200, "refreshed");
+  const std::string accessToken = jwtService_.generateAccessToken(payload);
+  auto response = makeSessionResponse(accessToken, *user, requestId, 200, "refreshed");
   response->addHeader("Set-Cookie", refreshTokenService_.buildSetCookie(newRawToken, false));
   callback(response);
 }
@@ -210,7 +215,7 @@ void AuthController::changePassword(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -260,7 +265,8 @@ void AuthController::changePassword(const drogon::HttpRequestPtr& req,
   }
 
   std::string updateError;
-  if (!userRepository_.updatePasswordHash(authUser.id, newPasswordHash, updateError)) {
+  UserTokenState tokenState;
+  if (!userRepository_.updatePasswordHash(authUser.id, newPasswordHash, tokenState, updateError)) {
     if (updateError == "user not found") {
       callback(utils::makeError(ApiError(404, "USER_NOT_FOUND", "user not found"), requestId));
       return;
@@ -268,6 +274,7 @@ void AuthController::changePassword(const drogon::HttpRequestPtr& req,
     callback(utils::makeError(ApiError(500, "DB_ERROR", updateError), requestId));
     return;
   }
+  tokenVersionStore_.publish(tokenState);
 
   std::string revokeError;
   if (!refreshTokenService_.revokeAllByUserId(authUser.id, revokeError)) {
@@ -287,11 +294,8 @@ void AuthController::changePassword(const drogon::HttpRequestPtr& req,
   payload.username = user->username;
   payload.role = user->role;
 
-  Json::Value data(Json::objectValue);
-  data["accessToken"] = jwtService_.generateAccessToken(payload);
-  data["user"] = userToJson(*user);
-
-  auto response = utils::makeSuccess(data, requestId, 200, "password changed");
+  const std::string accessToken = jwtService_.generateAccessToken(payload);
+  auto response = makeSessionResponse(accessToken, *user, requestId, 200, "password changed");
   response->addHeader("Set-Cookie", refreshTokenService_.buildSetCookie(refreshRawToken, false));
   callback(response);
 }
@@ -3,8 +3,10 @@
 #include <drogon/drogon.h>
 
 #include "auth/JwtService.h"
+#include "auth/PasswordRehasher.h"
 #include "auth/PasswordService.h"
 #include "auth/RefreshTokenService.h"
+#include "auth/TokenVersionStore.h"
 #include "repositories/UserRepository.h"
 
 namespace blog {
@@ -14,7 +16,9 @@ class AuthController {
   AuthController(const UserRepository& userRepository,
                  const PasswordService& passwordService,
                  const JwtService& jwtService,
-                 RefreshTokenService& refreshTokenService);
+                 RefreshTokenService& refreshTokenService,
+                 TokenVersionStore& tokenVersionStore,
+                 PasswordRehasher& passwordRehasher);
 
   void registerUser(const drogon::HttpRequestPtr& req,
                     std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
@@ -36,8 +40,8 @@ class AuthController {
   const PasswordService& passwordService_;
   const JwtService& jwtService_;
   RefreshTokenService& refreshTokenService_;
-
-  Json::Value userToJson(const User& user) const;
+  TokenVersionStore& tokenVersionStore_;
+  PasswordRehasher& passwordRehasher_;
 };
 
 }  // namespace blog
@@ -1,54 +1,81 @@
 #include "controllers/CollectionController.h"
 
+#include "controllers/ModelJson.h"
+#include "controllers/PostStatsJson.h"
 #include "middleware/AuthMiddleware.h"
 #include "utils/JsonResponse.h"
 #include "utils/Validation.h"
 
+#include <unordered_set>
+
 namespace blog {
+namespace {
+
+constexpr Json::ArrayIndex kMaxBatchPostIds = 200;
+
+// Reads body["postIds"]: 1..kMaxBatchPostIds distinct positive ids, as
+// numbers or numeric strings.
+bool parsePostIdList(const std::shared_ptr<Json::Value>& body, std::vector<int64_t>& postIds, std::string& error) {
+  if (!body || !body->isObject() || !(*body)["postIds"].isArray() || (*body)["postIds"].empty()) {
+    error = "postIds must be a non-empty array";
+    return false;
+  }
+  const Json::Value& items = (*body)["postIds"];
+  if (items.size() > kMaxBatchPostIds) {
+    error = "at most " + std::to_string(kMaxBatchPostIds) + " postIds per request";
+    return false;
+  }
+
+  std::unordered_set<int64_t> seen;
+  postIds.clear();
+  postIds.reserve(items.size());
+  for (const auto& item : items) {
+    int64_t postId = 0;
+    if (item.isInt64()) {
+      postId = item.asInt64();
+    } else if (!item.isString() || !utils::parsePositiveInt64(item.asString(), postId)) {
+      error = "invalid postId in postIds";
+      return false;
+    }
+    if (postId <= 0) {
+      error = "invalid postId in postIds";
+      return false;
+    }
+    if (!seen.insert(postId).second) {
+      error = "duplicate postId " + std::to_string(postId) + " in postIds";
+      return false;
+    }
+    postIds.push_back(postId);
+  }
+  return true;
+}
+
+}  // namespace
 
 CollectionController::CollectionController(const CollectionRepository& collectionRepository,
                                            const PostRepository& postRepository,
-                                           const UserRepository& userRepository,
-                                           const JwtService& jwtService)
+                                           const InteractionWriteBuffer& interactionWriteBuffer,
+                                           CollectionOrderCache& collectionOrderCache)
     : collectionRepository_(collectionRepository),
       postRepository_(postRepository),
-      userRepository_(userRepository),
-      jwtService_(jwtService) {}
+      interactionWriteBuffer_(interactionWriteBuffer),
+      collectionOrderCache_(collectionOrderCache) {}
 
-Json::Value CollectionController::collectionToJson(const Collection& collection) const {
+Json::Value CollectionController::membershipToJson(const PostCollectionMembership& membership) const {
   Json::Value value(Json::objectValue);
-  value["id"] = Json::Int64(collection.id);
-  value["name"] = collection.name;
-  value["description"] = collection.description;
-  value["ownerId"] = Json::Int64(collection.ownerId);
-  value["ownerUsername"] = collection.ownerUsername;
-  value["createdAt"] = collection.createdAt;
-  value["updatedAt"] = collection.updatedAt;
-  value["postCount"] = collection.postCount;
+  value["collectionId"] = Json::Int64(membership.collectionId);
+  value["collectionName"] = membership.collectionName;
+  value["position"] = membership.position;
   return value;
 }
 
-Json::Value CollectionController::postToJson(const Post& post) const {
-  Json::Value value(Json::objectValue);
-  value["id"] = Json::Int64(post.id);
-  value["title"] = post.title;
-  value["contentMarkdown"] = post.contentMarkdown;
-  value["authorId"] = Json::Int64(post.authorId);
-  value["authorUsername"] = post.authorUsername;
-  value["createdAt"] = post.createdAt;
-  value["updatedAt"] = post.updatedAt;
-  value["isDeleted"] = post.isDeleted;
-  if (post.collectionPosition > 0) {
-    value["collectionPosition"] = post.collectionPosition;
+Json::Value CollectionController::neighborToJson(const std::optional<CollectionNeighbor>& neighbor) const {
+  if (!neighbor.has_value()) {
+    return Json::Value(Json::nullValue);
   }
-  return value;
-}
-
-Json::Value CollectionController::membershipToJson(const PostCollectionMembership& membership) const {
   Json::Value value(Json::objectValue);
-  value["collectionId"] = Json::Int64(membership.collectionId);
-  value["collectionName"] = membership.collectionName;
-  value["position"] = membership.position;
+  value["id"] = Json::Int64(neighbor->id);
+  value["title"] = neighbor->title;
   return value;
 }
 
@@ -58,7 +85,7 @@ void CollectionController::createCollection(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -92,7 +119,8 @@ void CollectionController::createCollection(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  callback(utils::makeSuccess(collectionToJson(collection), requestId, 201, "collection created"));
+  callback(utils::makeSuccessWith([&](utils::JsonWriter& writer) { writeCollection(writer, collection); },
+                                  requestId, 201, "collection created"));
 }
 
 void CollectionController::listMyCollections(const drogon::HttpRequestPtr& req,
@@ -101,7 +129,7 @@ void CollectionController::listMyCollections(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -113,15 +141,17 @@ void CollectionController::listMyCollections(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& collection : collections) {
-    items.append(collectionToJson(collection));
-  }
-
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-
-  callback(utils::makeSuccess(data, requestId));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items").beginArray();
+        for (const auto& collection : collections) {
+          writeCollection(writer, collection);
+        }
+        writer.endArray();
+        writer.endObject();
+      },
+      requestId));
 }
 
 void CollectionController::getCollection(const drogon::HttpRequestPtr& req,
@@ -148,17 +178,25 @@ void CollectionController::getCollection(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value postItems(Json::arrayValue);
-  for (const auto& post : posts) {
-    postItems.append(postToJson(post));
+  PostStatsMap stats;
+  const bool withStats = utils::includeRequested(req, "stats");
+  if (withStats &&
+      !loadPostStats(interactionWriteBuffer_, posts, AuthMiddleware::currentUserId(req), stats, errorMessage)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", errorMessage), requestId));
+    return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["collection"] = collectionToJson(*collection);
-  data["posts"] = postItems;
-  data["total"] = static_cast<int>(posts.size());
-
-  callback(utils::makeSuccess(data, requestId));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("collection");
+        writeCollection(writer, *collection);
+        writer.key("posts");
+        writePostItems(writer, posts, withStats ? &stats : nullptr);
+        writer.field("total", static_cast<int>(posts.size()));
+        writer.endObject();
+      },
+      requestId));
 }
 
 void CollectionController::addPostToCollection(const drogon::HttpRequestPtr& req,
@@ -174,7 +212,7 @@ void CollectionController::addPostToCollection(const drogon::HttpRequestPtr& req
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -233,6 +271,8 @@ void CollectionController::addPostToCollection(const drogon::HttpRequestPtr& req
     return;
   }
 
+  collectionOrderCache_.invalidate(collectionIdNum);
+
   Json::Value data(Json::objectValue);
   data["collectionId"] = Json::Int64(collectionIdNum);
   data["postId"] = Json::Int64(postId);
@@ -257,7 +297,7 @@ void CollectionController::removePostFromCollection(const drogon::HttpRequestPtr
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -284,6 +324,8 @@ void CollectionController::removePostFromCollection(const drogon::HttpRequestPtr
     return;
   }
 
+  collectionOrderCache_.invalidate(collectionIdNum);
+
   Json::Value data(Json::objectValue);
   data["collectionId"] = Json::Int64(collectionIdNum);
   data["postId"] = Json::Int64(postIdNum);
@@ -292,6 +334,184 @@ void CollectionController::removePostFromCollection(const drogon::HttpRequestPtr
   callback(utils::makeSuccess(data, requestId, 200, "post removed from collection"));
 }
 
+void CollectionController::moveCollectionPost(const drogon::HttpRequestPtr& req,
+                                              std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                                              const std::string& collectionId,
+                                              const std::string& postId) const {
+  const std::string requestId = utils::getRequestId(req);
+
+  int64_t collectionIdNum = 0;
+  int64_t postIdNum = 0;
+  if (!utils::parsePositiveInt64(collectionId, collectionIdNum) ||
+      !utils::parsePositiveInt64(postId, postIdNum)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid collection id or post id"), requestId));
+    return;
+  }
+
+  RequestUser authUser;
+  ApiError authError(401, "AUTH_REQUIRED", "auth required");
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
+    callback(utils::makeError(authError, requestId));
+    return;
+  }
+
+  const auto body = req->getJsonObject();
+  if (!body || !body->isObject() || !(*body)["position"].isInt() || (*body)["position"].asInt() <= 0) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "position must be a positive integer"), requestId));
+    return;
+  }
+  const int position = (*body)["position"].asInt();
+
+  const auto collection = collectionRepository_.findById(collectionIdNum, false);
+  if (!collection.has_value()) {
+    callback(utils::makeError(ApiError(404, "COLLECTION_NOT_FOUND", "collection not found"), requestId));
+    return;
+  }
+
+  if (authUser.role != "admin" && authUser.id != collection->ownerId) {
+    callback(utils::makeError(ApiError(403, "FORBIDDEN", "no permission to edit this collection"), requestId));
+    return;
+  }
+
+  int newPosition = 0;
+  std::string errorCode;
+  std::string errorMessage;
+  if (!collectionRepository_.movePostInCollection(
+          collectionIdNum, postIdNum, position, newPosition, errorCode, errorMessage)) {
+    if (errorCode == "COLLECTION_POST_NOT_FOUND") {
+      callback(utils::makeError(ApiError(404, errorCode, errorMessage), requestId));
+      return;
+    }
+    callback(utils::makeError(ApiError(500, errorCode, errorMessage), requestId));
+    return;
+  }
+
+  collectionOrderCache_.invalidate(collectionIdNum);
+
+  Json::Value data(Json::objectValue);
+  data["collectionId"] = Json::Int64(collectionIdNum);
+  data["postId"] = Json::Int64(postIdNum);
+  data["position"] = newPosition;
+
+  callback(utils::makeSuccess(data, requestId, 200, "post moved"));
+}
+
+void CollectionController::addPostsToCollection(const drogon::HttpRequestPtr& req,
+                                                std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                                                const std::string& collectionId) const {
+  const std::string requestId = utils::getRequestId(req);
+
+  int64_t collectionIdNum = 0;
+  if (!utils::parsePositiveInt64(collectionId, collectionIdNum)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid collection id"), requestId));
+    return;
+  }
+
+  RequestUser authUser;
+  ApiError authError(401, "AUTH_REQUIRED", "auth required");
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
+    callback(utils::makeError(authError, requestId));
+    return;
+  }
+
+  std::vector<int64_t> postIds;
+  std::string parseError;
+  if (!parsePostIdList(req->getJsonObject(), postIds, parseError)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", parseError), requestId));
+    return;
+  }
+
+  const auto collection = collectionRepository_.findById(collectionIdNum, false);
+  if (!collection.has_value()) {
+    callback(utils::makeError(ApiError(404, "COLLECTION_NOT_FOUND", "collection not found"), requestId));
+    return;
+  }
+
+  if (authUser.role != "admin" && authUser.id != collection->ownerId) {
+    callback(utils::makeError(ApiError(403, "FORBIDDEN", "no permission to edit this collection"), requestId));
+    return;
+  }
+
+  std::string errorCode;
+  std::string errorMessage;
+  if (!collectionRepository_.addPostsToCollection(collectionIdNum, postIds, errorCode, errorMessage)) {
+    if (errorCode == "COLLECTION_NOT_FOUND" || errorCode == "POST_NOT_FOUND") {
+      callback(utils::makeError(ApiError(404, errorCode, errorMessage), requestId));
+      return;
+    }
+    if (errorCode == "COLLECTION_POST_EXISTS") {
+      callback(utils::makeError(ApiError(409, errorCode, errorMessage), requestId));
+      return;
+    }
+    callback(utils::makeError(ApiError(500, errorCode, errorMessage), requestId));
+    return;
+  }
+
+  collectionOrderCache_.invalidate(collectionIdNum);
+
+  Json::Value data(Json::objectValue);
+  data["collectionId"] = Json::Int64(collectionIdNum);
+  data["added"] = static_cast<int>(postIds.size());
+
+  callback(utils::makeSuccess(data, requestId, 200, "posts added to collection"));
+}
+
+void CollectionController::reorderCollection(const drogon::HttpRequestPtr& req,
+                                             std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                                             const std::string& collectionId) const {
+  const std::string requestId = utils::getRequestId(req);
+
+  int64_t collectionIdNum = 0;
+  if (!utils::parsePositiveInt64(collectionId, collectionIdNum)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid collection id"), requestId));
+    return;
+  }
+
+  RequestUser authUser;
+  ApiError authError(401, "AUTH_REQUIRED", "auth required");
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
+    callback(utils::makeError(authError, requestId));
+    return;
+  }
+
+  std::vector<int64_t> postIds;
+  std::string parseError;
+  if (!parsePostIdList(req->getJsonObject(), postIds, parseError)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", parseError), requestId));
+    return;
+  }
+
+  const auto collection = collectionRepository_.findById(collectionIdNum, false);
+  if (!collection.has_value()) {
+    callback(utils::makeError(ApiError(404, "COLLECTION_NOT_FOUND", "collection not found"), requestId));
+    return;
+  }
+
+  if (authUser.role != "admin" && authUser.id != collection->ownerId) {
+    callback(utils::makeError(ApiError(403, "FORBIDDEN", "no permission to edit this collection"), requestId));
+    return;
+  }
+
+  std::string errorCode;
+  std::string errorMessage;
+  if (!collectionRepository_.reorderCollectionPosts(collectionIdNum, postIds, errorCode, errorMessage)) {
+    if (errorCode == "COLLECTION_POST_NOT_FOUND") {
+      callback(utils::makeError(ApiError(404, errorCode, errorMessage), requestId));
+      return;
+    }
+    callback(utils::makeError(ApiError(500, errorCode, errorMessage), requestId));
+    return;
+  }
+
+  collectionOrderCache_.invalidate(collectionIdNum);
+
+  Json::Value data(Json::objectValue);
+  data["collectionId"] = Json::Int64(collectionIdNum);
+  data["reordered"] = static_cast<int>(postIds.size());
+
+  callback(utils::makeSuccess(data, requestId, 200, "collection reordered"));
+}
+
 void CollectionController::listPostCollections(const drogon::HttpRequestPtr& req,
                                                std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                                                const std::string& postId) const {
@@ -330,13 +550,10 @@ void CollectionController::listPostCollections(const drogon::HttpRequestPtr& req
       return;
     }
 
-    std::optional<Post> prev;
-    std::optional<Post> next;
-    int currentPosition = 0;
+    CollectionNavigation nav;
     std::string navErrorCode;
     std::string navErrorMessage;
-    if (!collectionRepository_.getCollectionPostNeighbors(
-            collectionIdNum, postIdNum, prev, next, currentPosition, navErrorCode, navErrorMessage)) {
+    if (!collectionOrderCache_.navigation(collectionIdNum, postIdNum, nav, navErrorCode, navErrorMessage)) {
       if (navErrorCode == "POST_NOT_IN_COLLECTION") {
         callback(utils::makeError(ApiError(404, navErrorCode, navErrorMessage), requestId));
         return;
@@ -347,9 +564,10 @@ void CollectionController::listPostCollections(const drogon::HttpRequestPtr& req
 
     navigation = Json::Value(Json::objectValue);
     navigation["collectionId"] = Json::Int64(collectionIdNum);
-    navigation["currentPosition"] = currentPosition;
-    navigation["prev"] = prev.has_value() ? postToJson(*prev) : Json::Value(Json::nullValue);
-    navigation["next"] = next.has_value() ? postToJson(*next) : Json::Value(Json::nullValue);
+    navigation["currentPosition"] = nav.position;
+    navigation["total"] = nav.total;
+    navigation["prev"] = neighborToJson(nav.prev);
+    navigation["next"] = neighborToJson(nav.next);
   }
 
   Json::Value data(Json::objectValue);
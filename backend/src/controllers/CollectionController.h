@@ -2,10 +2,10 @@
 
 #include <drogon/drogon.h>
 
-#include "auth/JwtService.h"
+#include "repositories/CollectionOrderCache.h"
 #include "repositories/CollectionRepository.h"
+#include "repositories/InteractionWriteBuffer.h"
 #include "repositories/PostRepository.h"
-#include "repositories/UserRepository.h"
 
 namespace blog {
 
@@ -13,8 +13,8 @@ class CollectionController {
  public:
   CollectionController(const CollectionRepository& collectionRepository,
                        const PostRepository& postRepository,
-                       const UserRepository& userRepository,
-                       const JwtService& jwtService);
+                       const InteractionWriteBuffer& interactionWriteBuffer,
+                       CollectionOrderCache& collectionOrderCache);
 
   void createCollection(const drogon::HttpRequestPtr& req,
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
@@ -30,11 +30,24 @@ class CollectionController {
                            std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                            const std::string& collectionId) const;
 
+  void addPostsToCollection(const drogon::HttpRequestPtr& req,
+                            std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                            const std::string& collectionId) const;
+
+  void reorderCollection(const drogon::HttpRequestPtr& req,
+                         std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                         const std::string& collectionId) const;
+
   void removePostFromCollection(const drogon::HttpRequestPtr& req,
                                 std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                                 const std::string& collectionId,
                                 const std::string& postId) const;
 
+  void moveCollectionPost(const drogon::HttpRequestPtr& req,
+                          std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                          const std::string& collectionId,
+                          const std::string& postId) const;
+
   void listPostCollections(const drogon::HttpRequestPtr& req,
                            std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                            const std::string& postId) const;
@@ -42,12 +55,11 @@ class CollectionController {
  private:
   const CollectionRepository& collectionRepository_;
   const PostRepository& postRepository_;
-  const UserRepository& userRepository_;
-  const JwtService& jwtService_;
+  const InteractionWriteBuffer& interactionWriteBuffer_;
+  CollectionOrderCache& collectionOrderCache_;
 
-  Json::Value collectionToJson(const Collection& collection) const;
-  Json::Value postToJson(const Post& post) const;
   Json::Value membershipToJson(const PostCollectionMembership& membership) const;
+  Json::Value neighborToJson(const std::optional<CollectionNeighbor>& neighbor) const;
 };
 
 }  // namespace blog
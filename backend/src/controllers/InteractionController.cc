@@ -1,83 +1,90 @@
 #include "controllers/InteractionController.h"
 
+#include <optional>
+
+#include "controllers/ModelJson.h"
+#include "controllers/PostStatsJson.h"
 #include "middleware/AuthMiddleware.h"
 #include "utils/JsonResponse.h"
 #include "utils/Validation.h"
 
 namespace blog {
+namespace {
 
-InteractionController::InteractionController(const InteractionRepository& interactionRepository,
-                                             const PostRepository& postRepository,
-                                             const UserRepository& userRepository,
-                                             const JwtService& jwtService)
-    : interactionRepository_(interactionRepository),
-      postRepository_(postRepository),
-      userRepository_(userRepository),
-      jwtService_(jwtService) {}
-
-Json::Value InteractionController::summaryToJson(const PostInteractionSummary& summary) const {
-  Json::Value value(Json::objectValue);
-  value["likeCount"] = summary.likeCount;
-  value["favoriteCount"] = summary.favoriteCount;
-  value["commentCount"] = summary.commentCount;
-  value["likedByMe"] = summary.likedByMe;
-  value["favoritedByMe"] = summary.favoritedByMe;
-  return value;
-}
+constexpr size_t kMaxCursorTimestampLength = 32;
 
-Json::Value InteractionController::commentToJson(const Comment& comment) const {
-  Json::Value value(Json::objectValue);
-  value["id"] = Json::Int64(comment.id);
-  value["postId"] = Json::Int64(comment.postId);
-  value["userId"] = Json::Int64(comment.userId);
-  value["username"] = comment.username;
-  value["content"] = comment.content;
-  value["createdAt"] = comment.createdAt;
-  value["updatedAt"] = comment.updatedAt;
-  value["isDeleted"] = comment.isDeleted;
-  return value;
+// Cursors are "<created_at>_<id>" of the last comment on the previous page.
+std::string encodeCommentCursor(const Comment& comment) {
+  return comment.createdAt + "_" + std::to_string(comment.id);
 }
 
-Json::Value InteractionController::postToJson(const Post& post) const {
-  Json::Value value(Json::objectValue);
-  value["id"] = Json::Int64(post.id);
-  value["title"] = post.title;
-  value["contentMarkdown"] = post.contentMarkdown;
-  value["authorId"] = Json::Int64(post.authorId);
-  value["authorUsername"] = post.authorUsername;
-  value["createdAt"] = post.createdAt;
-  value["updatedAt"] = post.updatedAt;
-  if (!post.favoritedAt.empty()) {
-    value["favoritedAt"] = post.favoritedAt;
-  }
-  value["isDeleted"] = post.isDeleted;
-  return value;
-}
+void writeCommentItems(utils::JsonWriter& writer, const std::vector<Comment>& comments) {
+  size_t estimate = 0;
+  for (const auto& comment : comments) {
+    estimate += 256 + comment.username.size() + comment.content.size();
+  }
+  writer.reserveMore(estimate);
 
-bool InteractionController::tryReadOptionalAuthUserId(const drogon::HttpRequestPtr& req,
-                                                      std::optional<int64_t>& userId) const {
-  userId.reset();
-  const std::string auth = req->getHeader("Authorization");
-  if (auth.rfind("Bearer ", 0) != 0) {
-    return true;
+  writer.beginArray();
+  for (const auto& comment : comments) {
+    writeComment(writer, comment);
   }
+  writer.endArray();
+}
 
-  const std::string token = auth.substr(7);
-  TokenPayload payload;
-  std::string errorCode;
-  std::string errorMessage;
-  if (!jwtService_.verifyAccessToken(token, payload, errorCode, errorMessage)) {
-    return true;
+bool decodeCommentCursor(const std::string& raw, CommentCursor& cursor) {
+  const auto separator = raw.rfind('_');
+  if (separator == std::string::npos || separator == 0 || separator > kMaxCursorTimestampLength) {
+    return false;
+  }
+  if (!utils::parsePositiveInt64(raw.substr(separator + 1), cursor.id)) {
+    return false;
   }
+  cursor.createdAt = raw.substr(0, separator);
+  return true;
+}
 
-  const auto user = userRepository_.findById(payload.userId);
-  if (!user.has_value() || user->isBanned) {
-    return true;
+// Thread cursors are the materialized path of the last comment returned.
+bool isCommentPath(const std::string& raw) {
+  constexpr size_t kSegmentLength = 11;
+  if (raw.empty() || raw.size() % kSegmentLength != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < raw.size(); ++i) {
+    const bool separator = i % kSegmentLength == kSegmentLength - 1;
+    if (separator ? raw[i] != '/' : (raw[i] < '0' || raw[i] > '9')) {
+      return false;
+    }
   }
-  userId = user->id;
   return true;
 }
 
+}  // namespace
+
+InteractionController::InteractionController(const InteractionRepository& interactionRepository,
+                                             InteractionWriteBuffer& interactionWriteBuffer,
+                                             CommentPageCache& commentPageCache,
+                                             const PostRepository& postRepository)
+    : interactionRepository_(interactionRepository),
+      interactionWriteBuffer_(interactionWriteBuffer),
+      commentPageCache_(commentPageCache),
+      postRepository_(postRepository) {}
+
+Json::Value InteractionController::toggleResultToJson(const PostInteractionSummary& summary) const {
+  Json::Value value = interactionSummaryToJson(summary);
+  Json::Value persistence(Json::objectValue);
+  if (interactionWriteBuffer_.writeBehind()) {
+    persistence["mode"] = "write_behind";
+    persistence["durable"] = false;
+    persistence["flushWithinMs"] = interactionWriteBuffer_.flushIntervalMs();
+  } else {
+    persistence["mode"] = "sync";
+    persistence["durable"] = true;
+  }
+  value["persistence"] = persistence;
+  return value;
+}
+
 bool InteractionController::ensureActivePost(
     int64_t postId, const std::string& requestId, std::function<void(const drogon::HttpResponsePtr&)>& callback) const {
   const auto post = postRepository_.findById(postId, false);
@@ -104,16 +111,15 @@ void InteractionController::getPostInteractions(
     return;
   }
 
-  std::optional<int64_t> currentUserId;
-  tryReadOptionalAuthUserId(req, currentUserId);
+  const std::optional<int64_t> currentUserId = AuthMiddleware::currentUserId(req);
 
   PostInteractionSummary summary;
   std::string errorMessage;
-  if (!interactionRepository_.getPostInteractionSummary(postIdNum, currentUserId, summary, errorMessage)) {
+  if (!interactionWriteBuffer_.getSummary(postIdNum, currentUserId, summary, errorMessage)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", errorMessage), requestId));
     return;
   }
-  callback(utils::makeSuccess(summaryToJson(summary), requestId));
+  callback(utils::makeSuccess(interactionSummaryToJson(summary), requestId));
 }
 
 void InteractionController::likePost(const drogon::HttpRequestPtr& req,
@@ -131,23 +137,24 @@ void InteractionController::likePost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
 
   std::string dbError;
-  if (!interactionRepository_.setLike(postIdNum, authUser.id, true, dbError)) {
+  const InteractionToggle toggle{InteractionKind::Like, postIdNum, authUser.id, true};
+  if (!interactionWriteBuffer_.setToggle(toggle, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
 
   PostInteractionSummary summary;
-  if (!interactionRepository_.getPostInteractionSummary(postIdNum, authUser.id, summary, dbError)) {
+  if (!interactionWriteBuffer_.getSummary(postIdNum, authUser.id, summary, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
-  callback(utils::makeSuccess(summaryToJson(summary), requestId, 200, "liked"));
+  callback(utils::makeSuccess(toggleResultToJson(summary), requestId, 200, "liked"));
 }
 
 void InteractionController::unlikePost(const drogon::HttpRequestPtr& req,
@@ -165,23 +172,24 @@ void InteractionController::unlikePost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
 
   std::string dbError;
-  if (!interactionRepository_.setLike(postIdNum, authUser.id, false, dbError)) {
+  const InteractionToggle toggle{InteractionKind::Like, postIdNum, authUser.id, false};
+  if (!interactionWriteBuffer_.setToggle(toggle, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
 
   PostInteractionSummary summary;
-  if (!interactionRepository_.getPostInteractionSummary(postIdNum, authUser.id, summary, dbError)) {
+  if (!interactionWriteBuffer_.getSummary(postIdNum, authUser.id, summary, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
-  callback(utils::makeSuccess(summaryToJson(summary), requestId, 200, "unliked"));
+  callback(utils::makeSuccess(toggleResultToJson(summary), requestId, 200, "unliked"));
 }
 
 void InteractionController::favoritePost(const drogon::HttpRequestPtr& req,
@@ -199,23 +207,24 @@ void InteractionController::favoritePost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
 
   std::string dbError;
-  if (!interactionRepository_.setFavorite(postIdNum, authUser.id, true, dbError)) {
+  const InteractionToggle toggle{InteractionKind::Favorite, postIdNum, authUser.id, true};
+  if (!interactionWriteBuffer_.setToggle(toggle, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
 
   PostInteractionSummary summary;
-  if (!interactionRepository_.getPostInteractionSummary(postIdNum, authUser.id, summary, dbError)) {
+  if (!interactionWriteBuffer_.getSummary(postIdNum, authUser.id, summary, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
-  callback(utils::makeSuccess(summaryToJson(summary), requestId, 200, "favorited"));
+  callback(utils::makeSuccess(toggleResultToJson(summary), requestId, 200, "favorited"));
 }
 
 void InteractionController::unfavoritePost(const drogon::HttpRequestPtr& req,
@@ -233,23 +242,24 @@ void InteractionController::unfavoritePost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
 
   std::string dbError;
-  if (!interactionRepository_.setFavorite(postIdNum, authUser.id, false, dbError)) {
+  const InteractionToggle toggle{InteractionKind::Favorite, postIdNum, authUser.id, false};
+  if (!interactionWriteBuffer_.setToggle(toggle, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
 
   PostInteractionSummary summary;
-  if (!interactionRepository_.getPostInteractionSummary(postIdNum, authUser.id, summary, dbError)) {
+  if (!interactionWriteBuffer_.getSummary(postIdNum, authUser.id, summary, dbError)) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
-  callback(utils::makeSuccess(summaryToJson(summary), requestId, 200, "unfavorited"));
+  callback(utils::makeSuccess(toggleResultToJson(summary), requestId, 200, "unfavorited"));
 }
 
 void InteractionController::listMyFavorites(const drogon::HttpRequestPtr& req,
@@ -258,7 +268,7 @@ void InteractionController::listMyFavorites(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -296,20 +306,26 @@ void InteractionController::listMyFavorites(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& post : posts) {
-    items.append(postToJson(post));
+  PostStatsMap stats;
+  const bool withStats = utils::includeRequested(req, "stats");
+  if (withStats && !loadPostStats(interactionWriteBuffer_, posts, authUser.id, stats, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-  data["page"] = pagination.page;
-  data["pageSize"] = pagination.pageSize;
-  data["total"] = total;
-  data["q"] = query;
-  data["order"] = order;
-
-  callback(utils::makeSuccess(data, requestId));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items");
+        writePostItems(writer, posts, withStats ? &stats : nullptr);
+        writer.field("page", pagination.page);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        writer.field("q", query);
+        writer.field("order", order);
+        writer.endObject();
+      },
+      requestId));
 }
 
 void InteractionController::listComments(const drogon::HttpRequestPtr& req,
@@ -333,25 +349,156 @@ void InteractionController::listComments(const drogon::HttpRequestPtr& req,
     return;
   }
 
+  // A "cursor" parameter (empty for the first page) selects keyset paging;
+  // without it the page/offset form is kept for existing clients.
+  const auto& parameters = req->getParameters();
+  const auto cursorParam = parameters.find("cursor");
+  const bool keyset = cursorParam != parameters.end();
+  std::optional<CommentCursor> after;
+  if (keyset && !cursorParam->second.empty()) {
+    CommentCursor cursor;
+    if (!decodeCommentCursor(cursorParam->second, cursor)) {
+      callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid cursor"), requestId));
+      return;
+    }
+    after = cursor;
+  }
+
   std::vector<Comment> comments;
+  bool hasMore = false;
   int total = 0;
   std::string dbError;
-  if (!interactionRepository_.listComments(postIdNum, pagination.page, pagination.pageSize, comments, total, dbError)) {
+  bool ok = false;
+  if (keyset ? !after.has_value() : pagination.page == 1) {
+    ok = commentPageCache_.firstPage(postIdNum, pagination.pageSize, comments, hasMore, total, dbError);
+  } else if (keyset) {
+    ok = interactionRepository_.listCommentsPage(postIdNum, after, pagination.pageSize + 1, comments, dbError) &&
+         interactionRepository_.countComments(postIdNum, total, dbError);
+    if (ok && comments.size() > static_cast<size_t>(pagination.pageSize)) {
+      comments.pop_back();
+      hasMore = true;
+    }
+  } else {
+    ok = interactionRepository_.listComments(postIdNum, pagination.page, pagination.pageSize, comments, total, dbError);
+  }
+  if (!ok) {
     callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& comment : comments) {
-    items.append(commentToJson(comment));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items");
+        writeCommentItems(writer, comments);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        if (!keyset) {
+          writer.field("page", pagination.page);
+        } else if (hasMore && !comments.empty()) {
+          writer.field("nextCursor", encodeCommentCursor(comments.back()));
+        } else {
+          writer.key("nextCursor").null();
+        }
+        writer.endObject();
+      },
+      requestId));
+}
+
+void InteractionController::listCommentThread(const drogon::HttpRequestPtr& req,
+                                              std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                                              const std::string& postId) const {
+  const std::string requestId = utils::getRequestId(req);
+  int64_t postIdNum = 0;
+  if (!utils::parsePositiveInt64(postId, postIdNum)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid post id"), requestId));
+    return;
+  }
+  if (!ensureActivePost(postIdNum, requestId, callback)) {
+    return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-  data["page"] = pagination.page;
-  data["pageSize"] = pagination.pageSize;
-  data["total"] = total;
-  callback(utils::makeSuccess(data, requestId));
+  // `total` counts live comments, like replyCount on the replies endpoint;
+  // deleted placeholders that still anchor replies appear in items but are
+  // not counted.
+  int total = 0;
+  std::string dbError;
+  if (!interactionRepository_.countComments(postIdNum, total, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
+  }
+  respondWithCommentTree(req, callback, requestId, postIdNum, "", total);
+}
+
+void InteractionController::listCommentReplies(const drogon::HttpRequestPtr& req,
+                                               std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                                               const std::string& commentId) const {
+  const std::string requestId = utils::getRequestId(req);
+  int64_t commentIdNum = 0;
+  if (!utils::parsePositiveInt64(commentId, commentIdNum)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid comment id"), requestId));
+    return;
+  }
+
+  // A deleted comment still anchors its live replies.
+  const auto root = interactionRepository_.findCommentById(commentIdNum, true);
+  if (!root.has_value() || (root->isDeleted && root->replyCount == 0)) {
+    callback(utils::makeError(ApiError(404, "COMMENT_NOT_FOUND", "comment not found"), requestId));
+    return;
+  }
+  if (!ensureActivePost(root->postId, requestId, callback)) {
+    return;
+  }
+  respondWithCommentTree(req, callback, requestId, root->postId, root->path, root->replyCount);
+}
+
+void InteractionController::respondWithCommentTree(const drogon::HttpRequestPtr& req,
+                                                   std::function<void(const drogon::HttpResponsePtr&)>& callback,
+                                                   const std::string& requestId,
+                                                   int64_t postId,
+                                                   const std::string& rootPath,
+                                                   int total) const {
+  ApiError validationError(400, "VALIDATION_ERROR", "invalid pagination");
+  bool paginationOk = false;
+  const auto pagination = utils::readPagination(req, 20, 100, validationError, paginationOk);
+  if (!paginationOk) {
+    callback(utils::makeError(validationError, requestId));
+    return;
+  }
+
+  const std::string cursor = req->getParameter("cursor");
+  if (!cursor.empty() && !isCommentPath(cursor)) {
+    callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid cursor"), requestId));
+    return;
+  }
+
+  std::vector<Comment> comments;
+  std::string dbError;
+  if (!interactionRepository_.listCommentTree(postId, rootPath, cursor, pagination.pageSize + 1, comments, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
+  }
+  const bool hasMore = comments.size() > static_cast<size_t>(pagination.pageSize);
+  if (hasMore) {
+    comments.pop_back();
+  }
+
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items");
+        writeCommentItems(writer, comments);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        writer.key("nextCursor");
+        if (hasMore) {
+          writer.value(comments.back().path);
+        } else {
+          writer.null();
+        }
+        writer.endObject();
+      },
+      requestId));
 }
 
 void InteractionController::createComment(const drogon::HttpRequestPtr& req,
@@ -369,7 +516,7 @@ void InteractionController::createComment(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -386,13 +533,41 @@ void InteractionController::createComment(const drogon::HttpRequestPtr& req,
     return;
   }
 
+  std::optional<int64_t> parentId;
+  const Json::Value& parentRaw = (*body)["parentId"];
+  if (!parentRaw.isNull()) {
+    int64_t parsed = 0;
+    if (parentRaw.isInt64()) {
+      parsed = parentRaw.asInt64();
+    } else if (parentRaw.isString()) {
+      utils::parsePositiveInt64(parentRaw.asString(), parsed);
+    }
+    if (parsed <= 0) {
+      callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "invalid parentId"), requestId));
+      return;
+    }
+    parentId = parsed;
+  }
+
   Comment created;
-  std::string dbError;
-  if (!interactionRepository_.createComment(postIdNum, authUser.id, content, created, dbError)) {
-    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+  std::string errorCode;
+  std::string errorMessage;
+  if (!interactionRepository_.createComment(
+          postIdNum, authUser.id, content, parentId, created, errorCode, errorMessage)) {
+    if (errorCode == "COMMENT_NOT_FOUND") {
+      callback(utils::makeError(ApiError(404, errorCode, errorMessage), requestId));
+      return;
+    }
+    if (errorCode == "VALIDATION_ERROR") {
+      callback(utils::makeError(ApiError(400, errorCode, errorMessage), requestId));
+      return;
+    }
+    callback(utils::makeError(ApiError(500, errorCode, errorMessage), requestId));
     return;
   }
-  callback(utils::makeSuccess(commentToJson(created), requestId, 201, "comment created"));
+  commentPageCache_.invalidate(postIdNum);
+  callback(utils::makeSuccessWith([&](utils::JsonWriter& writer) { writeComment(writer, created); },
+                                  requestId, 201, "comment created"));
 }
 
 void InteractionController::deleteComment(const drogon::HttpRequestPtr& req,
@@ -407,7 +582,7 @@ void InteractionController::deleteComment(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -422,15 +597,17 @@ void InteractionController::deleteComment(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  std::string dbError;
-  if (!interactionRepository_.softDeleteComment(commentIdNum, dbError)) {
-    if (dbError == "comment not found") {
-      callback(utils::makeError(ApiError(404, "COMMENT_NOT_FOUND", "comment not found"), requestId));
+  std::string errorCode;
+  std::string errorMessage;
+  if (!interactionRepository_.softDeleteComment(commentIdNum, errorCode, errorMessage)) {
+    if (errorCode == "COMMENT_NOT_FOUND") {
+      callback(utils::makeError(ApiError(404, errorCode, errorMessage), requestId));
       return;
     }
-    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    callback(utils::makeError(ApiError(500, errorCode, errorMessage), requestId));
     return;
   }
+  commentPageCache_.invalidate(existing->postId);
 
   Json::Value data(Json::objectValue);
   data["deleted"] = true;
@@ -4,19 +4,19 @@
 
 #include <optional>
 
-#include "auth/JwtService.h"
+#include "repositories/CommentPageCache.h"
 #include "repositories/InteractionRepository.h"
+#include "repositories/InteractionWriteBuffer.h"
 #include "repositories/PostRepository.h"
-#include "repositories/UserRepository.h"
 
 namespace blog {
 
 class InteractionController {
  public:
   InteractionController(const InteractionRepository& interactionRepository,
-                        const PostRepository& postRepository,
-                        const UserRepository& userRepository,
-                        const JwtService& jwtService);
+                        InteractionWriteBuffer& interactionWriteBuffer,
+                        CommentPageCache& commentPageCache,
+                        const PostRepository& postRepository);
 
   void getPostInteractions(const drogon::HttpRequestPtr& req,
                            std::function<void(const drogon::HttpResponsePtr&)>&& callback,
@@ -45,6 +45,16 @@ class InteractionController {
                     std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                     const std::string& postId) const;
 
+  // Whole discussion in thread order, paged by materialized path.
+  void listCommentThread(const drogon::HttpRequestPtr& req,
+                         std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                         const std::string& postId) const;
+
+  // Every reply below one comment, at any depth, in thread order.
+  void listCommentReplies(const drogon::HttpRequestPtr& req,
+                          std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                          const std::string& commentId) const;
+
   void createComment(const drogon::HttpRequestPtr& req,
                      std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                      const std::string& postId) const;
@@ -55,15 +65,19 @@ class InteractionController {
 
  private:
   const InteractionRepository& interactionRepository_;
+  InteractionWriteBuffer& interactionWriteBuffer_;
+  CommentPageCache& commentPageCache_;
   const PostRepository& postRepository_;
-  const UserRepository& userRepository_;
-  const JwtService& jwtService_;
 
-  Json::Value summaryToJson(const PostInteractionSummary& summary) const;
-  Json::Value commentToJson(const Comment& comment) const;
-  Json::Value postToJson(const Post& post) const;
+  Json::Value toggleResultToJson(const PostInteractionSummary& summary) const;
+
+  void respondWithCommentTree(const drogon::HttpRequestPtr& req,
+                              std::function<void(const drogon::HttpResponsePtr&)>& callback,
+                              const std::string& requestId,
+                              int64_t postId,
+                              const std::string& rootPath,
+                              int total) const;
 
-  bool tryReadOptionalAuthUserId(const drogon::HttpRequestPtr& req, std::optional<int64_t>& userId) const;
   bool ensureActivePost(int64_t postId, const std::string& requestId,
                         std::function<void(const drogon::HttpResponsePtr&)>& callback) const;
 };
@@ -0,0 +1,102 @@
+#include "controllers/InteractionSocketController.h"
+
+#include <json/json.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace blog {
+namespace {
+
+// Large enough for any valid subscribe message.
+constexpr size_t kMaxMessageBytes = 16 * 1024;
+constexpr size_t kMaxPostIdsPerMessage = 100;
+constexpr auto kPingInterval = std::chrono::seconds(30);
+
+std::string writeCompact(const Json::Value& value) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, value);
+}
+
+void sendError(const drogon::WebSocketConnectionPtr& conn, const std::string& message) {
+  Json::Value value(Json::objectValue);
+  value["type"] = "error";
+  value["message"] = message;
+  conn->send(writeCompact(value));
+}
+
+bool parsePostIds(const Json::Value& raw, std::vector<int64_t>& postIds) {
+  if (!raw.isArray() || raw.empty() || raw.size() > kMaxPostIdsPerMessage) {
+    return false;
+  }
+  for (const auto& item : raw) {
+    if (!item.isInt64() || item.asInt64() <= 0) {
+      return false;
+    }
+    postIds.push_back(item.asInt64());
+  }
+  return true;
+}
+
+}  // namespace
+
+InteractionSocketController::InteractionSocketController(InteractionHub& interactionHub)
+    : interactionHub_(interactionHub) {}
+
+void InteractionSocketController::handleNewConnection(const drogon::HttpRequestPtr& /*req*/,
+                                                      const drogon::WebSocketConnectionPtr& conn) {
+  // Pings let the server notice peers that vanished without a close frame.
+  conn->setPingMessage("", kPingInterval);
+  interactionHub_.connect(conn);
+}
+
+void InteractionSocketController::handleNewMessage(const drogon::WebSocketConnectionPtr& conn,
+                                                   std::string&& message,
+                                                   const drogon::WebSocketMessageType& type) {
+  if (type != drogon::WebSocketMessageType::Text) {
+    return;
+  }
+  if (message.size() > kMaxMessageBytes) {
+    sendError(conn, "message too large");
+    return;
+  }
+
+  Json::CharReaderBuilder readerBuilder;
+  std::string parseErrors;
+  Json::Value body;
+  std::unique_ptr<Json::CharReader> reader(readerBuilder.newCharReader());
+  if (!reader->parse(message.data(), message.data() + message.size(), &body, &parseErrors) || !body.isObject()) {
+    sendError(conn, "invalid json");
+    return;
+  }
+
+  const std::string action = body.get("type", "").asString();
+  std::vector<int64_t> postIds;
+  if ((action != "subscribe" && action != "unsubscribe") || !parsePostIds(body["postIds"], postIds)) {
+    sendError(conn, "expected {\"type\":\"subscribe\"|\"unsubscribe\",\"postIds\":[...]} with 1-100 post ids");
+    return;
+  }
+
+  if (action == "subscribe") {
+    std::string errorMessage;
+    if (!interactionHub_.subscribe(conn, postIds, errorMessage)) {
+      sendError(conn, errorMessage);
+      return;
+    }
+  } else {
+    interactionHub_.unsubscribe(conn, postIds);
+  }
+
+  Json::Value ack(Json::objectValue);
+  ack["type"] = action == "subscribe" ? "subscribed" : "unsubscribed";
+  ack["postIds"] = body["postIds"];
+  conn->send(writeCompact(ack));
+}
+
+void InteractionSocketController::handleConnectionClosed(const drogon::WebSocketConnectionPtr& conn) {
+  interactionHub_.disconnect(conn);
+}
+
+}  // namespace blog
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <drogon/WebSocketController.h>
+
+#include <string>
+
+#include "realtime/InteractionHub.h"
+
+namespace blog {
+
+// WebSocket endpoint for live interaction counts. Clients send
+//   {"type":"subscribe","postIds":[1,2]} / {"type":"unsubscribe","postIds":[1]}
+// and receive, at most once per hub tick, the current counts of the posts
+// among theirs that changed, with the number of comments added since the
+// previous frame:
+//   {"type":"counts","posts":[{"postId":1,"likeCount":3,"favoriteCount":1,
+//     "commentCount":5,"viewCount":40,"newComments":1}]}
+class InteractionSocketController : public drogon::WebSocketController<InteractionSocketController, false> {
+ public:
+  explicit InteractionSocketController(InteractionHub& interactionHub);
+
+  void handleNewMessage(const drogon::WebSocketConnectionPtr& conn,
+                        std::string&& message,
+                        const drogon::WebSocketMessageType& type) override;
+  void handleNewConnection(const drogon::HttpRequestPtr& req, const drogon::WebSocketConnectionPtr& conn) override;
+  void handleConnectionClosed(const drogon::WebSocketConnectionPtr& conn) override;
+
+  WS_PATH_LIST_BEGIN
+  WS_PATH_ADD("/ws/interactions");
+  WS_PATH_LIST_END
+
+ private:
+  InteractionHub& interactionHub_;
+};
+
+}  // namespace blog
@@ -0,0 +1,82 @@
+#include "controllers/ModelJson.h"
+
+namespace blog {
+
+void writePostFields(utils::JsonWriter& writer, const Post& post) {
+  writer.field("id", post.id);
+  writer.field("title", post.title);
+  writer.field("contentMarkdown", post.contentMarkdown);
+  writer.field("authorId", post.authorId);
+  writer.field("authorUsername", post.authorUsername);
+  writer.field("createdAt", post.createdAt);
+  writer.field("updatedAt", post.updatedAt);
+  // Only the favorites listing fills favoritedAt, only a collection fills
+  // collectionPosition.
+  if (!post.favoritedAt.empty()) {
+    writer.field("favoritedAt", post.favoritedAt);
+  }
+  writer.field("isDeleted", post.isDeleted);
+  if (post.collectionPosition > 0) {
+    writer.field("collectionPosition", post.collectionPosition);
+  }
+}
+
+void writePost(utils::JsonWriter& writer, const Post& post) {
+  writer.beginObject();
+  writePostFields(writer, post);
+  writer.endObject();
+}
+
+void writeComment(utils::JsonWriter& writer, const Comment& comment) {
+  writer.beginObject();
+  writer.field("id", comment.id);
+  writer.field("postId", comment.postId);
+  writer.field("userId", comment.userId);
+  writer.field("username", comment.username);
+  // A deleted comment is only reachable as the placeholder parent of live
+  // replies.
+  writer.field("content", comment.isDeleted ? std::string_view() : std::string_view(comment.content));
+  writer.field("createdAt", comment.createdAt);
+  writer.field("updatedAt", comment.updatedAt);
+  writer.field("isDeleted", comment.isDeleted);
+  writer.key("parentId");
+  if (comment.parentId > 0) {
+    writer.value(comment.parentId);
+  } else {
+    writer.null();
+  }
+  writer.field("depth", comment.depth);
+  writer.field("replyCount", comment.replyCount);
+  writer.endObject();
+}
+
+void writeUser(utils::JsonWriter& writer, const User& user) {
+  writer.beginObject();
+  writer.field("id", user.id);
+  writer.field("username", user.username);
+  writer.field("role", user.role);
+  writer.field("isBanned", user.isBanned);
+  writer.field("createdAt", user.createdAt);
+  writer.endObject();
+}
+
+void writeCollection(utils::JsonWriter& writer, const Collection& collection) {
+  writer.beginObject();
+  writer.field("id", collection.id);
+  writer.field("name", collection.name);
+  writer.field("description", collection.description);
+  writer.field("ownerId", collection.ownerId);
+  writer.field("ownerUsername", collection.ownerUsername);
+  writer.field("createdAt", collection.createdAt);
+  writer.field("updatedAt", collection.updatedAt);
+  writer.field("postCount", collection.postCount);
+  writer.endObject();
+}
+
+size_t estimatePostJsonBytes(const Post& post) {
+  // Fixed keys and numbers come to well under 256 bytes; text is counted as
+  // is, escaping rarely adds much.
+  return 256 + post.title.size() + post.contentMarkdown.size() + post.authorUsername.size();
+}
+
+}  // namespace blog
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+#include "models/Collection.h"
+#include "models/Comment.h"
+#include "models/Post.h"
+#include "models/User.h"
+#include "utils/JsonWriter.h"
+
+namespace blog {
+
+// Typed serialisers shared by every controller, so a model has one JSON shape
+// wherever it appears.
+
+// Writes the post's members without the braces; callers close the object
+// after appending their own members (stats, viewCount, trendingScore).
+void writePostFields(utils::JsonWriter& writer, const Post& post);
+void writePost(utils::JsonWriter& writer, const Post& post);
+
+void writeComment(utils::JsonWriter& writer, const Comment& comment);
+void writeUser(utils::JsonWriter& writer, const User& user);
+void writeCollection(utils::JsonWriter& writer, const Collection& collection);
+
+// Rough serialised size of a post, for reserving the response buffer.
+size_t estimatePostJsonBytes(const Post& post);
+
+}  // namespace blog
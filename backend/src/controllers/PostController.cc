@@ -1,5 +1,9 @@
 #include "controllers/PostController.h"
 
+#include <unordered_map>
+
+#include "controllers/ModelJson.h"
+#include "controllers/PostStatsJson.h"
 #include "middleware/AuthMiddleware.h"
 #include "utils/JsonResponse.h"
 #include "utils/Validation.h"
@@ -7,22 +11,15 @@
 namespace blog {
 
 PostController::PostController(const PostRepository& postRepository,
-                               const UserRepository& userRepository,
-                               const JwtService& jwtService)
-    : postRepository_(postRepository), userRepository_(userRepository), jwtService_(jwtService) {}
-
-Json::Value PostController::postToJson(const Post& post) const {
-  Json::Value item(Json::objectValue);
-  item["id"] = Json::Int64(post.id);
-  item["title"] = post.title;
-  item["contentMarkdown"] = post.contentMarkdown;
-  item["authorId"] = Json::Int64(post.authorId);
-  item["authorUsername"] = post.authorUsername;
-  item["createdAt"] = post.createdAt;
-  item["updatedAt"] = post.updatedAt;
-  item["isDeleted"] = post.isDeleted;
-  return item;
-}
+                               const InteractionWriteBuffer& interactionWriteBuffer,
+                               PostViewCounter& postViewCounter,
+                               const TrendingTracker& trendingTracker,
+                               PostStreamHub& postStreamHub)
+    : postRepository_(postRepository),
+      interactionWriteBuffer_(interactionWriteBuffer),
+      postViewCounter_(postViewCounter),
+      trendingTracker_(trendingTracker),
+      postStreamHub_(postStreamHub) {}
 
 void PostController::listPosts(const drogon::HttpRequestPtr& req,
                                std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
@@ -44,18 +41,112 @@ void PostController::listPosts(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& post : posts) {
-    items.append(postToJson(post));
+  PostStatsMap stats;
+  const bool withStats = utils::includeRequested(req, "stats");
+  if (withStats && !loadPostStats(interactionWriteBuffer_, posts, AuthMiddleware::currentUserId(req), stats, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-  data["page"] = pagination.page;
-  data["pageSize"] = pagination.pageSize;
-  data["total"] = total;
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items");
+        writePostItems(writer, posts, withStats ? &stats : nullptr);
+        writer.field("page", pagination.page);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        writer.endObject();
+      },
+      requestId));
+}
+
+void PostController::listTrending(const drogon::HttpRequestPtr& req,
+                                  std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
+  const std::string requestId = utils::getRequestId(req);
 
-  callback(utils::makeSuccess(data, requestId));
+  int limit = 10;
+  const std::string limitRaw = req->getParameter("limit");
+  if (!limitRaw.empty()) {
+    try {
+      limit = std::stoi(limitRaw);
+    } catch (...) {
+      limit = 0;
+    }
+    if (limit < 1 || limit > 50) {
+      callback(utils::makeError(ApiError(400, "VALIDATION_ERROR", "limit must be between 1 and 50"), requestId));
+      return;
+    }
+  }
+
+  // Over-fetch so posts deleted since they were scored can be skipped.
+  const auto ranked = trendingTracker_.top(static_cast<size_t>(limit) * 2);
+  std::vector<int64_t> ids;
+  std::unordered_map<int64_t, double> scoreById;
+  ids.reserve(ranked.size());
+  for (const auto& [postId, score] : ranked) {
+    ids.push_back(postId);
+    scoreById[postId] = score;
+  }
+
+  std::vector<Post> posts;
+  std::string dbError;
+  if (!postRepository_.listPostsByIds(ids, posts, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
+  }
+  if (posts.size() > static_cast<size_t>(limit)) {
+    posts.resize(static_cast<size_t>(limit));
+  }
+
+  PostStatsMap stats;
+  const bool withStats = utils::includeRequested(req, "stats");
+  if (withStats && !loadPostStats(interactionWriteBuffer_, posts, AuthMiddleware::currentUserId(req), stats, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
+  }
+
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items").beginArray();
+        for (const auto& post : posts) {
+          writer.reserveMore(estimatePostJsonBytes(post));
+          writer.beginObject();
+          writePostFields(writer, post);
+          writer.field("trendingScore", scoreById[post.id]);
+          if (withStats) {
+            const auto it = stats.find(post.id);
+            writer.key("stats");
+            writeInteractionSummary(writer, it != stats.end() ? it->second : PostInteractionSummary{});
+          }
+          writer.endObject();
+        }
+        writer.endArray();
+        writer.field("limit", limit);
+        writer.endObject();
+      },
+      requestId));
+}
+
+void PostController::streamPosts(const drogon::HttpRequestPtr& req,
+                                 std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
+  if (!postStreamHub_.acceptingClients()) {
+    auto resp = utils::makeError(ApiError(503, "STREAM_UNAVAILABLE", "too many open streams"), utils::getRequestId(req));
+    resp->addHeader("Retry-After", std::to_string(postStreamHub_.heartbeatSeconds()));
+    callback(resp);
+    return;
+  }
+
+  // The stream outlives this request; heartbeats keep it from idling out.
+  PostStreamHub& hub = postStreamHub_;
+  auto resp = drogon::HttpResponse::newAsyncStreamResponse(
+      [&hub](drogon::ResponseStreamPtr stream) { hub.attach(std::move(stream)); }, true);
+  resp->setContentTypeString("text/event-stream");
+  resp->addHeader("Cache-Control", "no-cache");
+  // Stops nginx from buffering the stream.
+  resp->addHeader("X-Accel-Buffering", "no");
+  callback(resp);
 }
 
 void PostController::listMyPosts(const drogon::HttpRequestPtr& req,
@@ -64,7 +155,7 @@ void PostController::listMyPosts(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -85,18 +176,24 @@ void PostController::listMyPosts(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& post : posts) {
-    items.append(postToJson(post));
+  PostStatsMap stats;
+  const bool withStats = utils::includeRequested(req, "stats");
+  if (withStats && !loadPostStats(interactionWriteBuffer_, posts, authUser.id, stats, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-  data["page"] = pagination.page;
-  data["pageSize"] = pagination.pageSize;
-  data["total"] = total;
-
-  callback(utils::makeSuccess(data, requestId));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items");
+        writePostItems(writer, posts, withStats ? &stats : nullptr);
+        writer.field("page", pagination.page);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        writer.endObject();
+      },
+      requestId));
 }
 
 void PostController::getPost(const drogon::HttpRequestPtr& req,
@@ -116,7 +213,16 @@ void PostController::getPost(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  callback(utils::makeSuccess(postToJson(*post), requestId));
+  postViewCounter_.record(id);
+  const int64_t viewCount = post->viewCount + postViewCounter_.pending(id);
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writePostFields(writer, *post);
+        writer.field("viewCount", viewCount);
+        writer.endObject();
+      },
+      requestId, 200, "success", estimatePostJsonBytes(*post) + 256));
 }
 
 void PostController::createPost(const drogon::HttpRequestPtr& req,
@@ -125,7 +231,7 @@ void PostController::createPost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -152,7 +258,8 @@ void PostController::createPost(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  callback(utils::makeSuccess(postToJson(created), requestId, 201, "post created"));
+  callback(utils::makeSuccessWith([&](utils::JsonWriter& writer) { writePost(writer, created); },
+                                  requestId, 201, "post created", estimatePostJsonBytes(created) + 256));
 }
 
 void PostController::updatePost(const drogon::HttpRequestPtr& req,
@@ -168,7 +275,7 @@ void PostController::updatePost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -211,7 +318,8 @@ void PostController::updatePost(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  callback(utils::makeSuccess(postToJson(*updated), requestId, 200, "post updated"));
+  callback(utils::makeSuccessWith([&](utils::JsonWriter& writer) { writePost(writer, *updated); },
+                                  requestId, 200, "post updated", estimatePostJsonBytes(*updated) + 256));
 }
 
 void PostController::deletePost(const drogon::HttpRequestPtr& req,
@@ -227,7 +335,7 @@ void PostController::deletePost(const drogon::HttpRequestPtr& req,
 
   RequestUser authUser;
   ApiError authError(401, "AUTH_REQUIRED", "auth required");
-  if (!AuthMiddleware::authenticate(req, jwtService_, userRepository_, authUser, authError)) {
+  if (!AuthMiddleware::currentUser(req, authUser, authError)) {
     callback(utils::makeError(authError, requestId));
     return;
   }
@@ -2,21 +2,32 @@
 
 #include <drogon/drogon.h>
 
-#include "auth/JwtService.h"
+#include "repositories/InteractionWriteBuffer.h"
 #include "repositories/PostRepository.h"
-#include "repositories/UserRepository.h"
+#include "repositories/PostViewCounter.h"
+#include "realtime/PostStreamHub.h"
+#include "repositories/TrendingTracker.h"
 
 namespace blog {
 
 class PostController {
  public:
   PostController(const PostRepository& postRepository,
-                 const UserRepository& userRepository,
-                 const JwtService& jwtService);
+                 const InteractionWriteBuffer& interactionWriteBuffer,
+                 PostViewCounter& postViewCounter,
+                 const TrendingTracker& trendingTracker,
+                 PostStreamHub& postStreamHub);
 
   void listPosts(const drogon::HttpRequestPtr& req,
                  std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
 
+  void listTrending(const drogon::HttpRequestPtr& req,
+                    std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
+
+  // Server-Sent Events: post.created / post.updated / post.deleted.
+  void streamPosts(const drogon::HttpRequestPtr& req,
+                   std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
+
   void listMyPosts(const drogon::HttpRequestPtr& req,
                    std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
 
@@ -37,10 +48,10 @@ class PostController {
 
  private:
   const PostRepository& postRepository_;
-  const UserRepository& userRepository_;
-  const JwtService& jwtService_;
-
-  Json::Value postToJson(const Post& post) const;
+  const InteractionWriteBuffer& interactionWriteBuffer_;
+  PostViewCounter& postViewCounter_;
+  const TrendingTracker& trendingTracker_;
+  PostStreamHub& postStreamHub_;
 };
 
 }  // namespace blog
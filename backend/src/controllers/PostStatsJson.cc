@@ -0,0 +1,63 @@
+#include "controllers/PostStatsJson.h"
+
+#include "controllers/ModelJson.h"
+
+namespace blog {
+
+Json::Value interactionSummaryToJson(const PostInteractionSummary& summary) {
+  Json::Value value(Json::objectValue);
+  value["likeCount"] = summary.likeCount;
+  value["favoriteCount"] = summary.favoriteCount;
+  value["commentCount"] = summary.commentCount;
+  value["viewCount"] = Json::Int64(summary.viewCount);
+  value["likedByMe"] = summary.likedByMe;
+  value["favoritedByMe"] = summary.favoritedByMe;
+  return value;
+}
+
+void writeInteractionSummary(utils::JsonWriter& writer, const PostInteractionSummary& summary) {
+  writer.beginObject();
+  writer.field("likeCount", summary.likeCount);
+  writer.field("favoriteCount", summary.favoriteCount);
+  writer.field("commentCount", summary.commentCount);
+  writer.field("viewCount", summary.viewCount);
+  writer.field("likedByMe", summary.likedByMe);
+  writer.field("favoritedByMe", summary.favoritedByMe);
+  writer.endObject();
+}
+
+bool loadPostStats(const InteractionWriteBuffer& interactionWriteBuffer,
+                   const std::vector<Post>& posts,
+                   const std::optional<int64_t>& currentUserId,
+                   PostStatsMap& stats,
+                   std::string& errorMessage) {
+  std::vector<int64_t> postIds;
+  postIds.reserve(posts.size());
+  for (const auto& post : posts) {
+    postIds.push_back(post.id);
+  }
+  return interactionWriteBuffer.getSummaries(postIds, currentUserId, stats, errorMessage);
+}
+
+void writePostItems(utils::JsonWriter& writer, const std::vector<Post>& posts, const PostStatsMap* stats) {
+  size_t estimate = 0;
+  for (const auto& post : posts) {
+    estimate += estimatePostJsonBytes(post) + (stats != nullptr ? 128 : 0);
+  }
+  writer.reserveMore(estimate);
+
+  writer.beginArray();
+  for (const auto& post : posts) {
+    writer.beginObject();
+    writePostFields(writer, post);
+    if (stats != nullptr) {
+      const auto it = stats->find(post.id);
+      writer.key("stats");
+      writeInteractionSummary(writer, it != stats->end() ? it->second : PostInteractionSummary{});
+    }
+    writer.endObject();
+  }
+  writer.endArray();
+}
+
+}  // namespace blog
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "models/Interaction.h"
+#include "models/Post.h"
+#include "repositories/InteractionWriteBuffer.h"
+#include "utils/JsonWriter.h"
+
+namespace blog {
+
+using PostStatsMap = std::unordered_map<int64_t, PostInteractionSummary>;
+
+Json::Value interactionSummaryToJson(const PostInteractionSummary& summary);
+void writeInteractionSummary(utils::JsonWriter& writer, const PostInteractionSummary& summary);
+
+// Backs ?include=stats on post listings: loads the summaries for every post on
+// the page in one query.
+bool loadPostStats(const InteractionWriteBuffer& interactionWriteBuffer,
+                   const std::vector<Post>& posts,
+                   const std::optional<int64_t>& currentUserId,
+                   PostStatsMap& stats,
+                   std::string& errorMessage);
+
+// Writes the posts as an array; with `stats`, each item carries a "stats"
+// member, zeroed for posts without interactions.
+void writePostItems(utils::JsonWriter& writer, const std::vector<Post>& posts, const PostStatsMap* stats);
+
+}  // namespace blog
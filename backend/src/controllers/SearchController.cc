@@ -1,24 +1,16 @@
 #include "controllers/SearchController.h"
 
+#include "controllers/ModelJson.h"
+#include "controllers/PostStatsJson.h"
+#include "middleware/AuthMiddleware.h"
 #include "utils/JsonResponse.h"
 #include "utils/Validation.h"
 
 namespace blog {
 
-SearchController::SearchController(const SearchRepository& searchRepository)
-    : searchRepository_(searchRepository) {}
-
-Json::Value SearchController::postToJson(const Post& post) const {
-  Json::Value item(Json::objectValue);
-  item["id"] = Json::Int64(post.id);
-  item["title"] = post.title;
-  item["contentMarkdown"] = post.contentMarkdown;
-  item["authorId"] = Json::Int64(post.authorId);
-  item["authorUsername"] = post.authorUsername;
-  item["createdAt"] = post.createdAt;
-  item["updatedAt"] = post.updatedAt;
-  return item;
-}
+SearchController::SearchController(const SearchRepository& searchRepository,
+                                   const InteractionWriteBuffer& interactionWriteBuffer)
+    : searchRepository_(searchRepository), interactionWriteBuffer_(interactionWriteBuffer) {}
 
 void SearchController::search(const drogon::HttpRequestPtr& req,
                               std::function<void(const drogon::HttpResponsePtr&)>&& callback) const {
@@ -47,19 +39,25 @@ void SearchController::search(const drogon::HttpRequestPtr& req,
     return;
   }
 
-  Json::Value items(Json::arrayValue);
-  for (const auto& post : posts) {
-    items.append(postToJson(post));
+  PostStatsMap stats;
+  const bool withStats = utils::includeRequested(req, "stats");
+  if (withStats && !loadPostStats(interactionWriteBuffer_, posts, AuthMiddleware::currentUserId(req), stats, dbError)) {
+    callback(utils::makeError(ApiError(500, "DB_ERROR", dbError), requestId));
+    return;
   }
 
-  Json::Value data(Json::objectValue);
-  data["items"] = items;
-  data["q"] = q;
-  data["page"] = pagination.page;
-  data["pageSize"] = pagination.pageSize;
-  data["total"] = total;
-
-  callback(utils::makeSuccess(data, requestId));
+  callback(utils::makeSuccessWith(
+      [&](utils::JsonWriter& writer) {
+        writer.beginObject();
+        writer.key("items");
+        writePostItems(writer, posts, withStats ? &stats : nullptr);
+        writer.field("q", q);
+        writer.field("page", pagination.page);
+        writer.field("pageSize", pagination.pageSize);
+        writer.field("total", total);
+        writer.endObject();
+      },
+      requestId));
 }
 
 }  // namespace blog
@@ -2,21 +2,21 @@
 
 #include <drogon/drogon.h>
 
+#include "repositories/InteractionWriteBuffer.h"
 #include "repositories/SearchRepository.h"
 
 namespace blog {
 
 class SearchController {
  public:
-  explicit SearchController(const SearchRepository& searchRepository);
+  SearchController(const SearchRepository& searchRepository, const InteractionWriteBuffer& interactionWriteBuffer);
 
   void search(const drogon::HttpRequestPtr& req,
               std::function<void(const drogon::HttpResponsePtr&)>&& callback) const;
 
  private:
   const SearchRepository& searchRepository_;
-
-  Json::Value postToJson(const Post& post) const;
+  const InteractionWriteBuffer& interactionWriteBuffer_;
 };
 
 }  // namespace blog
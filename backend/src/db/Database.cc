@@ -4,10 +4,121 @@
 
 #include <drogon/drogon.h>
 
+#include "tracing/RequestTrace.h"
+
 namespace blog {
+namespace {
+
+constexpr size_t kMaxIdleConnections = 8;
+constexpr int kBusyTimeoutMs = 5000;
+
+thread_local uint64_t threadStatementNanos = 0;
+
+// SQLITE_TRACE_PROFILE fires once per finished statement with its run time,
+// on the thread that stepped it. During a traced request each statement is
+// also a Db span ending now.
+int profileStatement(unsigned type, void*, void* statement, void* elapsedNanos) {
+  if (type == SQLITE_TRACE_PROFILE) {
+    const auto elapsed = static_cast<int64_t>(*static_cast<sqlite3_int64*>(elapsedNanos));
+    threadStatementNanos += static_cast<uint64_t>(elapsed);
+    if (tracing::RequestTrace* trace = tracing::currentTrace()) {
+      const int64_t end = tracing::nowNanos();
+      trace->recordStatement(end - elapsed,
+                             end,
+                             trace->keepsSpans() ? sqlite3_sql(static_cast<sqlite3_stmt*>(statement)) : nullptr);
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+uint64_t Database::takeThreadStatementNanos() {
+  const uint64_t nanos = threadStatementNanos;
+  threadStatementNanos = 0;
+  return nanos;
+}
+
+size_t Database::idleConnections() const {
+  std::lock_guard<std::mutex> lock(poolMutex_);
+  return idle_.size();
+}
+
+Database::PooledConnection::~PooledConnection() {
+  for (auto& [sql, stmt] : statements) {
+    sqlite3_finalize(stmt);
+  }
+  if (db != nullptr) {
+    sqlite3_close(db);
+  }
+}
+
+Database::Connection::Connection(const Database* owner, std::unique_ptr<PooledConnection> conn)
+    : owner_(owner), conn_(std::move(conn)) {}
+
+Database::Connection::Connection(Connection&& other) noexcept
+    : owner_(other.owner_), conn_(std::move(other.conn_)) {
+  other.owner_ = nullptr;
+}
+
+Database::Connection& Database::Connection::operator=(Connection&& other) noexcept {
+  if (this != &other) {
+    release();
+    owner_ = other.owner_;
+    conn_ = std::move(other.conn_);
+    other.owner_ = nullptr;
+  }
+  return *this;
+}
+
+Database::Connection::~Connection() {
+  release();
+}
+
+Database::Connection::operator bool() const {
+  return conn_ != nullptr;
+}
+
+sqlite3* Database::Connection::get() const {
+  return conn_ ? conn_->db : nullptr;
+}
+
+sqlite3_stmt* Database::Connection::prepare(const char* sql, std::string& error) {
+  if (!conn_) {
+    error = "connection is not open";
+    return nullptr;
+  }
+
+  const auto it = conn_->statements.find(sql);
+  if (it != conn_->statements.end()) {
+    sqlite3_reset(it->second);
+    sqlite3_clear_bindings(it->second);
+    conn_->inUse.push_back(it->second);
+    return it->second;
+  }
+
+  sqlite3_stmt* stmt = nullptr;
+  if (sqlite3_prepare_v3(conn_->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK) {
+    error = sqlite3_errmsg(conn_->db);
+    return nullptr;
+  }
+  conn_->statements.emplace(sql, stmt);
+  conn_->inUse.push_back(stmt);
+  return stmt;
+}
+
+void Database::Connection::release() {
+  if (conn_ && owner_ != nullptr) {
+    owner_->release(std::move(conn_));
+  }
+  conn_.reset();
+  owner_ = nullptr;
+}
 
 Database::Database(std::string dbPath) : dbPath_(std::move(dbPath)) {}
 
+Database::~Database() = default;
+
 const std::string& Database::path() const {
   return dbPath_;
 }
@@ -39,6 +150,8 @@ sqlite3* Database::open(std::string& error) const {
     return nullptr;
   }
 
+  sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE, &profileStatement, nullptr);
+
   std::string pragmaError;
   if (!exec(db, "PRAGMA foreign_keys = ON;", pragmaError)) {
     LOG_ERROR << "Failed to set PRAGMA foreign_keys: " << pragmaError;
@@ -50,6 +163,47 @@ sqlite3* Database::open(std::string& error) const {
   return db;
 }
 
+Database::Connection Database::acquire(std::string& error) const {
+  {
+    std::lock_guard<std::mutex> lock(poolMutex_);
+    if (!idle_.empty()) {
+      auto conn = std::move(idle_.back());
+      idle_.pop_back();
+      return Connection(this, std::move(conn));
+    }
+  }
+
+  sqlite3* db = open(error);
+  if (db == nullptr) {
+    return Connection();
+  }
+  sqlite3_busy_timeout(db, kBusyTimeoutMs);
+
+  auto conn = std::make_unique<PooledConnection>();
+  conn->db = db;
+  return Connection(this, std::move(conn));
+}
+
+void Database::release(std::unique_ptr<PooledConnection> conn) const {
+  for (sqlite3_stmt* stmt : conn->inUse) {
+    sqlite3_reset(stmt);
+  }
+  conn->inUse.clear();
+
+  if (sqlite3_get_autocommit(conn->db) == 0) {
+    LOG_WARN << "returning pooled connection with an open transaction, rolling back";
+    std::string rollbackError;
+    if (!exec(conn->db, "ROLLBACK;", rollbackError)) {
+      return;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(poolMutex_);
+  if (idle_.size() < kMaxIdleConnections) {
+    idle_.push_back(std::move(conn));
+  }
+}
+
 bool Database::exec(sqlite3* db, const std::string& sql, std::string& error) const {
   char* errMsg = nullptr;
   const int rc = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg);
@@ -2,23 +2,78 @@
 
 #include <sqlite3.h>
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace blog {
 
 class Database {
+ private:
+  struct PooledConnection;
+
  public:
+  // RAII lease on a pooled connection. Statements obtained through prepare()
+  // are cached on the connection and reset when the lease is returned.
+  class Connection {
+   public:
+    Connection() = default;
+    Connection(Connection&& other) noexcept;
+    Connection& operator=(Connection&& other) noexcept;
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+    ~Connection();
+
+    explicit operator bool() const;
+    sqlite3* get() const;
+    sqlite3_stmt* prepare(const char* sql, std::string& error);
+
+   private:
+    friend class Database;
+    Connection(const Database* owner, std::unique_ptr<PooledConnection> conn);
+
+    void release();
+
+    const Database* owner_ = nullptr;
+    std::unique_ptr<PooledConnection> conn_;
+  };
+
   explicit Database(std::string dbPath);
+  ~Database();
+
+  Database(const Database&) = delete;
+  Database& operator=(const Database&) = delete;
 
   const std::string& path() const;
 
   bool ensureParentDir(std::string& error) const;
   sqlite3* open(std::string& error) const;
+  Connection acquire(std::string& error) const;
   bool exec(sqlite3* db, const std::string& sql, std::string& error) const;
+  size_t idleConnections() const;
+
+  // Nanoseconds of SQLite statement execution on the calling thread since the
+  // previous call. Every connection from open() reports through a profile
+  // hook, so request metrics can attribute database time to a route.
+  static uint64_t takeThreadStatementNanos();
 
  private:
+  struct PooledConnection {
+    sqlite3* db = nullptr;
+    std::unordered_map<std::string, sqlite3_stmt*> statements;
+    std::vector<sqlite3_stmt*> inUse;
+
+    ~PooledConnection();
+  };
+
+  void release(std::unique_ptr<PooledConnection> conn) const;
+
   std::string dbPath_;
+  mutable std::mutex poolMutex_;
+  mutable std::vector<std::unique_ptr<PooledConnection>> idle_;
 };
 
 bool runMigrations(const Database& db,
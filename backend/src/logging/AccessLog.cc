@@ -0,0 +1,254 @@
+#include "logging/AccessLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <utility>
+
+#include "middleware/AuthMiddleware.h"
+#include "tracing/Tracer.h"
+#include "utils/FastRandom.h"
+#include "utils/JsonResponse.h"
+#include "utils/JsonWriter.h"
+
+namespace blog::logging {
+namespace {
+
+constexpr char kStartAttribute[] = "accessLog.start";
+// Flushed to the file in chunks of about this size while draining.
+constexpr size_t kBatchBytes = 64 * 1024;
+
+const char* methodName(drogon::HttpMethod method) {
+  switch (method) {
+    case drogon::Get:
+      return "GET";
+    case drogon::Post:
+      return "POST";
+    case drogon::Head:
+      return "HEAD";
+    case drogon::Put:
+      return "PUT";
+    case drogon::Delete:
+      return "DELETE";
+    case drogon::Options:
+      return "OPTIONS";
+    case drogon::Patch:
+      return "PATCH";
+    default:
+      return "OTHER";
+  }
+}
+
+void formatTime(int64_t micros, char (&out)[32]) {
+  const std::time_t seconds = static_cast<std::time_t>(micros / 1000000);
+  std::tm utc{};
+  gmtime_r(&seconds, &utc);
+  std::snprintf(out, sizeof(out), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", utc.tm_year + 1900, utc.tm_mon + 1,
+                utc.tm_mday, utc.tm_hour, utc.tm_min, utc.tm_sec, static_cast<int>((micros / 1000) % 1000));
+}
+
+void appendRecord(const AccessRecord& record, std::string& out) {
+  char time[32];
+  formatTime(record.timeMicros, time);
+
+  utils::JsonWriter writer(256 + record.path.size());
+  writer.beginObject();
+  writer.field("time", time);
+  writer.field("method", methodName(record.method));
+  writer.field("path", record.path);
+  writer.key("route");
+  if (record.route.empty()) {
+    writer.null();
+  } else {
+    writer.value(record.route);
+  }
+  writer.field("status", record.status);
+  writer.field("bytes", static_cast<int64_t>(record.bytes));
+  writer.field("durationUs", record.durationMicros);
+  writer.field("requestId", record.requestId);
+  writer.key("userId");
+  if (record.userId == 0) {
+    writer.null();
+  } else {
+    writer.value(record.userId);
+  }
+  writer.field("ip", record.ip);
+  if (record.traced) {
+    writer.key("stagesUs").beginObject();
+    for (size_t i = 0; i < tracing::kStageCount; ++i) {
+      if (record.stageMicros[i] > 0) {
+        writer.field(tracing::stageName(static_cast<tracing::Stage>(i)), record.stageMicros[i]);
+      }
+    }
+    writer.endObject();
+    writer.field("dbStatements", static_cast<int64_t>(record.dbStatements));
+  }
+  writer.endObject();
+  out += writer.str();
+  out.push_back('\n');
+}
+
+}  // namespace
+
+AccessLog::AccessLog(const AppConfig& config, metrics::MetricsRegistry& registry)
+    : enabled_(config.accessLogEnabled),
+      sample2xxPercent_(std::clamp(config.accessLogSample2xxPercent, 0, 100)),
+      slowMicros_(static_cast<int64_t>(std::max(0, config.accessLogSlowMs)) * 1000),
+      flushIntervalMs_(std::max(10, config.accessLogFlushIntervalMs)),
+      ring_(static_cast<size_t>(std::max(64, config.accessLogBufferRecords))),
+      written_(registry.counter("blog_access_log_records_total", "Access log records by outcome",
+                                {{"outcome", "written"}})),
+      dropped_(registry.counter("blog_access_log_records_total", "Access log records by outcome",
+                                {{"outcome", "dropped"}})),
+      sampledOut_(registry.counter("blog_access_log_records_total", "Access log records by outcome",
+                                   {{"outcome", "sampled_out"}})),
+      file_(config.accessLogPath,
+            static_cast<uint64_t>(std::max(0, config.accessLogMaxMegabytes)) * 1024 * 1024,
+            config.accessLogMaxFiles) {
+  registry.gaugeCallback("blog_queue_depth", "Jobs waiting in background queues", {{"queue", "access_log"}},
+                         [this]() { return static_cast<double>(ring_.size()); });
+}
+
+AccessLog::~AccessLog() {
+  stop();
+}
+
+void AccessLog::install() {
+  if (!enabled_) {
+    return;
+  }
+  drogon::app().registerPreRoutingAdvice([this](const drogon::HttpRequestPtr& req,
+                                                drogon::AdviceCallback&&,
+                                                drogon::AdviceChainCallback&& chainCallback) {
+    onRequest(req);
+    chainCallback();
+  });
+  drogon::app().registerPostHandlingAdvice(
+      [this](const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) { onResponse(req, resp); });
+}
+
+void AccessLog::start() {
+  if (!enabled_ || writer_.joinable()) {
+    return;
+  }
+  if (!file_.path().empty() && !file_.open()) {
+    LOG_ERROR << "failed to open access log " << file_.path() << ", writing it to stdout instead";
+  }
+  writer_ = std::thread([this]() { runWriter(); });
+}
+
+void AccessLog::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  file_.close();
+}
+
+void AccessLog::onRequest(const drogon::HttpRequestPtr& req) const {
+  req->attributes()->insert(kStartAttribute, std::chrono::steady_clock::now());
+}
+
+bool AccessLog::keep(int status, int64_t durationMicros) const {
+  if (status < 200 || status >= 300 || sample2xxPercent_ >= 100) {
+    return true;
+  }
+  if (slowMicros_ > 0 && durationMicros >= slowMicros_) {
+    return true;
+  }
+  return static_cast<int>(utils::threadLocalRandom() % 100) < sample2xxPercent_;
+}
+
+void AccessLog::onResponse(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) {
+  const auto now = std::chrono::steady_clock::now();
+  const auto& attributes = req->attributes();
+  const auto start = attributes->find(kStartAttribute)
+                         ? attributes->get<std::chrono::steady_clock::time_point>(kStartAttribute)
+                         : now;
+
+  AccessRecord record;
+  record.durationMicros = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+  record.status = static_cast<int>(resp->statusCode());
+  if (!keep(record.status, record.durationMicros)) {
+    sampledOut_.inc();
+    return;
+  }
+
+  record.timeMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count();
+  record.bytes = resp->getBody().size();
+  record.userId = AuthMiddleware::currentUserId(req).value_or(0);
+  record.method = req->method();
+  record.path = req->path();
+  record.route = std::string(req->getMatchedPathPattern());
+  record.requestId = utils::getRequestId(req);
+  record.ip = req->peerAddr().toIp();
+  if (const auto* trace = tracing::Tracer::find(req)) {
+    record.traced = true;
+    for (size_t i = 0; i < tracing::kStageCount; ++i) {
+      record.stageMicros[i] = trace->totalNanos(static_cast<tracing::Stage>(i)) / 1000;
+    }
+    record.dbStatements = trace->count(tracing::Stage::Db);
+  }
+
+  if (!ring_.tryPush(std::move(record))) {
+    dropped_.inc();
+    return;
+  }
+  if (ring_.size() >= ring_.capacity() / 2) {
+    wake_.notify_one();
+  }
+}
+
+void AccessLog::runWriter() {
+  std::string batch;
+  batch.reserve(kBatchBytes + 4096);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    wake_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_), [this]() {
+      return stopping_ || ring_.size() >= ring_.capacity() / 2;
+    });
+    lock.unlock();
+    drain(batch);
+    lock.lock();
+  }
+  lock.unlock();
+  // Producers are gone by the time stop() runs; take what they left.
+  drain(batch);
+}
+
+void AccessLog::drain(std::string& batch) {
+  AccessRecord record;
+  uint64_t count = 0;
+  while (ring_.tryPop(record)) {
+    appendRecord(record, batch);
+    ++count;
+    if (batch.size() >= kBatchBytes) {
+      write(batch);
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    write(batch);
+    batch.clear();
+  }
+  ring_.publishHead();
+  written_.inc(count);
+}
+
+void AccessLog::write(const std::string& batch) {
+  if (file_.isOpen()) {
+    file_.write(batch);
+    return;
+  }
+  std::fwrite(batch.data(), 1, batch.size(), stdout);
+  std::fflush(stdout);
+}
+
+}  // namespace blog::logging
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <drogon/drogon.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "app/AppConfig.h"
+#include "logging/MpscRing.h"
+#include "logging/RotatingFile.h"
+#include "metrics/MetricsRegistry.h"
+#include "tracing/RequestTrace.h"
+
+namespace blog::logging {
+
+struct AccessRecord {
+  int64_t timeMicros = 0;
+  int64_t durationMicros = 0;
+  int status = 0;
+  size_t bytes = 0;
+  // 0 for anonymous requests.
+  int64_t userId = 0;
+  drogon::HttpMethod method = drogon::Invalid;
+  std::string path;
+  std::string route;
+  std::string requestId;
+  std::string ip;
+  // Stage totals from the request's trace, when tracing is on.
+  bool traced = false;
+  std::array<int64_t, tracing::kStageCount> stageMicros{};
+  uint32_t dbStatements = 0;
+};
+
+// Writes one JSON line per request. The post-handling advice only fills an
+// AccessRecord and pushes it onto a lock-free ring; a background thread
+// drains the ring every flush interval (or once it is half full), formats
+// the batch and writes it with one call. When the ring is full the record is
+// dropped and counted rather than stalling an IO thread.
+//
+// 2xx responses faster than slowMs are kept with probability
+// sample2xxPercent; everything else is always written. With a path set, the
+// file is rotated to path.1 .. path.maxFiles once it reaches maxBytes;
+// without one, lines go to stdout next to the application log. When the
+// request was traced, its per-stage totals are included.
+class AccessLog {
+ public:
+  AccessLog(const AppConfig& config, metrics::MetricsRegistry& registry);
+  ~AccessLog();
+
+  AccessLog(const AccessLog&) = delete;
+  AccessLog& operator=(const AccessLog&) = delete;
+
+  // Registers the advices. Call right after HttpMetrics::install(), so
+  // requests answered by later pre-routing advices are logged too.
+  void install();
+  void start();
+  // Writes whatever is still queued, then closes the file.
+  void stop();
+
+ private:
+  void onRequest(const drogon::HttpRequestPtr& req) const;
+  void onResponse(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp);
+  bool keep(int status, int64_t durationMicros) const;
+  void runWriter();
+  void drain(std::string& batch);
+  void write(const std::string& batch);
+
+  const bool enabled_;
+  const int sample2xxPercent_;
+  const int64_t slowMicros_;
+  const int flushIntervalMs_;
+
+  MpscRing<AccessRecord> ring_;
+  metrics::Counter& written_;
+  metrics::Counter& dropped_;
+  metrics::Counter& sampledOut_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread writer_;
+
+  // Writer thread only; stdout while it is not open.
+  RotatingFile file_;
+};
+
+}  // namespace blog::logging
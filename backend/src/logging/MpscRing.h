@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace blog::logging {
+
+// Bounded multi-producer, single-consumer ring. Every slot carries a sequence
+// number that says whose turn it is: producers claim a position with one CAS
+// on the tail and publish the slot by bumping its sequence, so a push never
+// takes a lock and never waits for the consumer. A full ring makes tryPush()
+// fail instead of blocking; callers decide whether to drop.
+//
+// Capacity is rounded up to a power of two.
+template <typename T>
+class MpscRing {
+ public:
+  explicit MpscRing(size_t capacity) : mask_(roundUp(capacity) - 1), slots_(new Slot[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRing(const MpscRing&) = delete;
+  MpscRing& operator=(const MpscRing&) = delete;
+
+  // Any thread.
+  bool tryPush(T&& value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = std::move(value);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer thread only.
+  bool tryPop(T& out) {
+    Slot& slot = slots_[head_ & mask_];
+    const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != head_ + 1) {
+      return false;
+    }
+    out = std::move(slot.value);
+    slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Approximate; for gauges only.
+  size_t size() const {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = headPublished_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  // Consumer thread only: makes the consumed position visible to size().
+  void publishHead() { headPublished_.store(head_, std::memory_order_relaxed); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence{0};
+    T value{};
+  };
+
+  static size_t roundUp(size_t capacity) {
+    size_t rounded = 2;
+    while (rounded < capacity) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) size_t head_ = 0;
+  std::atomic<size_t> headPublished_{0};
+};
+
+}  // namespace blog::logging
@@ -0,0 +1,78 @@
+#include "logging/RotatingFile.h"
+
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+namespace blog::logging {
+
+RotatingFile::RotatingFile(std::string path, uint64_t maxBytes, int maxFiles)
+    : path_(std::move(path)), maxBytes_(maxBytes), maxFiles_(std::max(1, maxFiles)) {}
+
+RotatingFile::~RotatingFile() {
+  close();
+}
+
+bool RotatingFile::open() {
+  std::error_code error;
+  const std::filesystem::path path(path_);
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), error);
+  }
+  file_ = std::fopen(path_.c_str(), "a");
+  if (file_ == nullptr) {
+    return false;
+  }
+  const auto size = std::filesystem::file_size(path, error);
+  bytes_ = error ? 0 : static_cast<uint64_t>(size);
+  return true;
+}
+
+bool RotatingFile::isOpen() const {
+  return file_ != nullptr;
+}
+
+void RotatingFile::write(const std::string& data) {
+  if (file_ == nullptr) {
+    return;
+  }
+  std::fwrite(data.data(), 1, data.size(), file_);
+  std::fflush(file_);
+  bytes_ += data.size();
+  if (maxBytes_ > 0 && bytes_ >= maxBytes_) {
+    rotate();
+  }
+}
+
+void RotatingFile::close() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+const std::string& RotatingFile::path() const {
+  return path_;
+}
+
+void RotatingFile::rotate() {
+  close();
+
+  // path.N-1 -> path.N ... path -> path.1; rename replaces the oldest.
+  std::error_code error;
+  for (int i = maxFiles_ - 1; i >= 1; --i) {
+    std::filesystem::rename(path_ + "." + std::to_string(i), path_ + "." + std::to_string(i + 1), error);
+  }
+  std::filesystem::rename(path_, path_ + ".1", error);
+  if (error) {
+    LOG_WARN << "failed to rotate " << path_ << ": " << error.message();
+  }
+  if (!open()) {
+    LOG_ERROR << "failed to reopen " << path_ << " after rotation";
+  }
+}
+
+}  // namespace blog::logging
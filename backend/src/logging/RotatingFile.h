@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace blog::logging {
+
+// Append-only file that is renamed to path.1 .. path.maxFiles once it grows
+// past maxBytes (0 disables rotation). Owned by a single writer thread.
+class RotatingFile {
+ public:
+  RotatingFile(std::string path, uint64_t maxBytes, int maxFiles);
+  ~RotatingFile();
+
+  RotatingFile(const RotatingFile&) = delete;
+  RotatingFile& operator=(const RotatingFile&) = delete;
+
+  // Creates missing parent directories.
+  bool open();
+  bool isOpen() const;
+  void write(const std::string& data);
+  void close();
+
+  const std::string& path() const;
+
+ private:
+  void rotate();
+
+  const std::string path_;
+  const uint64_t maxBytes_;
+  const int maxFiles_;
+  std::FILE* file_ = nullptr;
+  uint64_t bytes_ = 0;
+};
+
+}  // namespace blog::logging
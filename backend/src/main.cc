@@ -1,25 +1,45 @@
 #include <drogon/drogon.h>
 #include <trantor/utils/Logger.h>
 
+#include <algorithm>
 #include <filesystem>
 
 #include "app/AppConfig.h"
+#include "app/ServerTopology.h"
 #include "auth/JwtService.h"
+#include "auth/PasswordRehasher.h"
 #include "auth/PasswordService.h"
 #include "auth/RefreshTokenService.h"
+#include "auth/TokenVersionStore.h"
 #include "controllers/AdminController.h"
 #include "controllers/AuthController.h"
 #include "controllers/CollectionController.h"
 #include "controllers/InteractionController.h"
+#include "controllers/InteractionSocketController.h"
 #include "controllers/PostController.h"
 #include "controllers/SearchController.h"
 #include "db/Database.h"
-#include "logging/RequestLogger.h"
+#include "logging/AccessLog.h"
+#include "metrics/HttpMetrics.h"
+#include "metrics/MetricsRegistry.h"
+#include "middleware/AdmissionController.h"
+#include "middleware/AuthFilter.h"
+#include "middleware/RateLimiter.h"
+#include "realtime/InteractionHub.h"
+#include "realtime/PostStreamHub.h"
 #include "repositories/PostRepository.h"
 #include "repositories/SearchRepository.h"
 #include "repositories/CollectionRepository.h"
+#include "repositories/CollectionOrderCache.h"
+#include "repositories/CommentPageCache.h"
 #include "repositories/InteractionRepository.h"
+#include "repositories/InteractionWriteBuffer.h"
+#include "repositories/PostViewCounter.h"
+#include "repositories/TrendingRepository.h"
+#include "repositories/TrendingTracker.h"
 #include "repositories/UserRepository.h"
+#include "tracing/Tracer.h"
+#include "utils/JsonResponse.h"
 #include "utils/Validation.h"
 
 namespace {
@@ -38,6 +58,25 @@ void applyLogLevel(const std::string& level) {
   }
 }
 
+blog::Argon2Params resolveArgon2Params(const blog::AppConfig& config) {
+  blog::Argon2Params params;
+  params.timeCost = static_cast<uint32_t>(std::max(1, config.argon2TimeCost));
+  params.memoryKiB = static_cast<uint32_t>(std::max(8192, config.argon2MemoryKiB));
+  params.parallelism = static_cast<uint32_t>(std::max(1, config.argon2Parallelism));
+
+  if (!config.argon2Calibrate) {
+    LOG_INFO << "argon2 params: t=" << params.timeCost << " m=" << params.memoryKiB << "KiB p=" << params.parallelism;
+    return params;
+  }
+
+  double measuredMillis = 0;
+  params = blog::PasswordService::calibrate(
+      std::max(1, config.argon2TargetMillis), params.memoryKiB, params.parallelism, measuredMillis);
+  LOG_INFO << "argon2 calibrated: t=" << params.timeCost << " m=" << params.memoryKiB << "KiB p="
+           << params.parallelism << " hash=" << measuredMillis << "ms target=" << config.argon2TargetMillis << "ms";
+  return params;
+}
+
 void addCorsHeaders(const blog::AppConfig& config, const drogon::HttpResponsePtr& resp) {
   resp->addHeader("Access-Control-Allow-Origin", config.corsAllowOrigin);
   resp->addHeader("Access-Control-Allow-Credentials", "true");
@@ -103,39 +142,135 @@ int main() {
   applyLogLevel(config.logLevel);
 
   LOG_INFO << "starting Study Blog API on port " << config.port;
+
+  blog::ServerTopology topology;
+  std::string topologyError;
+  if (!blog::ServerTopology::fromConfig(config, topology, topologyError)) {
+    LOG_ERROR << "invalid server topology: " << topologyError;
+    return 1;
+  }
+  // Before anything below starts a thread, so every worker inherits the mask.
+  topology.pinBackgroundThreads();
+  if (config.metricsPort < 0 || config.metricsPort > 65535 || config.metricsPort == config.port) {
+    LOG_ERROR << "METRICS_PORT must be 0 or a free port other than PORT";
+    return 1;
+  }
   LOG_INFO << "db path: " << config.dbPath;
 
   const blog::Database db(config.dbPath);
-  const blog::PasswordService passwordService;
+  const blog::PasswordService passwordService(resolveArgon2Params(config));
 
   if (!runSetup(config, db, passwordService)) {
     return 1;
   }
 
+  blog::metrics::MetricsRegistry metricsRegistry;
   const blog::UserRepository userRepository(db);
-  const blog::PostRepository postRepository(db);
-  const blog::SearchRepository searchRepository(db);
   const blog::CollectionRepository collectionRepository(db);
-  const blog::InteractionRepository interactionRepository(db);
+  blog::CollectionOrderCache collectionOrderCache(
+      collectionRepository,
+      static_cast<size_t>(std::max(0, config.collectionOrderCacheCollections)),
+      metricsRegistry);
+  blog::PostStreamHub postStreamHub(config);
+  const blog::PostRepository postRepository(
+      db, [&postStreamHub, &collectionOrderCache](const blog::PostEvent& event) {
+        postStreamHub.publish(event);
+        if (event.kind != blog::PostEventKind::Created) {
+          collectionOrderCache.invalidateAll();
+        }
+      });
+  const blog::SearchRepository searchRepository(db);
+  const blog::TrendingRepository trendingRepository(db);
+  blog::TrendingTracker trendingTracker(trendingRepository, config);
+  std::string trendingError;
+  if (!trendingTracker.load(trendingError)) {
+    LOG_WARN << "failed to restore trending scores, starting empty: " << trendingError;
+  }
+
+  blog::InteractionHub interactionHub(config);
+
+  const blog::InteractionRepository interactionRepository(
+      db, [&trendingTracker, &interactionHub](const blog::InteractionEvent& event) {
+        trendingTracker.record(event);
+        interactionHub.publish(event);
+      });
+  blog::PostViewCounter postViewCounter(interactionRepository);
+  blog::InteractionWriteBuffer interactionWriteBuffer(interactionRepository, postViewCounter, config);
+  blog::CommentPageCache commentPageCache(
+      interactionRepository, static_cast<size_t>(std::max(0, config.commentPageCachePosts)), metricsRegistry);
+
+  blog::TokenVersionStore tokenVersionStore(userRepository);
+  std::string tokenVersionError;
+  if (!tokenVersionStore.load(tokenVersionError)) {
+    LOG_ERROR << "failed to load token versions: " << tokenVersionError;
+    return 1;
+  }
 
-  const blog::JwtService jwtService(config);
+  const blog::JwtService jwtService(config, tokenVersionStore);
   blog::RefreshTokenService refreshTokenService(db, config);
 
-  const blog::AuthController authController(userRepository, passwordService, jwtService, refreshTokenService);
-  const blog::PostController postController(postRepository, userRepository, jwtService);
-  const blog::SearchController searchController(searchRepository);
-  const blog::AdminController adminController(userRepository, jwtService);
+  blog::PasswordRehasher passwordRehasher(passwordService, userRepository);
+
+  const blog::AuthController authController(
+      userRepository, passwordService, jwtService, refreshTokenService, tokenVersionStore, passwordRehasher);
+  const blog::PostController postController(
+      postRepository, interactionWriteBuffer, postViewCounter, trendingTracker, postStreamHub);
+  const blog::SearchController searchController(searchRepository, interactionWriteBuffer);
+  blog::RateLimiter rateLimiter(config, metricsRegistry);
+  blog::AdmissionController admissionController(config, topology.ioThreads, metricsRegistry);
+
+  const blog::AdminController adminController(userRepository, tokenVersionStore, metricsRegistry);
   const blog::CollectionController collectionController(
-      collectionRepository, postRepository, userRepository, jwtService);
+      collectionRepository, postRepository, interactionWriteBuffer, collectionOrderCache);
   const blog::InteractionController interactionController(
-      interactionRepository, postRepository, userRepository, jwtService);
-
-  blog::logging::registerRequestLogger();
+      interactionRepository, interactionWriteBuffer, commentPageCache, postRepository);
+
+  drogon::app().registerFilter(std::make_shared<blog::AuthRequiredFilter>(jwtService));
+  drogon::app().registerFilter(std::make_shared<blog::AuthOptionalFilter>(jwtService));
+  drogon::app().registerController(std::make_shared<blog::InteractionSocketController>(interactionHub));
+  const std::string authRequired = blog::AuthRequiredFilter::classTypeName();
+  const std::string authOptional = blog::AuthOptionalFilter::classTypeName();
+
+  blog::metrics::HttpMetrics httpMetrics(metricsRegistry);
+  httpMetrics.install();
+  metricsRegistry.gaugeCallback("blog_queue_depth", "Jobs waiting in background queues",
+                                {{"queue", "interaction_writes"}},
+                                [&interactionWriteBuffer]() {
+                                  return static_cast<double>(interactionWriteBuffer.pendingCount());
+                                });
+  metricsRegistry.gaugeCallback("blog_queue_depth", "Jobs waiting in background queues",
+                                {{"queue", "password_rehash"}},
+                                [&passwordRehasher]() {
+                                  return static_cast<double>(passwordRehasher.pendingCount());
+                                });
+  metricsRegistry.gaugeCallback("blog_db_idle_connections", "Pooled SQLite connections not leased", {},
+                                [&db]() { return static_cast<double>(db.idleConnections()); });
+
+  blog::tracing::Tracer tracer(config, metricsRegistry);
+  tracer.install();
+  blog::logging::AccessLog accessLog(config, metricsRegistry);
+  accessLog.install();
+
+  if (config.metricsPort > 0) {
+    // The metrics listener shares the app's routes; only the scrape endpoint
+    // may answer there, before rate limiting and admission see the request.
+    const auto metricsPort = static_cast<uint16_t>(config.metricsPort);
+    drogon::app().registerPreRoutingAdvice([metricsPort](const drogon::HttpRequestPtr& req,
+                                                         drogon::AdviceCallback&& callback,
+                                                         drogon::AdviceChainCallback&& chainCallback) {
+      if (req->localAddr().toPort() == metricsPort && req->path() != "/metrics") {
+        callback(blog::utils::makeError(blog::ApiError(404, "NOT_FOUND", "not found"),
+                                        blog::utils::getRequestId(req)));
+        return;
+      }
+      chainCallback();
+    });
+  }
 
   drogon::app().registerPreRoutingAdvice(
-      [&config](const drogon::HttpRequestPtr& req,
-                drogon::AdviceCallback&& callback,
-                drogon::AdviceChainCallback&& chainCallback) {
+      [&config, &rateLimiter, &admissionController](const drogon::HttpRequestPtr& req,
+                                                    drogon::AdviceCallback&& callback,
+                                                    drogon::AdviceChainCallback&& chainCallback) {
         if (req->method() == drogon::Options) {
           auto resp = drogon::HttpResponse::newHttpResponse();
           resp->setStatusCode(drogon::k204NoContent);
@@ -143,6 +278,30 @@ int main() {
           callback(resp);
           return;
         }
+
+        int retryAfterSeconds = 0;
+        if (!rateLimiter.allow(req, retryAfterSeconds)) {
+          auto resp = blog::utils::makeError(
+              blog::ApiError(429, "RATE_LIMITED", "too many attempts, please retry later"),
+              blog::utils::getRequestId(req));
+          resp->addHeader("Retry-After", std::to_string(retryAfterSeconds));
+          addCorsHeaders(config, resp);
+          callback(resp);
+          return;
+        }
+
+        // Handlers finish before chainCallback() returns, so the ticket
+        // holds its slot for exactly the request's service time.
+        blog::AdmissionController::Ticket ticket;
+        if (!admissionController.admit(req, ticket, retryAfterSeconds)) {
+          auto resp = blog::utils::makeError(
+              blog::ApiError(503, "OVERLOADED", "server is busy, please retry later"),
+              blog::utils::getRequestId(req));
+          resp->addHeader("Retry-After", std::to_string(retryAfterSeconds));
+          addCorsHeaders(config, resp);
+          callback(resp);
+          return;
+        }
         chainCallback();
       });
 
@@ -189,7 +348,7 @@ int main() {
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         authController.changePassword(req, std::move(callback));
       },
-      {drogon::Post});
+      {drogon::Post, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts",
@@ -197,7 +356,7 @@ int main() {
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         postController.listPosts(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authOptional});
 
   drogon::app().registerHandler(
       "/api/posts",
@@ -205,7 +364,23 @@ int main() {
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         postController.createPost(req, std::move(callback));
       },
-      {drogon::Post});
+      {drogon::Post, authRequired});
+
+  drogon::app().registerHandler(
+      "/api/posts/trending",
+      [&postController](const drogon::HttpRequestPtr& req,
+                        std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+        postController.listTrending(req, std::move(callback));
+      },
+      {drogon::Get, authOptional});
+
+  drogon::app().registerHandler(
+      "/api/posts/stream",
+      [&postController](const drogon::HttpRequestPtr& req,
+                        std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+        postController.streamPosts(req, std::move(callback));
+      },
+      {drogon::Get});
 
   drogon::app().registerHandler(
       "/api/posts/mine",
@@ -213,7 +388,7 @@ int main() {
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         postController.listMyPosts(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authRequired});
 
   drogon::app().registerHandler(
       "/api/me/posts",
@@ -221,7 +396,7 @@ int main() {
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         postController.listMyPosts(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}",
@@ -235,14 +410,14 @@ int main() {
       [&postController](const drogon::HttpRequestPtr& req,
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                         const std::string& id) { postController.updatePost(req, std::move(callback), id); },
-      {drogon::Put});
+      {drogon::Put, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}",
       [&postController](const drogon::HttpRequestPtr& req,
                         std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                         const std::string& id) { postController.deletePost(req, std::move(callback), id); },
-      {drogon::Delete});
+      {drogon::Delete, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/interactions",
@@ -251,7 +426,7 @@ int main() {
                                const std::string& postId) {
         interactionController.getPostInteractions(req, std::move(callback), postId);
       },
-      {drogon::Get});
+      {drogon::Get, authOptional});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/like",
@@ -260,7 +435,7 @@ int main() {
                                const std::string& postId) {
         interactionController.likePost(req, std::move(callback), postId);
       },
-      {drogon::Put});
+      {drogon::Put, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/like",
@@ -269,7 +444,7 @@ int main() {
                                const std::string& postId) {
         interactionController.unlikePost(req, std::move(callback), postId);
       },
-      {drogon::Delete});
+      {drogon::Delete, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/favorite",
@@ -278,7 +453,7 @@ int main() {
                                const std::string& postId) {
         interactionController.favoritePost(req, std::move(callback), postId);
       },
-      {drogon::Put});
+      {drogon::Put, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/favorite",
@@ -287,7 +462,7 @@ int main() {
                                const std::string& postId) {
         interactionController.unfavoritePost(req, std::move(callback), postId);
       },
-      {drogon::Delete});
+      {drogon::Delete, authRequired});
 
   drogon::app().registerHandler(
       "/api/me/favorites",
@@ -295,7 +470,7 @@ int main() {
                                std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         interactionController.listMyFavorites(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/comments",
@@ -313,7 +488,25 @@ int main() {
                                const std::string& postId) {
         interactionController.createComment(req, std::move(callback), postId);
       },
-      {drogon::Post});
+      {drogon::Post, authRequired});
+
+  drogon::app().registerHandler(
+      "/api/posts/{1}/comments/thread",
+      [&interactionController](const drogon::HttpRequestPtr& req,
+                               std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                               const std::string& postId) {
+        interactionController.listCommentThread(req, std::move(callback), postId);
+      },
+      {drogon::Get});
+
+  drogon::app().registerHandler(
+      "/api/comments/{1}/replies",
+      [&interactionController](const drogon::HttpRequestPtr& req,
+                               std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                               const std::string& commentId) {
+        interactionController.listCommentReplies(req, std::move(callback), commentId);
+      },
+      {drogon::Get});
 
   drogon::app().registerHandler(
       "/api/comments/{1}",
@@ -322,7 +515,7 @@ int main() {
                                const std::string& commentId) {
         interactionController.deleteComment(req, std::move(callback), commentId);
       },
-      {drogon::Delete});
+      {drogon::Delete, authRequired});
 
   drogon::app().registerHandler(
       "/api/search",
@@ -330,7 +523,7 @@ int main() {
                           std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         searchController.search(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authOptional});
 
   drogon::app().registerHandler(
       "/api/admin/users",
@@ -338,21 +531,45 @@ int main() {
                          std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         adminController.listUsers(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authRequired});
 
   drogon::app().registerHandler(
       "/api/admin/users/{1}/role",
       [&adminController](const drogon::HttpRequestPtr& req,
                          std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                          const std::string& id) { adminController.updateRole(req, std::move(callback), id); },
-      {drogon::Put});
+      {drogon::Put, authRequired});
 
   drogon::app().registerHandler(
       "/api/admin/users/{1}/ban",
       [&adminController](const drogon::HttpRequestPtr& req,
                          std::function<void(const drogon::HttpResponsePtr&)>&& callback,
                          const std::string& id) { adminController.updateBan(req, std::move(callback), id); },
-      {drogon::Put});
+      {drogon::Put, authRequired});
+
+  drogon::app().registerHandler(
+      "/api/admin/metrics",
+      [&adminController](const drogon::HttpRequestPtr& req,
+                         std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+        adminController.metrics(req, std::move(callback));
+      },
+      {drogon::Get, authRequired});
+
+  if (config.metricsPort > 0) {
+    const auto metricsPort = static_cast<uint16_t>(config.metricsPort);
+    drogon::app().registerHandler(
+        "/metrics",
+        [&adminController, metricsPort](const drogon::HttpRequestPtr& req,
+                                        std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
+          if (req->localAddr().toPort() != metricsPort) {
+            callback(blog::utils::makeError(blog::ApiError(404, "NOT_FOUND", "not found"),
+                                            blog::utils::getRequestId(req)));
+            return;
+          }
+          adminController.scrapeMetrics(req, std::move(callback));
+        },
+        {drogon::Get});
+  }
 
   drogon::app().registerHandler(
       "/api/collections",
@@ -360,7 +577,7 @@ int main() {
                               std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         collectionController.createCollection(req, std::move(callback));
       },
-      {drogon::Post});
+      {drogon::Post, authRequired});
 
   drogon::app().registerHandler(
       "/api/collections/mine",
@@ -368,7 +585,7 @@ int main() {
                               std::function<void(const drogon::HttpResponsePtr&)>&& callback) {
         collectionController.listMyCollections(req, std::move(callback));
       },
-      {drogon::Get});
+      {drogon::Get, authRequired});
 
   drogon::app().registerHandler(
       "/api/collections/{1}",
@@ -377,7 +594,7 @@ int main() {
                               const std::string& collectionId) {
         collectionController.getCollection(req, std::move(callback), collectionId);
       },
-      {drogon::Get});
+      {drogon::Get, authOptional});
 
   drogon::app().registerHandler(
       "/api/collections/{1}/posts",
@@ -386,7 +603,25 @@ int main() {
                               const std::string& collectionId) {
         collectionController.addPostToCollection(req, std::move(callback), collectionId);
       },
-      {drogon::Post});
+      {drogon::Post, authRequired});
+
+  drogon::app().registerHandler(
+      "/api/collections/{1}/posts:batch",
+      [&collectionController](const drogon::HttpRequestPtr& req,
+                              std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                              const std::string& collectionId) {
+        collectionController.addPostsToCollection(req, std::move(callback), collectionId);
+      },
+      {drogon::Post, authRequired});
+
+  drogon::app().registerHandler(
+      "/api/collections/{1}/order",
+      [&collectionController](const drogon::HttpRequestPtr& req,
+                              std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                              const std::string& collectionId) {
+        collectionController.reorderCollection(req, std::move(callback), collectionId);
+      },
+      {drogon::Put, authRequired});
 
   drogon::app().registerHandler(
       "/api/collections/{1}/posts/{2}",
@@ -396,7 +631,17 @@ int main() {
                               const std::string& postId) {
         collectionController.removePostFromCollection(req, std::move(callback), collectionId, postId);
       },
-      {drogon::Delete});
+      {drogon::Delete, authRequired});
+
+  drogon::app().registerHandler(
+      "/api/collections/{1}/posts/{2}",
+      [&collectionController](const drogon::HttpRequestPtr& req,
+                              std::function<void(const drogon::HttpResponsePtr&)>&& callback,
+                              const std::string& collectionId,
+                              const std::string& postId) {
+        collectionController.moveCollectionPost(req, std::move(callback), collectionId, postId);
+      },
+      {drogon::Put, authRequired});
 
   drogon::app().registerHandler(
       "/api/posts/{1}/collections",
@@ -407,8 +652,52 @@ int main() {
       },
       {drogon::Get});
 
-  drogon::app().setThreadNum(4);
-  drogon::app().addListener("0.0.0.0", static_cast<uint16_t>(config.port));
+  if (rateLimiter.enabled()) {
+    drogon::app().getLoop()->runEvery(static_cast<double>(rateLimiter.windowSeconds()),
+                                      [&rateLimiter]() { rateLimiter.evictIdle(); });
+  }
+
+  drogon::app().getLoop()->runEvery(static_cast<double>(std::max(1, config.viewCountFlushIntervalSeconds)),
+                                    [&postViewCounter]() {
+                                      std::string errorMessage;
+                                      if (!postViewCounter.flush(errorMessage)) {
+                                        LOG_WARN << "view count flush failed, will retry: " << errorMessage;
+                                      }
+                                    });
+  drogon::app().getLoop()->runEvery(interactionHub.tickIntervalMs() / 1000.0,
+                                    [&interactionHub, &interactionWriteBuffer]() {
+                                      interactionHub.tick(interactionWriteBuffer);
+                                    });
+  drogon::app().getLoop()->runEvery(static_cast<double>(postStreamHub.heartbeatSeconds()),
+                                    [&postStreamHub]() { postStreamHub.heartbeat(); });
+  drogon::app().getLoop()->runEvery(static_cast<double>(std::max(1, config.trendingSnapshotIntervalSeconds)),
+                                    [&trendingTracker]() {
+                                      std::string errorMessage;
+                                      if (!trendingTracker.snapshot(errorMessage)) {
+                                        LOG_WARN << "trending snapshot failed: " << errorMessage;
+                                      }
+                                    });
+
+  topology.applyToApp("0.0.0.0", static_cast<uint16_t>(config.port));
+  if (config.metricsPort > 0) {
+    drogon::app().addListener(config.metricsBindAddress, static_cast<uint16_t>(config.metricsPort));
+  }
+  drogon::app().registerBeginningAdvice([&topology]() { topology.pinIoLoops(); });
+  drogon::app().registerBeginningAdvice([&admissionController]() { admissionController.startProbes(); });
+  LOG_INFO << "server topology: " << topology.describe();
+  interactionWriteBuffer.start();
+  accessLog.start();
+  tracer.start();
   drogon::app().run();
+  interactionWriteBuffer.stop();
+  accessLog.stop();
+  tracer.stop();
+  std::string viewFlushError;
+  if (!postViewCounter.flush(viewFlushError)) {
+    LOG_ERROR << "final view count flush failed: " << viewFlushError;
+  }
+  if (!trendingTracker.snapshot(trendingError)) {
+    LOG_ERROR << "final trending snapshot failed: " << trendingError;
+  }
   return 0;
 }
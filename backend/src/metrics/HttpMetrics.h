@@ -0,0 +1,61 @@
+#pragma once
+
+#include <drogon/drogon.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "metrics/MetricsRegistry.h"
+
+namespace blog::metrics {
+
+// Per-request metrics recorded by two advices:
+// - latency per route template, method and status class;
+// - response bytes and SQLite time per route;
+// - the number of requests in flight.
+// The route table is built from drogon's handler list once, before the
+// listeners start, and is read-only afterwards, so recording a request takes
+// no lock.
+class HttpMetrics {
+ public:
+  explicit HttpMetrics(MetricsRegistry& registry);
+
+  HttpMetrics(const HttpMetrics&) = delete;
+  HttpMetrics& operator=(const HttpMetrics&) = delete;
+
+  // Call before registering any other pre-routing advice, so requests those
+  // answer themselves (preflight, rate limiting) are counted as in flight.
+  void install();
+
+ private:
+  static constexpr size_t kStatusClasses = 5;
+  static constexpr size_t kMethods = drogon::Invalid;
+
+  struct RouteSeries {
+    std::array<Histogram*, kStatusClasses> latency{};
+    Histogram* dbSeconds = nullptr;
+    Counter* responseBytes = nullptr;
+  };
+  using MethodSeries = std::array<RouteSeries*, kMethods>;
+
+  RouteSeries* makeSeries(const std::string& route, drogon::HttpMethod method);
+  void buildRouteTable();
+  const RouteSeries& seriesFor(const drogon::HttpRequestPtr& req) const;
+  void onRequest(const drogon::HttpRequestPtr& req);
+  void onResponse(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) const;
+
+  MetricsRegistry& registry_;
+  Gauge& inFlight_;
+  std::vector<std::unique_ptr<RouteSeries>> series_;
+  std::map<std::string, MethodSeries, std::less<>> routes_;
+  // Requests answered before routing, or matching no handler.
+  MethodSeries unmatched_{};
+  std::atomic<bool> routesReady_{false};
+};
+
+}  // namespace blog::metrics
@@ -0,0 +1,193 @@
+#include "metrics/MetricsRegistry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace blog::metrics {
+namespace {
+
+std::string escapeLabelValue(const std::string& value) {
+  std::string out;
+  out.reserve(value.size());
+  for (const char c : value) {
+    if (c == '\\' || c == '"') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out.push_back(c);
+    }
+  }
+  return out;
+}
+
+size_t stripeForThisThread(size_t stripes) {
+  static std::atomic<size_t> nextStripe{0};
+  thread_local const size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed);
+  return stripe % stripes;
+}
+
+// Adds `extra` (already formatted, e.g. le="0.5") to a formatLabels() string.
+std::string withLabel(const std::string& labels, const std::string& extra) {
+  if (labels.empty()) {
+    return "{" + extra + "}";
+  }
+  return labels.substr(0, labels.size() - 1) + "," + extra + "}";
+}
+
+template <typename Family>
+Family& familyFor(std::map<std::string, Family>& families, const std::string& name, const std::string& help) {
+  auto& family = families[name];
+  if (family.help.empty()) {
+    family.help = help;
+  }
+  return family;
+}
+
+}  // namespace
+
+Histogram::Histogram(std::vector<double> upperBounds) : upperBounds_(std::move(upperBounds)) {
+  std::sort(upperBounds_.begin(), upperBounds_.end());
+  if (upperBounds_.size() > kMaxBuckets) {
+    upperBounds_.resize(kMaxBuckets);
+  }
+}
+
+void Histogram::observe(double value) {
+  // A linear scan beats a binary search over a dozen bounds, and most
+  // observations land in the first few.
+  size_t bucket = 0;
+  while (bucket < upperBounds_.size() && value > upperBounds_[bucket]) {
+    ++bucket;
+  }
+  Stripe& stripe = stripes_[stripeForThisThread(kStripes)];
+  stripe.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  const double micros = std::max(0.0, value * 1e6);
+  stripe.sumMicros.fetch_add(static_cast<uint64_t>(std::llround(micros)), std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snapshot;
+  snapshot.buckets.assign(upperBounds_.size() + 1, 0);
+  uint64_t sumMicros = 0;
+  for (const auto& stripe : stripes_) {
+    for (size_t i = 0; i < snapshot.buckets.size(); ++i) {
+      const uint64_t n = stripe.buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += n;
+      snapshot.count += n;
+    }
+    sumMicros += stripe.sumMicros.load(std::memory_order_relaxed);
+  }
+  snapshot.sum = static_cast<double>(sumMicros) / 1e6;
+  return snapshot;
+}
+
+std::string formatLabels(const Labels& labels) {
+  if (labels.empty()) {
+    return "";
+  }
+  std::string out = "{";
+  for (size_t i = 0; i < labels.size(); ++i) {
+    if (i > 0) {
+      out += ",";
+    }
+    out += labels[i].first + "=\"" + escapeLabelValue(labels[i].second) + "\"";
+  }
+  out += "}";
+  return out;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slot = familyFor(counters_, name, help).series[formatLabels(labels)];
+  if (!slot) {
+    slot = std::make_unique<Counter>();
+  }
+  return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slot = familyFor(gauges_, name, help).series[formatLabels(labels)];
+  if (!slot) {
+    slot = std::make_unique<Gauge>();
+  }
+  return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name,
+                                      const std::string& help,
+                                      const std::vector<double>& upperBounds,
+                                      const Labels& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& slot = familyFor(histograms_, name, help).series[formatLabels(labels)];
+  if (!slot) {
+    slot = std::make_unique<Histogram>(upperBounds);
+  }
+  return *slot;
+}
+
+void MetricsRegistry::gaugeCallback(const std::string& name,
+                                    const std::string& help,
+                                    const Labels& labels,
+                                    std::function<double()> sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  familyFor(sampledGauges_, name, help).series[formatLabels(labels)] =
+      std::make_unique<SampledGauge>(SampledGauge{std::move(sample)});
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+  std::ostringstream out;
+  out << std::setprecision(12);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [name, family] : counters_) {
+    out << "# HELP " << name << " " << family.help << "\n";
+    out << "# TYPE " << name << " counter\n";
+    for (const auto& [labels, counter] : family.series) {
+      out << name << labels << " " << counter->value() << "\n";
+    }
+  }
+  for (const auto& [name, family] : gauges_) {
+    out << "# HELP " << name << " " << family.help << "\n";
+    out << "# TYPE " << name << " gauge\n";
+    for (const auto& [labels, gauge] : family.series) {
+      out << name << labels << " " << gauge->value() << "\n";
+    }
+  }
+  for (const auto& [name, family] : sampledGauges_) {
+    out << "# HELP " << name << " " << family.help << "\n";
+    out << "# TYPE " << name << " gauge\n";
+    for (const auto& [labels, gauge] : family.series) {
+      out << name << labels << " " << gauge->sample() << "\n";
+    }
+  }
+  for (const auto& [name, family] : histograms_) {
+    out << "# HELP " << name << " " << family.help << "\n";
+    out << "# TYPE " << name << " histogram\n";
+    for (const auto& [labels, histogram] : family.series) {
+      const auto snapshot = histogram->snapshot();
+      // Route x status series that never saw a request would dominate the
+      // output, so only series with observations are written.
+      if (snapshot.count == 0) {
+        continue;
+      }
+      const auto& bounds = histogram->upperBounds();
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < bounds.size(); ++i) {
+        cumulative += snapshot.buckets[i];
+        std::ostringstream le;
+        le << "le=\"" << bounds[i] << "\"";
+        out << name << "_bucket" << withLabel(labels, le.str()) << " " << cumulative << "\n";
+      }
+      out << name << "_bucket" << withLabel(labels, "le=\"+Inf\"") << " " << snapshot.count << "\n";
+      out << name << "_sum" << labels << " " << snapshot.sum << "\n";
+      out << name << "_count" << labels << " " << snapshot.count << "\n";
+    }
+  }
+  return out.str();
+}
+
+}  // namespace blog::metrics
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blog::metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+ public:
+  void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+class Gauge {
+ public:
+  void add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// Fixed-bucket histogram. Every recording thread is assigned one of
+// kStripes cache-line-aligned stripes and bumps it with relaxed atomics, so
+// observe() is wait-free and threads never share a line; the stripes are only
+// summed when the registry renders. The sum is kept in millionths of the
+// observed unit.
+class alignas(64) Histogram {
+ public:
+  static constexpr size_t kMaxBuckets = 24;
+
+  explicit Histogram(std::vector<double> upperBounds);
+
+  void observe(double value);
+
+  struct Snapshot {
+    // Per bucket, not cumulative; the last entry is the +Inf bucket.
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    double sum = 0;
+  };
+  Snapshot snapshot() const;
+  const std::vector<double>& upperBounds() const { return upperBounds_; }
+
+ private:
+  static constexpr size_t kStripes = 16;
+
+  struct alignas(64) Stripe {
+    std::array<std::atomic<uint64_t>, kMaxBuckets + 1> buckets;
+    std::atomic<uint64_t> sumMicros;
+  };
+
+  std::vector<double> upperBounds_;
+  std::array<Stripe, kStripes> stripes_{};
+};
+
+// Owns every metric in the process. Lookups take a lock, so callers resolve
+// their metrics once at construction and keep the returned reference; the
+// hot path only touches atomics.
+class MetricsRegistry {
+ public:
+  Counter& counter(const std::string& name, const std::string& help, const Labels& labels = {});
+  Gauge& gauge(const std::string& name, const std::string& help, const Labels& labels = {});
+  Histogram& histogram(const std::string& name,
+                       const std::string& help,
+                       const std::vector<double>& upperBounds,
+                       const Labels& labels = {});
+  // A gauge read from `sample` at render time, for values another component
+  // already tracks (queue depths, pool sizes).
+  void gaugeCallback(const std::string& name,
+                     const std::string& help,
+                     const Labels& labels,
+                     std::function<double()> sample);
+
+  std::string renderPrometheus() const;
+
+ private:
+  template <typename T>
+  struct Family {
+    std::string help;
+    std::map<std::string, std::unique_ptr<T>> series;
+  };
+
+  struct SampledGauge {
+    std::function<double()> sample;
+  };
+
+  mutable std::mutex mutex_;
+  std::map<std::string, Family<Counter>> counters_;
+  std::map<std::string, Family<Gauge>> gauges_;
+  std::map<std::string, Family<SampledGauge>> sampledGauges_;
+  std::map<std::string, Family<Histogram>> histograms_;
+};
+
+std::string formatLabels(const Labels& labels);
+
+}  // namespace blog::metrics
@@ -0,0 +1,275 @@
+#include "middleware/AdmissionController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "utils/FastRandom.h"
+
+namespace blog {
+namespace {
+
+// Latency averages: the short one reacts within ~10 requests, the baseline
+// over ~100.
+constexpr double kShortWeight = 0.1;
+constexpr double kLongWeight = 0.01;
+// Short-term latency up to this multiple of the baseline is not congestion.
+constexpr double kTolerance = 2.0;
+// Weight of each new limit estimate, so one slow request cannot halve a cap.
+constexpr double kSmoothing = 0.2;
+// Shed requests are told to come back after this many seconds. Overload at
+// this layer clears in well under that once clients back off.
+constexpr int kRetryAfterSeconds = 1;
+// Delay probes fire this often on every IO loop; the standing delay is the
+// smallest lateness seen over each window, so one slow handler does not
+// count as a queue.
+constexpr double kProbeIntervalSeconds = 0.01;
+constexpr int64_t kProbeWindowMicros = 100 * 1000;
+
+// The IO loop's probe, set on each loop thread by startProbes().
+thread_local const std::atomic<int64_t>* currentLoopDelay = nullptr;
+
+int64_t steadyMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Multiple of the target delay at which a class starts being shed: the
+// expensive classes first, reads last.
+int64_t delayFactor(AdmissionController::RouteClass routeClass) {
+  switch (routeClass) {
+    case AdmissionController::RouteClass::Writes:
+      return 2;
+    case AdmissionController::RouteClass::Reads:
+      return 4;
+    default:
+      return 1;
+  }
+}
+
+const char* className(size_t routeClass) {
+  static const char* const kNames[] = {"auth_hash", "search", "reads", "writes"};
+  return kNames[routeClass];
+}
+
+}  // namespace
+
+AdmissionController::Ticket::~Ticket() {
+  release();
+}
+
+AdmissionController::Ticket::Ticket(Ticket&& other) noexcept
+    : owner_(std::exchange(other.owner_, nullptr)),
+      routeClass_(other.routeClass_),
+      inFlightAtStart_(other.inFlightAtStart_),
+      start_(other.start_) {}
+
+AdmissionController::Ticket& AdmissionController::Ticket::operator=(Ticket&& other) noexcept {
+  if (this != &other) {
+    release();
+    owner_ = std::exchange(other.owner_, nullptr);
+    routeClass_ = other.routeClass_;
+    inFlightAtStart_ = other.inFlightAtStart_;
+    start_ = other.start_;
+  }
+  return *this;
+}
+
+void AdmissionController::Ticket::release() {
+  if (owner_ == nullptr) {
+    return;
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+  owner_->complete(routeClass_, inFlightAtStart_, elapsed.count());
+  owner_ = nullptr;
+}
+
+AdmissionController::AdmissionController(const AppConfig& config, size_t ioLoops, metrics::MetricsRegistry& metrics)
+    : enabled_(config.admissionControlEnabled), ioLoops_(std::max(1, static_cast<int>(ioLoops))) {
+  const int64_t targetDelayMicros = static_cast<int64_t>(std::max(1, config.admissionTargetDelayMs)) * 1000;
+  const int expensiveLimit =
+      std::max(1, ioLoops_ * std::clamp(config.admissionExpensiveLoopPercent, 1, 100) / 100);
+  // Keep one loop for reads and writes whenever there is more than one.
+  const int expensiveHeadroom = ioLoops_ > 1 ? 1 : 0;
+
+  for (size_t i = 0; i < kClasses; ++i) {
+    ClassState& state = classes_[i];
+    const auto routeClass = static_cast<RouteClass>(i);
+    const bool expensive = routeClass == RouteClass::AuthHash || routeClass == RouteClass::Search;
+    state.maxLimit = expensive ? expensiveLimit : ioLoops_;
+    state.minLimit = std::min(state.maxLimit, expensive ? 1 : 2);
+    state.headroom = expensive ? expensiveHeadroom : 0;
+    state.limitEstimate = state.maxLimit;
+    state.limit.store(state.maxLimit, std::memory_order_relaxed);
+    state.delayThresholdMicros = targetDelayMicros * delayFactor(routeClass);
+
+    const metrics::Labels labels = {{"class", className(i)}};
+    state.admitted = &metrics.counter("blog_admission_requests_total", "Admission decisions by route class",
+                                      {{"class", className(i)}, {"outcome", "admitted"}});
+    state.shedConcurrency = &metrics.counter("blog_admission_requests_total", "Admission decisions by route class",
+                                             {{"class", className(i)}, {"outcome", "shed_concurrency"}});
+    state.shedQueueing = &metrics.counter("blog_admission_requests_total", "Admission decisions by route class",
+                                          {{"class", className(i)}, {"outcome", "shed_queueing"}});
+    metrics.gaugeCallback("blog_admission_limit", "Current concurrency cap per route class", labels, [&state]() {
+      return static_cast<double>(state.limit.load(std::memory_order_relaxed));
+    });
+    metrics.gaugeCallback("blog_admission_in_flight", "Admitted requests being served per route class", labels,
+                          [&state]() { return static_cast<double>(state.inFlight.load(std::memory_order_relaxed)); });
+  }
+
+  for (int i = 0; i < ioLoops_; ++i) {
+    probes_.push_back(std::make_unique<LoopProbe>());
+    const LoopProbe& probe = *probes_.back();
+    metrics.gaugeCallback("blog_admission_queue_delay_seconds", "Standing queueing delay per IO loop",
+                          {{"loop", std::to_string(i)}}, [&probe]() {
+                            return static_cast<double>(probe.standingMicros.load(std::memory_order_relaxed)) / 1e6;
+                          });
+  }
+}
+
+bool AdmissionController::enabled() const {
+  return enabled_;
+}
+
+void AdmissionController::startProbes() {
+  if (!enabled_) {
+    return;
+  }
+  const size_t loops = std::min(probes_.size(), drogon::app().getThreadNum());
+  for (size_t i = 0; i < loops; ++i) {
+    trantor::EventLoop* loop = drogon::app().getIOLoop(i);
+    LoopProbe* probe = probes_[i].get();
+    loop->queueInLoop([this, loop, probe]() {
+      currentLoopDelay = &probe->standingMicros;
+      probe->windowStartMicros = steadyMicros();
+      scheduleProbe(loop, probe);
+    });
+  }
+}
+
+void AdmissionController::scheduleProbe(trantor::EventLoop* loop, LoopProbe* probe) {
+  const int64_t dueMicros = steadyMicros() + static_cast<int64_t>(kProbeIntervalSeconds * 1e6);
+  loop->runAfter(kProbeIntervalSeconds, [this, loop, probe, dueMicros]() {
+    // The timer is due with the requests that became readable alongside it,
+    // so its lateness is what a request arriving now waits for the loop.
+    const int64_t now = steadyMicros();
+    probe->windowMinMicros = std::min(probe->windowMinMicros, std::max<int64_t>(0, now - dueMicros));
+    if (now - probe->windowStartMicros >= kProbeWindowMicros) {
+      probe->standingMicros.store(probe->windowMinMicros, std::memory_order_relaxed);
+      probe->windowMinMicros = std::numeric_limits<int64_t>::max();
+      probe->windowStartMicros = now;
+    }
+    scheduleProbe(loop, probe);
+  });
+}
+
+bool AdmissionController::shedForQueueing(const ClassState& state) const {
+  if (currentLoopDelay == nullptr) {
+    return false;
+  }
+  const int64_t delay = currentLoopDelay->load(std::memory_order_relaxed);
+  if (delay <= state.delayThresholdMicros) {
+    return false;
+  }
+  // From never at the threshold to always at twice it, so shedding eases the
+  // queue gradually instead of turning a class off and on each window.
+  const uint64_t excess = static_cast<uint64_t>(delay - state.delayThresholdMicros);
+  const uint64_t threshold = static_cast<uint64_t>(state.delayThresholdMicros);
+  return excess >= threshold || utils::threadLocalRandom() % threshold < excess;
+}
+
+AdmissionController::RouteClass AdmissionController::classify(const drogon::HttpRequestPtr& req) {
+  const std::string& path = req->path();
+  if (path == "/api/posts/stream" || path.rfind("/ws/", 0) == 0 || path == "/metrics" ||
+      path == "/api/admin/metrics") {
+    return RouteClass::Exempt;
+  }
+  if (path == "/api/auth/login" || path == "/api/auth/register" || path == "/api/auth/change-password") {
+    return RouteClass::AuthHash;
+  }
+  if (path == "/api/search") {
+    return RouteClass::Search;
+  }
+  const auto method = req->method();
+  return method == drogon::Get || method == drogon::Head ? RouteClass::Reads : RouteClass::Writes;
+}
+
+bool AdmissionController::admit(const drogon::HttpRequestPtr& req, Ticket& ticket, int& retryAfterSeconds) {
+  if (!enabled_) {
+    return true;
+  }
+  const RouteClass routeClass = classify(req);
+  if (routeClass == RouteClass::Exempt) {
+    return true;
+  }
+  const auto index = static_cast<size_t>(routeClass);
+  ClassState& state = classes_[index];
+  if (shedForQueueing(state)) {
+    state.shedQueueing->inc();
+    retryAfterSeconds = kRetryAfterSeconds;
+    return false;
+  }
+
+  const int busyLoops = totalInFlight_.fetch_add(1, std::memory_order_acq_rel);
+  bool admitted = busyLoops < ioLoops_ - state.headroom;
+  int inFlight = state.inFlight.load(std::memory_order_relaxed);
+  while (admitted) {
+    if (inFlight >= state.limit.load(std::memory_order_relaxed)) {
+      admitted = false;
+    } else if (state.inFlight.compare_exchange_weak(inFlight, inFlight + 1, std::memory_order_acq_rel)) {
+      break;
+    }
+  }
+  if (!admitted) {
+    totalInFlight_.fetch_sub(1, std::memory_order_acq_rel);
+    state.shedConcurrency->inc();
+    retryAfterSeconds = kRetryAfterSeconds;
+    return false;
+  }
+
+  state.admitted->inc();
+  ticket.release();
+  ticket.owner_ = this;
+  ticket.routeClass_ = index;
+  ticket.inFlightAtStart_ = inFlight + 1;
+  ticket.start_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+void AdmissionController::complete(size_t routeClass, int inFlightAtStart, double seconds) {
+  ClassState& state = classes_[routeClass];
+  state.inFlight.fetch_sub(1, std::memory_order_acq_rel);
+  totalInFlight_.fetch_sub(1, std::memory_order_acq_rel);
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.longLatency <= 0) {
+    state.shortLatency = seconds;
+    state.longLatency = seconds;
+    return;
+  }
+  state.shortLatency += (seconds - state.shortLatency) * kShortWeight;
+  state.longLatency += (seconds - state.longLatency) * kLongWeight;
+  // Let the baseline follow latency down after a slow period, or the class
+  // would look uncongested for too long.
+  if (state.longLatency > 2 * state.shortLatency) {
+    state.longLatency *= 0.95;
+  }
+
+  const double gradient =
+      std::clamp(kTolerance * state.longLatency / std::max(state.shortLatency, 1e-9), 0.5, 1.0);
+  if (gradient >= 1.0 && inFlightAtStart * 2 < state.limitEstimate) {
+    // Not congested but not using the cap either; growing it proves nothing.
+    return;
+  }
+  // Allowing one request beyond the scaled cap lets it grow back after the
+  // gradient returns to 1.
+  const double target = state.limitEstimate * gradient + 1;
+  state.limitEstimate = std::clamp(state.limitEstimate * (1 - kSmoothing) + target * kSmoothing,
+                                   static_cast<double>(state.minLimit),
+                                   static_cast<double>(state.maxLimit));
+  state.limit.store(static_cast<int>(state.limitEstimate), std::memory_order_relaxed);
+}
+
+}  // namespace blog
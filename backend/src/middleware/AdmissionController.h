@@ -0,0 +1,127 @@
+#pragma once
+
+#include <drogon/drogon.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "app/AppConfig.h"
+#include "metrics/MetricsRegistry.h"
+
+namespace blog {
+
+// Sheds load per route class before it reaches a handler, with two signals.
+//
+// Queueing delay. Handlers run to completion on the IO loop that received
+// them, so under overload requests wait in the kernel's socket buffers, where
+// no advice can see them. Instead a timer on every loop measures how late it
+// fires; the minimum lateness over a 100 ms window is the loop's standing
+// queue, as in CoDel. Above targetDelay it sheds search and auth, above 2x
+// writes and above 4x reads, each with a probability rising from 0 at its
+// threshold to 1 at twice it, so cheap reads are the last to go.
+//
+// Concurrency. A class's concurrency is the number of loops busy with it,
+// which can never exceed the loop count, so these caps only bind below it:
+// - search and the Argon2-backed auth endpoints may use expensiveLoopPercent
+//   of the loops each, and are refused while only one loop is left idle, so a
+//   login or search burst cannot occupy the loops cheap reads need;
+// - reads and writes start at every loop, and only lose loops through the
+//   gradient rule: a short-term service time average is compared with a
+//   slowly moving baseline, and while it exceeds the baseline by the
+//   tolerance the cap shrinks towards 2, growing back once latency recovers.
+// Handlers that went async would make these caps bind as in-flight limits.
+//
+// Shed requests get an immediate 503 with Retry-After. Streaming endpoints
+// (SSE, WebSocket) and the metrics endpoints are never limited.
+class AdmissionController {
+ public:
+  enum class RouteClass : size_t { AuthHash, Search, Reads, Writes, Exempt };
+
+  // Holds one admitted request's slot; releasing it records the service
+  // time. Keep it alive around the rest of the advice chain.
+  class Ticket {
+   public:
+    Ticket() = default;
+    ~Ticket();
+    Ticket(Ticket&& other) noexcept;
+    Ticket& operator=(Ticket&& other) noexcept;
+    Ticket(const Ticket&) = delete;
+    Ticket& operator=(const Ticket&) = delete;
+
+   private:
+    friend class AdmissionController;
+    void release();
+
+    AdmissionController* owner_ = nullptr;
+    size_t routeClass_ = 0;
+    int inFlightAtStart_ = 0;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  AdmissionController(const AppConfig& config, size_t ioLoops, metrics::MetricsRegistry& metrics);
+
+  AdmissionController(const AdmissionController&) = delete;
+  AdmissionController& operator=(const AdmissionController&) = delete;
+
+  bool enabled() const;
+  // Starts the delay probes on the IO loops. Call from a beginning advice,
+  // once the loops exist.
+  void startProbes();
+
+  // False when the request should be answered with 503; retryAfterSeconds is
+  // set then.
+  bool admit(const drogon::HttpRequestPtr& req, Ticket& ticket, int& retryAfterSeconds);
+
+  static RouteClass classify(const drogon::HttpRequestPtr& req);
+
+ private:
+  static constexpr size_t kClasses = 4;
+
+  // Lateness of one IO loop's probe timer. Window fields are touched only on
+  // the loop's own thread.
+  struct LoopProbe {
+    std::atomic<int64_t> standingMicros{0};
+    int64_t windowStartMicros = 0;
+    int64_t windowMinMicros = std::numeric_limits<int64_t>::max();
+  };
+
+  struct ClassState {
+    int minLimit = 1;
+    int maxLimit = 1;
+    // Loops that must stay idle for this class to be admitted.
+    int headroom = 0;
+    std::atomic<int> limit{1};
+    std::atomic<int> inFlight{0};
+
+    std::mutex mutex;
+    double limitEstimate = 1;
+    double shortLatency = 0;
+    double longLatency = 0;
+
+    // Standing queueing delay at which this class starts being shed.
+    int64_t delayThresholdMicros = 0;
+
+    metrics::Counter* admitted = nullptr;
+    metrics::Counter* shedConcurrency = nullptr;
+    metrics::Counter* shedQueueing = nullptr;
+  };
+
+  bool shedForQueueing(const ClassState& state) const;
+  void scheduleProbe(trantor::EventLoop* loop, LoopProbe* probe);
+  void complete(size_t routeClass, int inFlightAtStart, double seconds);
+
+  const bool enabled_;
+  const int ioLoops_;
+  std::atomic<int> totalInFlight_{0};
+  std::array<ClassState, kClasses> classes_;
+  std::vector<std::unique_ptr<LoopProbe>> probes_;
+};
+
+}  // namespace blog
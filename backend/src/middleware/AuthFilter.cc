@@ -0,0 +1,38 @@
+#include "middleware/AuthFilter.h"
+
+#include "middleware/AuthMiddleware.h"
+#include "utils/JsonResponse.h"
+
+namespace blog {
+
+AuthRequiredFilter::AuthRequiredFilter(const JwtService& jwtService) : jwtService_(jwtService) {}
+
+void AuthRequiredFilter::doFilter(const drogon::HttpRequestPtr& req,
+                                  drogon::FilterCallback&& callback,
+                                  drogon::FilterChainCallback&& chainCallback) {
+  RequestUser user;
+  ApiError authError(401, "AUTH_REQUIRED", "auth required");
+  if (!AuthMiddleware::authenticate(req, jwtService_, user, authError)) {
+    callback(utils::makeError(authError, utils::getRequestId(req)));
+    return;
+  }
+
+  AuthMiddleware::attachUser(req, std::move(user));
+  chainCallback();
+}
+
+AuthOptionalFilter::AuthOptionalFilter(const JwtService& jwtService) : jwtService_(jwtService) {}
+
+void AuthOptionalFilter::doFilter(const drogon::HttpRequestPtr& req,
+                                  drogon::FilterCallback&&,
+                                  drogon::FilterChainCallback&& chainCallback) {
+  RequestUser user;
+  ApiError authError(401, "AUTH_REQUIRED", "auth required");
+  if (!req->getHeader("Authorization").empty() &&
+      AuthMiddleware::authenticate(req, jwtService_, user, authError)) {
+    AuthMiddleware::attachUser(req, std::move(user));
+  }
+  chainCallback();
+}
+
+}  // namespace blog
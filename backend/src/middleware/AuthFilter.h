@@ -0,0 +1,38 @@
+#pragma once
+
+#include <drogon/drogon.h>
+
+#include "auth/JwtService.h"
+
+namespace blog {
+
+// Verifies the bearer token once per request and stores the RequestUser in
+// req->attributes() for handlers to read through AuthMiddleware::currentUser.
+// Rejects the request when authentication fails.
+class AuthRequiredFilter : public drogon::HttpFilter<AuthRequiredFilter, false> {
+ public:
+  explicit AuthRequiredFilter(const JwtService& jwtService);
+
+  void doFilter(const drogon::HttpRequestPtr& req,
+                drogon::FilterCallback&& callback,
+                drogon::FilterChainCallback&& chainCallback) override;
+
+ private:
+  const JwtService& jwtService_;
+};
+
+// Same as AuthRequiredFilter, but a missing or invalid token lets the request
+// through anonymously.
+class AuthOptionalFilter : public drogon::HttpFilter<AuthOptionalFilter, false> {
+ public:
+  explicit AuthOptionalFilter(const JwtService& jwtService);
+
+  void doFilter(const drogon::HttpRequestPtr& req,
+                drogon::FilterCallback&& callback,
+                drogon::FilterChainCallback&& chainCallback) override;
+
+ private:
+  const JwtService& jwtService_;
+};
+
+}  // namespace blog
@@ -1,8 +1,12 @@
 #include "middleware/AuthMiddleware.h"
 
+#include "tracing/RequestTrace.h"
+
 namespace blog {
 namespace {
 
+constexpr const char* kRequestUserKey = "blog.requestUser";
+
 bool parseBearerToken(const std::string& header, std::string& token) {
   constexpr const char* prefix = "Bearer ";
   if (header.size() <= 7 || header.compare(0, 7, prefix) != 0) {
@@ -16,9 +20,9 @@ bool parseBearerToken(const std::string& header, std::string& token) {
 
 bool AuthMiddleware::authenticate(const drogon::HttpRequestPtr& req,
                                   const JwtService& jwtService,
-                                  const UserRepository& userRepository,
                                   RequestUser& user,
                                   ApiError& error) {
+  const tracing::ScopedSpan span(tracing::Stage::Auth);
   const std::string authHeader = req->getHeader("Authorization");
   if (authHeader.empty()) {
     error = ApiError(401, "AUTH_REQUIRED", "authorization header is required");
@@ -35,26 +39,39 @@ bool AuthMiddleware::authenticate(const drogon::HttpRequestPtr& req,
   std::string errorCode;
   std::string errorMessage;
   if (!jwtService.verifyAccessToken(token, payload, errorCode, errorMessage)) {
-    error = ApiError(401, errorCode, errorMessage);
+    error = ApiError(errorCode == "USER_BANNED" ? 403 : 401, errorCode, errorMessage);
     return false;
   }
 
-  const auto dbUser = userRepository.findById(payload.userId);
-  if (!dbUser.has_value()) {
-    error = ApiError(401, "AUTH_INVALID_TOKEN", "user no longer exists");
-    return false;
-  }
+  // Banning, role changes and password changes bump the token version, so a
+  // token that still verifies reflects the user's current state.
+  user.id = payload.userId;
+  user.username = payload.username;
+  user.role = payload.role;
+  user.isBanned = false;
+  return true;
+}
 
-  if (dbUser->isBanned) {
-    error = ApiError(403, "USER_BANNED", "user is banned");
+void AuthMiddleware::attachUser(const drogon::HttpRequestPtr& req, RequestUser&& user) {
+  req->attributes()->insert(kRequestUserKey, std::move(user));
+}
+
+bool AuthMiddleware::currentUser(const drogon::HttpRequestPtr& req, RequestUser& user, ApiError& error) {
+  const auto& attributes = req->attributes();
+  if (!attributes->find(kRequestUserKey)) {
+    error = ApiError(401, "AUTH_REQUIRED", "authorization header is required");
     return false;
   }
-
-  user.id = dbUser->id;
-  user.username = dbUser->username;
-  user.role = dbUser->role;
-  user.isBanned = dbUser->isBanned;
+  user = attributes->get<RequestUser>(kRequestUserKey);
   return true;
 }
 
+std::optional<int64_t> AuthMiddleware::currentUserId(const drogon::HttpRequestPtr& req) {
+  const auto& attributes = req->attributes();
+  if (!attributes->find(kRequestUserKey)) {
+    return std::nullopt;
+  }
+  return attributes->get<RequestUser>(kRequestUserKey).id;
+}
+
 }  // namespace blog
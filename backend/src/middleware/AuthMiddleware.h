@@ -2,10 +2,10 @@
 
 #include <drogon/drogon.h>
 
+#include <optional>
 #include <string>
 
 #include "auth/JwtService.h"
-#include "repositories/UserRepository.h"
 #include "utils/ApiError.h"
 
 namespace blog {
@@ -21,9 +21,13 @@ class AuthMiddleware {
  public:
   static bool authenticate(const drogon::HttpRequestPtr& req,
                            const JwtService& jwtService,
-                           const UserRepository& userRepository,
                            RequestUser& user,
                            ApiError& error);
+
+  // The user resolved by AuthRequiredFilter / AuthOptionalFilter.
+  static void attachUser(const drogon::HttpRequestPtr& req, RequestUser&& user);
+  static bool currentUser(const drogon::HttpRequestPtr& req, RequestUser& user, ApiError& error);
+  static std::optional<int64_t> currentUserId(const drogon::HttpRequestPtr& req);
 };
 
 }  // namespace blog
@@ -0,0 +1,190 @@
+#include "middleware/RateLimiter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mutex>
+
+namespace blog {
+namespace {
+
+constexpr size_t kMaxKeyLength = 64;
+
+int64_t nowSteadyMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int secondsCeil(double ms) {
+  return std::max(1, static_cast<int>(std::ceil(ms / 1000.0)));
+}
+
+}  // namespace
+
+SlidingWindowLimiter::SlidingWindowLimiter(int limit, int windowSeconds)
+    : limit_(std::max(1, limit)), windowMs_(static_cast<int64_t>(std::max(1, windowSeconds)) * 1000) {}
+
+bool SlidingWindowLimiter::acquireInBucket(Bucket& bucket, int64_t nowMs, int& retryAfterSeconds) const {
+  const int64_t window = nowMs / windowMs_;
+  int64_t seen = bucket.window.load(std::memory_order_acquire);
+  while (seen < window) {
+    if (bucket.window.compare_exchange_weak(seen, window, std::memory_order_acq_rel)) {
+      const uint32_t carried = bucket.current.exchange(0, std::memory_order_acq_rel);
+      bucket.previous.store(seen == window - 1 ? carried : 0, std::memory_order_release);
+      break;
+    }
+  }
+
+  const double elapsed = static_cast<double>(nowMs % windowMs_) / static_cast<double>(windowMs_);
+  const double previous = bucket.previous.load(std::memory_order_acquire);
+  const uint32_t current = bucket.current.fetch_add(1, std::memory_order_acq_rel) + 1;
+  if (previous * (1.0 - elapsed) + current <= limit_) {
+    return true;
+  }
+  bucket.current.fetch_sub(1, std::memory_order_acq_rel);
+
+  // Time until the weighted estimate leaves room for one more request.
+  const double used = static_cast<double>(current - 1);
+  double waitMs = 0;
+  if (current <= static_cast<uint32_t>(limit_)) {
+    const double target = 1.0 - (limit_ - static_cast<double>(current)) / std::max(previous, 1.0);
+    waitMs = (target - elapsed) * static_cast<double>(windowMs_);
+  } else {
+    const double target = 1.0 - (limit_ - 1.0) / std::max(used, 1.0);
+    waitMs = (1.0 - elapsed + target) * static_cast<double>(windowMs_);
+  }
+  retryAfterSeconds = secondsCeil(waitMs);
+  return false;
+}
+
+bool SlidingWindowLimiter::tryAcquire(const std::string& key, int64_t nowMs, int& retryAfterSeconds) {
+  auto& shard = shards_[std::hash<std::string>{}(key) % kShardCount];
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto it = shard.buckets.find(key);
+    if (it != shard.buckets.end()) {
+      return acquireInBucket(*it->second, nowMs, retryAfterSeconds);
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  auto& slot = shard.buckets[key];
+  if (!slot) {
+    slot = std::make_unique<Bucket>();
+    slot->window.store(nowMs / windowMs_, std::memory_order_relaxed);
+  }
+  return acquireInBucket(*slot, nowMs, retryAfterSeconds);
+}
+
+size_t SlidingWindowLimiter::evictIdle(int64_t nowMs) {
+  const int64_t window = nowMs / windowMs_;
+  size_t evicted = 0;
+  for (auto& shard : shards_) {
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+      if (it->second->window.load(std::memory_order_relaxed) < window - 1) {
+        it = shard.buckets.erase(it);
+        evicted++;
+      } else {
+        ++it;
+      }
+    }
+  }
+  return evicted;
+}
+
+RateLimiter::RateLimiter(const AppConfig& config, metrics::MetricsRegistry& metrics)
+    : enabled_(config.rateLimitEnabled),
+      trustProxyHeaders_(config.trustProxyHeaders),
+      windowSeconds_(config.rateLimitWindowSeconds),
+      loginPerIp_(config.rateLimitLoginPerIp, config.rateLimitWindowSeconds),
+      loginPerUsername_(config.rateLimitLoginPerUsername, config.rateLimitWindowSeconds),
+      registerPerIp_(config.rateLimitRegisterPerIp, config.rateLimitWindowSeconds) {
+  const std::string name = "blog_rate_limit_decisions_total";
+  const std::string help = "Auth rate limiter decisions by route, key scope and outcome.";
+  const auto resolve = [&](const std::string& route, const std::string& scope) {
+    Decisions decisions;
+    decisions.allowed =
+        &metrics.counter(name, help, {{"route", route}, {"scope", scope}, {"decision", "allowed"}});
+    decisions.limited =
+        &metrics.counter(name, help, {{"route", route}, {"scope", scope}, {"decision", "limited"}});
+    return decisions;
+  };
+  loginIpDecisions_ = resolve("login", "ip");
+  loginUsernameDecisions_ = resolve("login", "username");
+  registerIpDecisions_ = resolve("register", "ip");
+}
+
+bool RateLimiter::enabled() const {
+  return enabled_;
+}
+
+int RateLimiter::windowSeconds() const {
+  return windowSeconds_;
+}
+
+std::string RateLimiter::clientIp(const drogon::HttpRequestPtr& req) const {
+  if (trustProxyHeaders_) {
+    const std::string realIp = req->getHeader("X-Real-IP");
+    if (!realIp.empty()) {
+      return realIp.substr(0, kMaxKeyLength);
+    }
+    const std::string forwarded = req->getHeader("X-Forwarded-For");
+    if (!forwarded.empty()) {
+      return forwarded.substr(0, std::min(forwarded.find(','), kMaxKeyLength));
+    }
+  }
+  return req->peerAddr().toIp();
+}
+
+bool RateLimiter::check(SlidingWindowLimiter& limiter,
+                        const std::string& key,
+                        const Decisions& decisions,
+                        int64_t nowMs,
+                        int& retryAfterSeconds) {
+  if (limiter.tryAcquire(key, nowMs, retryAfterSeconds)) {
+    decisions.allowed->inc();
+    return true;
+  }
+  decisions.limited->inc();
+  return false;
+}
+
+bool RateLimiter::allow(const drogon::HttpRequestPtr& req, int& retryAfterSeconds) {
+  if (!enabled_ || req->method() != drogon::Post) {
+    return true;
+  }
+
+  const std::string& path = req->path();
+  const int64_t nowMs = nowSteadyMs();
+
+  if (path == "/api/auth/register") {
+    return check(registerPerIp_, clientIp(req), registerIpDecisions_, nowMs, retryAfterSeconds);
+  }
+
+  if (path != "/api/auth/login") {
+    return true;
+  }
+
+  if (!check(loginPerIp_, clientIp(req), loginIpDecisions_, nowMs, retryAfterSeconds)) {
+    return false;
+  }
+
+  const auto body = req->getJsonObject();
+  if (!body || !body->isObject() || !(*body)["username"].isString()) {
+    return true;
+  }
+  const std::string username = (*body)["username"].asString().substr(0, kMaxKeyLength);
+  return check(loginPerUsername_, username, loginUsernameDecisions_, nowMs, retryAfterSeconds);
+}
+
+void RateLimiter::evictIdle() {
+  const int64_t nowMs = nowSteadyMs();
+  loginPerIp_.evictIdle(nowMs);
+  loginPerUsername_.evictIdle(nowMs);
+  registerPerIp_.evictIdle(nowMs);
+}
+
+}  // namespace blog
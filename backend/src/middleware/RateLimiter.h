@@ -0,0 +1,87 @@
+#pragma once
+
+#include <drogon/drogon.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "app/AppConfig.h"
+#include "metrics/MetricsRegistry.h"
+
+namespace blog {
+
+// Approximate sliding-window counter: the estimate for a key is the previous
+// fixed window weighted by how much of it still overlaps the sliding window,
+// plus the current window. Buckets are sharded by key hash; counters are
+// atomics so concurrent requests for one key never serialize on a mutex.
+class SlidingWindowLimiter {
+ public:
+  SlidingWindowLimiter(int limit, int windowSeconds);
+
+  bool tryAcquire(const std::string& key, int64_t nowMs, int& retryAfterSeconds);
+  size_t evictIdle(int64_t nowMs);
+
+ private:
+  struct Bucket {
+    std::atomic<int64_t> window{0};
+    std::atomic<uint32_t> current{0};
+    std::atomic<uint32_t> previous{0};
+  };
+
+  struct Shard {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<Bucket>> buckets;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  bool acquireInBucket(Bucket& bucket, int64_t nowMs, int& retryAfterSeconds) const;
+
+  int limit_;
+  int64_t windowMs_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+// Throttles the Argon2-backed auth endpoints per client IP and, for login,
+// per username. Runs as pre-routing advice, so rejected requests never reach
+// password hashing.
+class RateLimiter {
+ public:
+  RateLimiter(const AppConfig& config, metrics::MetricsRegistry& metrics);
+
+  bool enabled() const;
+  int windowSeconds() const;
+
+  bool allow(const drogon::HttpRequestPtr& req, int& retryAfterSeconds);
+  void evictIdle();
+
+ private:
+  struct Decisions {
+    metrics::Counter* allowed = nullptr;
+    metrics::Counter* limited = nullptr;
+  };
+
+  bool check(SlidingWindowLimiter& limiter,
+             const std::string& key,
+             const Decisions& decisions,
+             int64_t nowMs,
+             int& retryAfterSeconds);
+  std::string clientIp(const drogon::HttpRequestPtr& req) const;
+
+  bool enabled_;
+  bool trustProxyHeaders_;
+  int windowSeconds_;
+  SlidingWindowLimiter loginPerIp_;
+  SlidingWindowLimiter loginPerUsername_;
+  SlidingWindowLimiter registerPerIp_;
+  Decisions loginIpDecisions_;
+  Decisions loginUsernameDecisions_;
+  Decisions registerIpDecisions_;
+};
+
+}  // namespace blog
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <string>
 
 namespace blog {
@@ -23,4 +24,17 @@ struct PostCollectionMembership {
   int position = 0;
 };
 
+// Series navigation only needs the id and title of the adjacent posts.
+struct CollectionNeighbor {
+  int64_t id = 0;
+  std::string title;
+};
+
+struct CollectionNavigation {
+  int position = 0;
+  int total = 0;
+  std::optional<CollectionNeighbor> prev;
+  std::optional<CollectionNeighbor> next;
+};
+
 }  // namespace blog
@@ -14,6 +14,20 @@ struct Comment {
   std::string createdAt;
   std::string updatedAt;
   bool isDeleted = false;
+  // 0 for a top-level comment.
+  int64_t parentId = 0;
+  int depth = 0;
+  // Ancestor ids then this id, each as 10 zero-padded digits plus '/'.
+  std::string path;
+  // Live descendants, not just direct replies.
+  int replyCount = 0;
+};
+
+// Position of the last comment on a keyset page; the next page starts after
+// it in (created_at DESC, id DESC) order.
+struct CommentCursor {
+  std::string createdAt;
+  int64_t id = 0;
 };
 
 }  // namespace blog
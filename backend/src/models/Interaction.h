@@ -1,11 +1,33 @@
 #pragma once
 
+#include <cstdint>
+
 namespace blog {
 
+enum class InteractionKind { Like, Favorite };
+
+struct InteractionToggle {
+  InteractionKind kind = InteractionKind::Like;
+  int64_t postId = 0;
+  int64_t userId = 0;
+  bool enabled = false;
+};
+
+// A committed change to one of a post's interaction counters. Emitted by
+// InteractionRepository after the transaction that made it commits.
+enum class InteractionEventKind { Like, Favorite, Comment, View };
+
+struct InteractionEvent {
+  InteractionEventKind kind = InteractionEventKind::Like;
+  int64_t postId = 0;
+  int64_t delta = 0;
+};
+
 struct PostInteractionSummary {
   int likeCount = 0;
   int favoriteCount = 0;
   int commentCount = 0;
+  int64_t viewCount = 0;
   bool likedByMe = false;
   bool favoritedByMe = false;
 };
@@ -16,6 +16,17 @@ struct Post {
   std::string favoritedAt;
   bool isDeleted = false;
   int collectionPosition = 0;
+  int64_t viewCount = 0;
+};
+
+// A committed change to a post, emitted by PostRepository. `post` carries
+// what the write knew: everything for Created, id and title for Updated, the
+// id alone for Deleted.
+enum class PostEventKind { Created, Updated, Deleted };
+
+struct PostEvent {
+  PostEventKind kind = PostEventKind::Created;
+  Post post;
 };
 
 }  // namespace blog
@@ -14,4 +14,11 @@ struct User {
   std::string createdAt;
 };
 
+// The users columns TokenVersionStore mirrors.
+struct UserTokenState {
+  int64_t userId = 0;
+  int64_t tokenVersion = 0;
+  bool isBanned = false;
+};
+
 }  // namespace blog
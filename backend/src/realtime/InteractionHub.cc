@@ -0,0 +1,195 @@
+#include "realtime/InteractionHub.h"
+
+#include <json/json.h>
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <optional>
+
+namespace blog {
+
+InteractionHub::InteractionHub(const AppConfig& config)
+    : tickIntervalMs_(std::max(10, config.liveUpdateIntervalMs)),
+      maxSubscriptionsPerConnection_(static_cast<size_t>(std::max(1, config.liveUpdateMaxSubscriptions))) {}
+
+int InteractionHub::tickIntervalMs() const {
+  return tickIntervalMs_;
+}
+
+void InteractionHub::publish(const InteractionEvent& event) {
+  PendingShard& shard = pending_[static_cast<uint64_t>(event.postId) % kShardCount];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  int64_t& newComments = shard.newComments[event.postId];
+  if (event.kind == InteractionEventKind::Comment && event.delta > 0) {
+    newComments += event.delta;
+  }
+}
+
+std::string InteractionHub::countsToJson(int64_t postId, const PostInteractionSummary& summary, int64_t newComments) {
+  Json::Value value(Json::objectValue);
+  value["postId"] = Json::Int64(postId);
+  value["likeCount"] = summary.likeCount;
+  value["favoriteCount"] = summary.favoriteCount;
+  value["commentCount"] = summary.commentCount;
+  value["viewCount"] = Json::Int64(summary.viewCount);
+  if (newComments > 0) {
+    value["newComments"] = Json::Int64(newComments);
+  }
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return Json::writeString(builder, value);
+}
+
+void InteractionHub::tick(const InteractionWriteBuffer& counts) {
+  std::unordered_map<int64_t, int64_t> changed;
+  for (auto& shard : pending_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    changed.merge(shard.newComments);
+    shard.newComments.clear();
+  }
+  if (changed.empty()) {
+    return;
+  }
+
+  std::vector<int64_t> postIds;
+  postIds.reserve(changed.size());
+  for (const auto& entry : changed) {
+    postIds.push_back(entry.first);
+  }
+  std::unordered_map<int64_t, PostInteractionSummary> summaries;
+  std::string errorMessage;
+  if (!counts.getSummaries(postIds, std::nullopt, summaries, errorMessage)) {
+    LOG_WARN << "live update counts unavailable, skipping tick: " << errorMessage;
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->reserve(summaries.size());
+  for (const auto& [postId, summary] : summaries) {
+    batch->emplace_back(postId, countsToJson(postId, summary, changed[postId]));
+  }
+
+  std::vector<std::pair<trantor::EventLoop*, std::shared_ptr<LoopTable>>> loops;
+  {
+    std::lock_guard<std::mutex> lock(loopsMutex_);
+    loops.assign(loops_.begin(), loops_.end());
+  }
+  for (const auto& [loop, table] : loops) {
+    loop->queueInLoop([table = table, batch]() { fanOut(*table, *batch); });
+  }
+}
+
+void InteractionHub::fanOut(LoopTable& table, const Batch& batch) {
+  std::unordered_map<const drogon::WebSocketConnection*, std::pair<drogon::WebSocketConnectionPtr, std::string>> frames;
+  for (const auto& [postId, json] : batch) {
+    const auto it = table.subscribers.find(postId);
+    if (it == table.subscribers.end()) {
+      continue;
+    }
+    for (const auto& conn : it->second) {
+      auto& frame = frames[conn.get()];
+      if (frame.second.empty()) {
+        frame.first = conn;
+        frame.second = "{\"type\":\"counts\",\"posts\":[";
+      } else {
+        frame.second += ',';
+      }
+      frame.second += json;
+    }
+  }
+  for (auto& [key, frame] : frames) {
+    if (frame.first->connected()) {
+      frame.second += "]}";
+      frame.first->send(frame.second);
+    }
+  }
+}
+
+void InteractionHub::connect(const drogon::WebSocketConnectionPtr& conn) {
+  trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+  std::shared_ptr<LoopTable> table;
+  {
+    std::lock_guard<std::mutex> lock(loopsMutex_);
+    auto& slot = loops_[loop];
+    if (!slot) {
+      slot = std::make_shared<LoopTable>();
+    }
+    table = slot;
+  }
+  auto subscription = std::make_shared<Subscription>();
+  subscription->table = std::move(table);
+  conn->setContext(subscription);
+}
+
+bool InteractionHub::subscribe(const drogon::WebSocketConnectionPtr& conn,
+                               const std::vector<int64_t>& postIds,
+                               std::string& errorMessage) {
+  const auto subscription = conn->getContext<Subscription>();
+  if (!subscription) {
+    errorMessage = "connection is not registered";
+    return false;
+  }
+
+  size_t added = 0;
+  for (const int64_t postId : postIds) {
+    if (subscription->postIds.count(postId) == 0) {
+      ++added;
+    }
+  }
+  if (subscription->postIds.size() + added > maxSubscriptionsPerConnection_) {
+    errorMessage = "at most " + std::to_string(maxSubscriptionsPerConnection_) + " posts per connection";
+    return false;
+  }
+
+  for (const int64_t postId : postIds) {
+    if (subscription->postIds.insert(postId).second) {
+      subscription->table->subscribers[postId].push_back(conn);
+    }
+  }
+  return true;
+}
+
+void InteractionHub::removeSubscriber(LoopTable& table, int64_t postId, const drogon::WebSocketConnection* conn) {
+  const auto it = table.subscribers.find(postId);
+  if (it == table.subscribers.end()) {
+    return;
+  }
+  auto& conns = it->second;
+  const auto found =
+      std::find_if(conns.begin(), conns.end(), [conn](const auto& candidate) { return candidate.get() == conn; });
+  if (found != conns.end()) {
+    *found = std::move(conns.back());
+    conns.pop_back();
+  }
+  if (conns.empty()) {
+    table.subscribers.erase(it);
+  }
+}
+
+void InteractionHub::unsubscribe(const drogon::WebSocketConnectionPtr& conn, const std::vector<int64_t>& postIds) {
+  const auto subscription = conn->getContext<Subscription>();
+  if (!subscription) {
+    return;
+  }
+  for (const int64_t postId : postIds) {
+    if (subscription->postIds.erase(postId) > 0) {
+      removeSubscriber(*subscription->table, postId, conn.get());
+    }
+  }
+}
+
+void InteractionHub::disconnect(const drogon::WebSocketConnectionPtr& conn) {
+  const auto subscription = conn->getContext<Subscription>();
+  if (!subscription) {
+    return;
+  }
+  // The table holds the connection and the connection holds the table (via
+  // its context); dropping both sides here breaks the cycle.
+  for (const int64_t postId : subscription->postIds) {
+    removeSubscriber(*subscription->table, postId, conn.get());
+  }
+  conn->clearContext();
+}
+
+}  // namespace blog
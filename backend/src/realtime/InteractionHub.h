@@ -0,0 +1,88 @@
+#pragma once
+
+#include <drogon/WebSocketController.h>
+#include <trantor/net/EventLoop.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "app/AppConfig.h"
+#include "models/Interaction.h"
+#include "repositories/InteractionWriteBuffer.h"
+
+namespace blog {
+
+// Pushes interaction counter changes to WebSocket subscribers.
+//
+// publish() marks the post of each committed InteractionEvent as changed in
+// one of 16 locked shards. Every tick the changed posts are drained, their
+// current counts read in one batch, serialized once per post and handed to
+// each IO loop, which fans them out from its own subscriber table. A
+// connection is only touched on the loop it lives on, so subscribing and
+// sending never contend across loops, and a client receives at most one frame
+// per tick covering every post of its that changed. Counts are absolute, so a
+// client that also applies its own toggle responses never double counts.
+class InteractionHub {
+ public:
+  explicit InteractionHub(const AppConfig& config);
+
+  // Any thread.
+  void publish(const InteractionEvent& event);
+  // Drains changed posts, reads their counts from `counts` and queues the
+  // fan-out on every IO loop. Run it on a timer every tickIntervalMs().
+  void tick(const InteractionWriteBuffer& counts);
+  int tickIntervalMs() const;
+
+  // The rest run on the connection's own IO loop, i.e. from drogon's
+  // WebSocket callbacks. subscribe() fails once a connection would hold more
+  // than the configured number of posts.
+  void connect(const drogon::WebSocketConnectionPtr& conn);
+  bool subscribe(const drogon::WebSocketConnectionPtr& conn,
+                 const std::vector<int64_t>& postIds,
+                 std::string& errorMessage);
+  void unsubscribe(const drogon::WebSocketConnectionPtr& conn, const std::vector<int64_t>& postIds);
+  void disconnect(const drogon::WebSocketConnectionPtr& conn);
+
+ private:
+  struct PendingShard {
+    std::mutex mutex;
+    // Changed post id -> comments added since the last tick.
+    std::unordered_map<int64_t, int64_t> newComments;
+  };
+
+  // Owned by one IO loop and only read or written on its thread.
+  struct LoopTable {
+    std::unordered_map<int64_t, std::vector<drogon::WebSocketConnectionPtr>> subscribers;
+  };
+
+  // Stored as the connection's context.
+  struct Subscription {
+    std::shared_ptr<LoopTable> table;
+    std::unordered_set<int64_t> postIds;
+  };
+
+  using Batch = std::vector<std::pair<int64_t, std::string>>;
+
+  static constexpr size_t kShardCount = 16;
+
+  static void fanOut(LoopTable& table, const Batch& batch);
+  static void removeSubscriber(LoopTable& table, int64_t postId, const drogon::WebSocketConnection* conn);
+  static std::string countsToJson(int64_t postId, const PostInteractionSummary& summary, int64_t newComments);
+
+  const int tickIntervalMs_;
+  const size_t maxSubscriptionsPerConnection_;
+  std::array<PendingShard, kShardCount> pending_;
+
+  // Guards the list of loops only; taken once per connection and per tick.
+  std::mutex loopsMutex_;
+  std::unordered_map<trantor::EventLoop*, std::shared_ptr<LoopTable>> loops_;
+};
+
+}  // namespace blog
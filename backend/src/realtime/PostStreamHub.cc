@@ -0,0 +1,158 @@
+#include "realtime/PostStreamHub.h"
+
+#include <json/json.h>
+
+#include <algorithm>
+
+namespace blog {
+namespace {
+
+constexpr const char* kHeartbeatFrame = ": ping\n\n";
+// Tells EventSource how long to wait before reconnecting.
+constexpr const char* kRetryFrame = "retry: 5000\n\n";
+
+}  // namespace
+
+PostStreamHub::PostStreamHub(const AppConfig& config)
+    : bufferEvents_(static_cast<size_t>(std::max(1, config.postStreamBufferEvents))),
+      heartbeatSeconds_(std::max(1, config.postStreamHeartbeatSeconds)),
+      maxClients_(static_cast<size_t>(std::max(0, config.postStreamMaxClients))) {}
+
+int PostStreamHub::heartbeatSeconds() const {
+  return heartbeatSeconds_;
+}
+
+std::string PostStreamHub::eventToFrame(const PostEvent& event) {
+  Json::Value data(Json::objectValue);
+  data["id"] = Json::Int64(event.post.id);
+  const char* name = "post.deleted";
+  switch (event.kind) {
+    case PostEventKind::Created:
+      name = "post.created";
+      data["title"] = event.post.title;
+      data["authorId"] = Json::Int64(event.post.authorId);
+      data["authorUsername"] = event.post.authorUsername;
+      data["createdAt"] = event.post.createdAt;
+      break;
+    case PostEventKind::Updated:
+      name = "post.updated";
+      data["title"] = event.post.title;
+      break;
+    case PostEventKind::Deleted:
+      break;
+  }
+
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  return std::string("event: ") + name + "\ndata: " + Json::writeString(builder, data) + "\n\n";
+}
+
+std::vector<std::pair<trantor::EventLoop*, std::shared_ptr<PostStreamHub::LoopClients>>> PostStreamHub::snapshotLoops() {
+  std::lock_guard<std::mutex> lock(loopsMutex_);
+  return {loops_.begin(), loops_.end()};
+}
+
+void PostStreamHub::publish(const PostEvent& event) {
+  if (clientCount_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  const auto frame = std::make_shared<const std::string>(eventToFrame(event));
+  for (const auto& [loop, loopClients] : snapshotLoops()) {
+    loop->queueInLoop([this, loopClients = loopClients, loop = loop, frame]() { enqueue(loopClients, loop, frame); });
+  }
+}
+
+void PostStreamHub::enqueue(const std::shared_ptr<LoopClients>& loopClients,
+                            trantor::EventLoop* loop,
+                            const Frame& frame) {
+  for (auto& client : loopClients->clients) {
+    client->queued.push_back(frame);
+    if (client->queued.size() > bufferEvents_) {
+      client->queued.pop_front();
+      ++client->dropped;
+    }
+  }
+  // Events queued in the same loop iteration go out in one write.
+  if (!loopClients->flushScheduled && !loopClients->clients.empty()) {
+    loopClients->flushScheduled = true;
+    loop->queueInLoop([this, loopClients]() { flush(*loopClients); });
+  }
+}
+
+void PostStreamHub::flush(LoopClients& loopClients) {
+  loopClients.flushScheduled = false;
+  for (size_t i = 0; i < loopClients.clients.size();) {
+    Client& client = *loopClients.clients[i];
+    if (client.queued.empty()) {
+      ++i;
+      continue;
+    }
+    std::string data;
+    if (client.dropped > 0) {
+      data = "event: overflow\ndata: {\"dropped\":" + std::to_string(client.dropped) + "}\n\n";
+      client.dropped = 0;
+    }
+    for (const auto& frame : client.queued) {
+      data += *frame;
+    }
+    client.queued.clear();
+    if (sendOrDrop(loopClients, i, data)) {
+      ++i;
+    }
+  }
+}
+
+void PostStreamHub::heartbeat() {
+  for (const auto& [loop, loopClients] : snapshotLoops()) {
+    loop->queueInLoop([this, loopClients = loopClients]() {
+      for (size_t i = 0; i < loopClients->clients.size();) {
+        if (sendOrDrop(*loopClients, i, kHeartbeatFrame)) {
+          ++i;
+        }
+      }
+    });
+  }
+}
+
+bool PostStreamHub::sendOrDrop(LoopClients& loopClients, size_t index, const std::string& data) {
+  auto& clients = loopClients.clients;
+  if (clients[index]->stream->send(data)) {
+    return true;
+  }
+  clients[index]->stream->close();
+  clients[index] = std::move(clients.back());
+  clients.pop_back();
+  clientCount_.fetch_sub(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool PostStreamHub::acceptingClients() const {
+  return clientCount_.load(std::memory_order_relaxed) < maxClients_;
+}
+
+void PostStreamHub::attach(drogon::ResponseStreamPtr stream) {
+  if (!stream) {
+    return;
+  }
+  if (!stream->send(kRetryFrame)) {
+    stream->close();
+    return;
+  }
+
+  trantor::EventLoop* loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+  std::shared_ptr<LoopClients> loopClients;
+  {
+    std::lock_guard<std::mutex> lock(loopsMutex_);
+    auto& slot = loops_[loop];
+    if (!slot) {
+      slot = std::make_shared<LoopClients>();
+    }
+    loopClients = slot;
+  }
+  auto client = std::make_unique<Client>();
+  client->stream = std::move(stream);
+  loopClients->clients.push_back(std::move(client));
+  clientCount_.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace blog
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <drogon/HttpResponse.h>
+#include <trantor/net/EventLoop.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "app/AppConfig.h"
+#include "models/Post.h"
+
+namespace blog {
+
+// Broadcasts post create/update/delete events to Server-Sent Events streams.
+//
+// publish() renders each event into an SSE frame once and queues it on every
+// IO loop that has clients. Each loop keeps its own client list, touched only
+// on its thread. Frames wait in a per-client queue of at most
+// bufferEvents entries until the loop's next flush; when a burst overflows
+// it, the oldest frames are dropped and the client gets an "overflow" event
+// telling it to re-fetch /api/posts instead. Heartbeat comments keep proxies
+// from timing the stream out, and a failed write on any frame removes the
+// client, so dead peers are found within one heartbeat interval.
+class PostStreamHub {
+ public:
+  explicit PostStreamHub(const AppConfig& config);
+
+  // Any thread.
+  void publish(const PostEvent& event);
+  // Sends a heartbeat on every loop. Run it on a timer every
+  // heartbeatSeconds().
+  void heartbeat();
+  int heartbeatSeconds() const;
+
+  // False once maxClients streams are open. Checked before a stream is
+  // created, so concurrent requests may overshoot the cap by a few.
+  bool acceptingClients() const;
+  // On the IO loop that owns `stream`.
+  void attach(drogon::ResponseStreamPtr stream);
+
+ private:
+  using Frame = std::shared_ptr<const std::string>;
+
+  struct Client {
+    drogon::ResponseStreamPtr stream;
+    std::deque<Frame> queued;
+    uint64_t dropped = 0;
+  };
+
+  // Owned by one IO loop and only read or written on its thread.
+  struct LoopClients {
+    std::vector<std::unique_ptr<Client>> clients;
+    bool flushScheduled = false;
+  };
+
+  std::vector<std::pair<trantor::EventLoop*, std::shared_ptr<LoopClients>>> snapshotLoops();
+  void enqueue(const std::shared_ptr<LoopClients>& loopClients, trantor::EventLoop* loop, const Frame& frame);
+  void flush(LoopClients& loopClients);
+  // Writes `data` to client `index`; on failure closes it, swaps it out of
+  // the list and returns false.
+  bool sendOrDrop(LoopClients& loopClients, size_t index, const std::string& data);
+
+  static std::string eventToFrame(const PostEvent& event);
+
+  const size_t bufferEvents_;
+  const int heartbeatSeconds_;
+  const size_t maxClients_;
+  std::atomic<size_t> clientCount_{0};
+
+  // Guards the list of loops only; taken once per client and per broadcast.
+  std::mutex loopsMutex_;
+  std::unordered_map<trantor::EventLoop*, std::shared_ptr<LoopClients>> loops_;
+};
+
+}  // namespace blog
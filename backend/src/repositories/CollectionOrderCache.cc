@@ -0,0 +1,121 @@
+#include "repositories/CollectionOrderCache.h"
+
+#include <utility>
+
+namespace blog {
+
+CollectionOrderCache::CollectionOrderCache(const CollectionRepository& collectionRepository,
+                                           size_t maxCollections,
+                                           metrics::MetricsRegistry& metrics)
+    : collectionRepository_(collectionRepository),
+      capacityPerShard_((maxCollections + kShardCount - 1) / kShardCount),
+      hits_(metrics.counter("blog_cache_lookups_total", "Cache lookups by cache and result",
+                            {{"cache", "collection_order"}, {"result", "hit"}})),
+      misses_(metrics.counter("blog_cache_lookups_total", "Cache lookups by cache and result",
+                              {{"cache", "collection_order"}, {"result", "miss"}})) {}
+
+CollectionOrderCache::Shard& CollectionOrderCache::shardFor(int64_t collectionId) {
+  return shards_[static_cast<uint64_t>(collectionId) % kShardCount];
+}
+
+std::shared_ptr<const CollectionOrderCache::Order> CollectionOrderCache::lookup(int64_t collectionId,
+                                                                                uint64_t& epoch) {
+  Shard& shard = shardFor(collectionId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const auto it = shard.collections.find(collectionId);
+  if (it == shard.collections.end()) {
+    epoch = shard.epoch;
+    return nullptr;
+  }
+  shard.recency.splice(shard.recency.begin(), shard.recency, it->second.recency);
+  return it->second.order;
+}
+
+bool CollectionOrderCache::navigate(const Order& order,
+                                    int64_t postId,
+                                    CollectionNavigation& out,
+                                    std::string& errorCode,
+                                    std::string& errorMessage) {
+  out = CollectionNavigation{};
+  const auto it = order.indexOf.find(postId);
+  if (it == order.indexOf.end()) {
+    errorCode = "POST_NOT_IN_COLLECTION";
+    errorMessage = "post is not in the specified collection";
+    return false;
+  }
+
+  const size_t index = it->second;
+  out.position = static_cast<int>(index + 1);
+  out.total = static_cast<int>(order.members.size());
+  if (index > 0) {
+    out.prev = order.members[index - 1];
+  }
+  if (index + 1 < order.members.size()) {
+    out.next = order.members[index + 1];
+  }
+  return true;
+}
+
+bool CollectionOrderCache::navigation(int64_t collectionId,
+                                      int64_t postId,
+                                      CollectionNavigation& out,
+                                      std::string& errorCode,
+                                      std::string& errorMessage) {
+  if (capacityPerShard_ == 0) {
+    return collectionRepository_.getCollectionPostNeighbors(collectionId, postId, out, errorCode, errorMessage);
+  }
+
+  uint64_t epoch = 0;
+  if (const auto cached = lookup(collectionId, epoch)) {
+    hits_.inc();
+    return navigate(*cached, postId, out, errorCode, errorMessage);
+  }
+  misses_.inc();
+
+  auto order = std::make_shared<Order>();
+  if (!collectionRepository_.listCollectionOrder(collectionId, order->members, errorMessage)) {
+    errorCode = "DB_ERROR";
+    return false;
+  }
+  order->indexOf.reserve(order->members.size());
+  for (size_t i = 0; i < order->members.size(); ++i) {
+    order->indexOf.emplace(order->members[i].id, i);
+  }
+  const bool ok = navigate(*order, postId, out, errorCode, errorMessage);
+
+  Shard& shard = shardFor(collectionId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.epoch != epoch || shard.collections.count(collectionId) > 0) {
+    return ok;
+  }
+  if (shard.collections.size() >= capacityPerShard_) {
+    shard.collections.erase(shard.recency.back());
+    shard.recency.pop_back();
+  }
+  shard.recency.push_front(collectionId);
+  shard.collections.emplace(collectionId, Entry{std::move(order), shard.recency.begin()});
+  return ok;
+}
+
+void CollectionOrderCache::invalidate(int64_t collectionId) {
+  Shard& shard = shardFor(collectionId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  ++shard.epoch;
+  const auto it = shard.collections.find(collectionId);
+  if (it == shard.collections.end()) {
+    return;
+  }
+  shard.recency.erase(it->second.recency);
+  shard.collections.erase(it);
+}
+
+void CollectionOrderCache::invalidateAll() {
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ++shard.epoch;
+    shard.collections.clear();
+    shard.recency.clear();
+  }
+}
+
+}  // namespace blog
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metrics/MetricsRegistry.h"
+#include "models/Collection.h"
+#include "repositories/CollectionRepository.h"
+
+namespace blog {
+
+// Keeps the ordered live members (id and title) of recently navigated
+// collections, so prev/next lookups after the first are an index probe in
+// memory. Membership writers call invalidate() after their transaction
+// commits; post edits and deletions call invalidateAll(), since any cached
+// collection may hold the post. A load that raced an invalidation is served
+// but not stored. With a capacity of 0 every lookup goes to the single
+// window-function query instead.
+class CollectionOrderCache {
+ public:
+  CollectionOrderCache(const CollectionRepository& collectionRepository,
+                       size_t maxCollections,
+                       metrics::MetricsRegistry& metrics);
+
+  bool navigation(int64_t collectionId,
+                  int64_t postId,
+                  CollectionNavigation& out,
+                  std::string& errorCode,
+                  std::string& errorMessage);
+  void invalidate(int64_t collectionId);
+  void invalidateAll();
+
+ private:
+  struct Order {
+    std::vector<CollectionNeighbor> members;
+    std::unordered_map<int64_t, size_t> indexOf;
+  };
+
+  struct Entry {
+    std::shared_ptr<const Order> order;
+    std::list<int64_t>::iterator recency;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<int64_t, Entry> collections;
+    std::list<int64_t> recency;
+    uint64_t epoch = 0;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& shardFor(int64_t collectionId);
+  std::shared_ptr<const Order> lookup(int64_t collectionId, uint64_t& epoch);
+  static bool navigate(const Order& order,
+                       int64_t postId,
+                       CollectionNavigation& out,
+                       std::string& errorCode,
+                       std::string& errorMessage);
+
+  const CollectionRepository& collectionRepository_;
+  size_t capacityPerShard_;
+  metrics::Counter& hits_;
+  metrics::Counter& misses_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace blog
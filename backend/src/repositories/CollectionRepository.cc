@@ -2,6 +2,10 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <optional>
+#include <vector>
+
 namespace blog {
 namespace {
 
@@ -41,10 +45,231 @@ Post rowToPost(sqlite3_stmt* stmt) {
   return post;
 }
 
-bool rollback(const Database& dbWrap, sqlite3* db, std::string& errorMessage) {
-  std::string rollbackError;
-  if (!dbWrap.exec(db, "ROLLBACK;", rollbackError)) {
-    errorMessage = rollbackError;
+// Gap between the keys of adjacent members after an append or a rebalance.
+// A run of inserts at the same spot halves it each time, so about twenty land
+// before the collection has to be renumbered.
+constexpr int64_t kSortKeyGap = int64_t{1} << 20;
+
+void rollback(Database::Connection& conn) {
+  sqlite3_exec(conn.get(), "ROLLBACK;", nullptr, nullptr, nullptr);
+}
+
+bool rowExists(Database::Connection& conn, const char* sql, int64_t id, bool& found, std::string& errorMessage) {
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int64(stmt, 1, id);
+  const int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  found = rc == SQLITE_ROW;
+  return true;
+}
+
+// Bumps updated_at and moves post_count by the number of live posts the
+// write added (positive) or removed (negative).
+bool touchCollection(Database::Connection& conn, int64_t collectionId, int postCountDelta, std::string& errorMessage) {
+  sqlite3_stmt* stmt = conn.prepare(
+      "UPDATE collections SET post_count = post_count + ?, "
+      "updated_at = strftime('%Y-%m-%dT%H:%M:%SZ','now') WHERE id = ?;",
+      errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int(stmt, 1, postCountDelta);
+  sqlite3_bind_int64(stmt, 2, collectionId);
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+// Runs a single-column query whose result may be NULL or absent.
+bool queryOptionalInt64(sqlite3_stmt* stmt,
+                        Database::Connection& conn,
+                        std::optional<int64_t>& value,
+                        std::string& errorMessage) {
+  value.reset();
+  const int rc = sqlite3_step(stmt);
+  if (rc == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+    value = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+  if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+// Renumbers every member of a collection, deleted posts included, to
+// multiples of kSortKeyGap in their current order.
+bool rebalanceSortKeys(Database::Connection& conn, int64_t collectionId, std::string& errorMessage) {
+  sqlite3_stmt* listStmt = conn.prepare(
+      "SELECT post_id FROM collection_posts WHERE collection_id = ? ORDER BY sort_key ASC, post_id ASC;",
+      errorMessage);
+  if (listStmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int64(listStmt, 1, collectionId);
+
+  std::vector<int64_t> postIds;
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(listStmt)) == SQLITE_ROW) {
+    postIds.push_back(sqlite3_column_int64(listStmt, 0));
+  }
+  sqlite3_reset(listStmt);
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+
+  sqlite3_stmt* updateStmt = conn.prepare(
+      "UPDATE collection_posts SET sort_key = ? WHERE collection_id = ? AND post_id = ?;", errorMessage);
+  if (updateStmt == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < postIds.size(); ++i) {
+    sqlite3_reset(updateStmt);
+    sqlite3_bind_int64(updateStmt, 1, static_cast<int64_t>(i + 1) * kSortKeyGap);
+    sqlite3_bind_int64(updateStmt, 2, collectionId);
+    sqlite3_bind_int64(updateStmt, 3, postIds[i]);
+    if (sqlite3_step(updateStmt) != SQLITE_DONE) {
+      errorMessage = sqlite3_errmsg(conn.get());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Picks a key that puts `postId` at 1-based `position` among the live posts of
+// the collection, not counting itself. Positions past the end append. The key
+// goes right after the live predecessor, ahead of any deleted rows behind it.
+bool sortKeyForPosition(Database::Connection& conn,
+                        int64_t collectionId,
+                        int64_t postId,
+                        int position,
+                        int64_t& sortKey,
+                        std::string& errorMessage) {
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    std::optional<int64_t> lower;
+    if (position > 1) {
+      const char* lowerSql =
+          "SELECT cp.sort_key FROM collection_posts cp "
+          "JOIN posts p ON p.id = cp.post_id "
+          "WHERE cp.collection_id = ? AND cp.post_id <> ? AND p.is_deleted = 0 "
+          "ORDER BY cp.sort_key ASC, cp.post_id ASC "
+          "LIMIT 1 OFFSET ?;";
+      sqlite3_stmt* lowerStmt = conn.prepare(lowerSql, errorMessage);
+      if (lowerStmt == nullptr) {
+        return false;
+      }
+      sqlite3_bind_int64(lowerStmt, 1, collectionId);
+      sqlite3_bind_int64(lowerStmt, 2, postId);
+      sqlite3_bind_int(lowerStmt, 3, position - 2);
+      if (!queryOptionalInt64(lowerStmt, conn, lower, errorMessage)) {
+        return false;
+      }
+      if (!lower.has_value()) {
+        sqlite3_stmt* maxStmt = conn.prepare(
+            "SELECT MAX(sort_key) FROM collection_posts WHERE collection_id = ? AND post_id <> ?;", errorMessage);
+        if (maxStmt == nullptr) {
+          return false;
+        }
+        sqlite3_bind_int64(maxStmt, 1, collectionId);
+        sqlite3_bind_int64(maxStmt, 2, postId);
+        std::optional<int64_t> last;
+        if (!queryOptionalInt64(maxStmt, conn, last, errorMessage)) {
+          return false;
+        }
+        sortKey = last.value_or(0) + kSortKeyGap;
+        return true;
+      }
+    }
+
+    const char* upperSql =
+        "SELECT MIN(sort_key) FROM collection_posts "
+        "WHERE collection_id = ?1 AND post_id <> ?2 AND (?3 IS NULL OR sort_key > ?3);";
+    sqlite3_stmt* upperStmt = conn.prepare(upperSql, errorMessage);
+    if (upperStmt == nullptr) {
+      return false;
+    }
+    sqlite3_bind_int64(upperStmt, 1, collectionId);
+    sqlite3_bind_int64(upperStmt, 2, postId);
+    if (lower.has_value()) {
+      sqlite3_bind_int64(upperStmt, 3, *lower);
+    } else {
+      sqlite3_bind_null(upperStmt, 3);
+    }
+    std::optional<int64_t> upper;
+    if (!queryOptionalInt64(upperStmt, conn, upper, errorMessage)) {
+      return false;
+    }
+
+    if (!upper.has_value()) {
+      sortKey = lower.value_or(0) + kSortKeyGap;
+      return true;
+    }
+    if (!lower.has_value()) {
+      sortKey = *upper - kSortKeyGap;
+      return true;
+    }
+    if (*upper - *lower > 1) {
+      sortKey = *lower + (*upper - *lower) / 2;
+      return true;
+    }
+    if (attempt == 0 && !rebalanceSortKeys(conn, collectionId, errorMessage)) {
+      return false;
+    }
+  }
+  errorMessage = "failed to allocate collection sort key";
+  return false;
+}
+
+// Binds an id list as one JSON array, so the statement text and its cached
+// plan do not depend on the list length.
+std::string idArrayJson(const std::vector<int64_t>& ids) {
+  std::string idArray = "[";
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (i > 0) {
+      idArray += ',';
+    }
+    idArray += std::to_string(ids[i]);
+  }
+  idArray += ']';
+  return idArray;
+}
+
+// 1-based rank of a member among the live posts of its collection.
+bool positionOf(Database::Connection& conn,
+                int64_t collectionId,
+                int64_t postId,
+                int64_t sortKey,
+                int& position,
+                std::string& errorMessage) {
+  const char* sql =
+      "SELECT COUNT(1) FROM collection_posts cp "
+      "JOIN posts p ON p.id = cp.post_id "
+      "WHERE cp.collection_id = ? AND p.is_deleted = 0 AND (cp.sort_key, cp.post_id) <= (?, ?);";
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int64(stmt, 1, collectionId);
+  sqlite3_bind_int64(stmt, 2, sortKey);
+  sqlite3_bind_int64(stmt, 3, postId);
+  const int rc = sqlite3_step(stmt);
+  if (rc == SQLITE_ROW) {
+    position = sqlite3_column_int(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+  if (rc != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
   return true;
@@ -127,8 +352,7 @@ bool CollectionRepository::listCollectionsByOwner(int64_t ownerId,
 
   const char* sql =
       "SELECT c.id, c.name, c.description, c.owner_id, u.username, c.created_at, c.updated_at, c.is_deleted, "
-      "(SELECT COUNT(1) FROM collection_posts cp JOIN posts p ON p.id = cp.post_id "
-      " WHERE cp.collection_id = c.id AND p.is_deleted = 0) AS post_count "
+      "c.post_count "
       "FROM collections c "
       "JOIN users u ON u.id = c.owner_id "
       "WHERE c.owner_id = ? AND c.is_deleted = 0 "
@@ -161,8 +385,7 @@ std::optional<Collection> CollectionRepository::findById(int64_t collectionId, b
 
   const char* sql =
       "SELECT c.id, c.name, c.description, c.owner_id, u.username, c.created_at, c.updated_at, c.is_deleted, "
-      "(SELECT COUNT(1) FROM collection_posts cp JOIN posts p ON p.id = cp.post_id "
-      " WHERE cp.collection_id = c.id AND p.is_deleted = 0) AS post_count "
+      "c.post_count "
       "FROM collections c "
       "JOIN users u ON u.id = c.owner_id "
       "WHERE c.id = ? AND (? = 1 OR c.is_deleted = 0) "
@@ -201,12 +424,12 @@ bool CollectionRepository::listPostsInCollection(int64_t collectionId,
 
   const char* sql =
       "SELECT p.id, p.title, p.content_markdown, p.author_id, u.username, p.created_at, p.updated_at, p.is_deleted, "
-      "cp.position "
+      "ROW_NUMBER() OVER (ORDER BY cp.sort_key ASC, cp.post_id ASC) AS position "
       "FROM collection_posts cp "
       "JOIN posts p ON p.id = cp.post_id "
       "JOIN users u ON u.id = p.author_id "
       "WHERE cp.collection_id = ? AND p.is_deleted = 0 "
-      "ORDER BY cp.position ASC;";
+      "ORDER BY cp.sort_key ASC, cp.post_id ASC;";
 
   sqlite3_stmt* stmt = nullptr;
   if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -230,299 +453,419 @@ bool CollectionRepository::addPostToCollection(int64_t collectionId,
                                                int64_t postId,
                                                std::string& errorCode,
                                                std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorCode = "DB_ERROR";
-    errorMessage = dbError;
+  errorCode = "DB_ERROR";
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  if (!db_.exec(db, "BEGIN;", errorMessage)) {
-    errorCode = "DB_ERROR";
-    sqlite3_close(db);
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
 
-  sqlite3_stmt* checkCollectionStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "SELECT id FROM collections WHERE id = ? AND is_deleted = 0 LIMIT 1;",
-                         -1,
-                         &checkCollectionStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  bool found = false;
+  if (!rowExists(conn, "SELECT 1 FROM collections WHERE id = ? AND is_deleted = 0 LIMIT 1;", collectionId, found,
+                 errorMessage)) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(checkCollectionStmt, 1, collectionId);
-  const int collectionRc = sqlite3_step(checkCollectionStmt);
-  sqlite3_finalize(checkCollectionStmt);
-  if (collectionRc != SQLITE_ROW) {
+  if (!found) {
+    rollback(conn);
     errorCode = "COLLECTION_NOT_FOUND";
     errorMessage = "collection not found";
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
     return false;
   }
 
-  sqlite3_stmt* checkPostStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "SELECT id FROM posts WHERE id = ? AND is_deleted = 0 LIMIT 1;",
-                         -1,
-                         &checkPostStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  if (!rowExists(conn, "SELECT 1 FROM posts WHERE id = ? AND is_deleted = 0 LIMIT 1;", postId, found, errorMessage)) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(checkPostStmt, 1, postId);
-  const int postRc = sqlite3_step(checkPostStmt);
-  sqlite3_finalize(checkPostStmt);
-  if (postRc != SQLITE_ROW) {
+  if (!found) {
+    rollback(conn);
     errorCode = "POST_NOT_FOUND";
     errorMessage = "post not found";
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
     return false;
   }
 
-  sqlite3_stmt* existsStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "SELECT 1 FROM collection_posts WHERE collection_id = ? AND post_id = ? LIMIT 1;",
-                         -1,
-                         &existsStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  // MAX(sort_key) is a single probe of idx_collection_posts_order, and an
+  // existing membership trips the primary key.
+  const char* insertSql =
+      "INSERT INTO collection_posts(collection_id, post_id, sort_key, created_at) "
+      "SELECT ?1, ?2, COALESCE(MAX(sort_key), 0) + ?3, strftime('%Y-%m-%dT%H:%M:%SZ','now') "
+      "FROM collection_posts WHERE collection_id = ?1;";
+  sqlite3_stmt* insertStmt = conn.prepare(insertSql, errorMessage);
+  if (insertStmt == nullptr) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(existsStmt, 1, collectionId);
-  sqlite3_bind_int64(existsStmt, 2, postId);
-  const int existsRc = sqlite3_step(existsStmt);
-  sqlite3_finalize(existsStmt);
-  if (existsRc == SQLITE_ROW) {
-    errorCode = "COLLECTION_POST_EXISTS";
-    errorMessage = "post already in collection";
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  sqlite3_bind_int64(insertStmt, 1, collectionId);
+  sqlite3_bind_int64(insertStmt, 2, postId);
+  sqlite3_bind_int64(insertStmt, 3, kSortKeyGap);
+  const int insertRc = sqlite3_step(insertStmt);
+  if (insertRc != SQLITE_DONE) {
+    if (insertRc == SQLITE_CONSTRAINT || insertRc == SQLITE_CONSTRAINT_PRIMARYKEY) {
+      errorCode = "COLLECTION_POST_EXISTS";
+      errorMessage = "post already in collection";
+    } else {
+      errorMessage = sqlite3_errmsg(conn.get());
+    }
+    rollback(conn);
     return false;
   }
 
-  int nextPosition = 1;
-  sqlite3_stmt* posStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "SELECT COALESCE(MAX(position), 0) + 1 FROM collection_posts WHERE collection_id = ?;",
-                         -1,
-                         &posStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  if (!touchCollection(conn, collectionId, 1, errorMessage)) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(posStmt, 1, collectionId);
-  if (sqlite3_step(posStmt) == SQLITE_ROW) {
-    nextPosition = sqlite3_column_int(posStmt, 0);
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
   }
-  sqlite3_finalize(posStmt);
+  return true;
+}
 
-  sqlite3_stmt* insertStmt = nullptr;
-  if (sqlite3_prepare_v2(
-          db,
-          "INSERT INTO collection_posts(collection_id, post_id, position, created_at) "
-          "VALUES(?, ?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'));",
-          -1,
-          &insertStmt,
-          nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+bool CollectionRepository::removePostFromCollection(int64_t collectionId,
+                                                    int64_t postId,
+                                                    std::string& errorCode,
+                                                    std::string& errorMessage) const {
+  errorCode = "DB_ERROR";
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
-  sqlite3_bind_int64(insertStmt, 1, collectionId);
-  sqlite3_bind_int64(insertStmt, 2, postId);
-  sqlite3_bind_int(insertStmt, 3, nextPosition);
 
-  if (sqlite3_step(insertStmt) != SQLITE_DONE) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(insertStmt);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
-  sqlite3_finalize(insertStmt);
 
-  sqlite3_stmt* updateCollectionStmt = nullptr;
-  if (sqlite3_prepare_v2(
-          db,
-          "UPDATE collections SET updated_at = strftime('%Y-%m-%dT%H:%M:%SZ','now') WHERE id = ?;",
-          -1,
-          &updateCollectionStmt,
-          nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  // Later members keep their keys; their public positions shift on read.
+  // post_count only counts live posts, so removing a deleted one leaves it.
+  const char* deleteSql =
+      "DELETE FROM collection_posts WHERE collection_id = ? AND post_id = ? "
+      "RETURNING (SELECT p.is_deleted = 0 FROM posts p WHERE p.id = collection_posts.post_id);";
+  sqlite3_stmt* deleteStmt = conn.prepare(deleteSql, errorMessage);
+  if (deleteStmt == nullptr) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(updateCollectionStmt, 1, collectionId);
-  if (sqlite3_step(updateCollectionStmt) != SQLITE_DONE) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(updateCollectionStmt);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  sqlite3_bind_int64(deleteStmt, 1, collectionId);
+  sqlite3_bind_int64(deleteStmt, 2, postId);
+  const int deleteRc = sqlite3_step(deleteStmt);
+  if (deleteRc == SQLITE_DONE) {
+    rollback(conn);
+    errorCode = "COLLECTION_POST_NOT_FOUND";
+    errorMessage = "post is not in collection";
+    return false;
+  }
+  if (deleteRc != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
     return false;
   }
-  sqlite3_finalize(updateCollectionStmt);
+  const bool removedLive = sqlite3_column_int(deleteStmt, 0) != 0;
+  sqlite3_reset(deleteStmt);
 
-  if (!db_.exec(db, "COMMIT;", errorMessage)) {
-    errorCode = "DB_ERROR";
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  if (!touchCollection(conn, collectionId, removedLive ? -1 : 0, errorMessage)) {
+    rollback(conn);
     return false;
   }
 
-  sqlite3_close(db);
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
   return true;
 }
 
-bool CollectionRepository::removePostFromCollection(int64_t collectionId,
-                                                    int64_t postId,
-                                                    std::string& errorCode,
-                                                    std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorCode = "DB_ERROR";
-    errorMessage = dbError;
+bool CollectionRepository::movePostInCollection(int64_t collectionId,
+                                                int64_t postId,
+                                                int position,
+                                                int& newPosition,
+                                                std::string& errorCode,
+                                                std::string& errorMessage) const {
+  newPosition = 0;
+  errorCode = "DB_ERROR";
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  if (!db_.exec(db, "BEGIN;", errorMessage)) {
-    errorCode = "DB_ERROR";
-    sqlite3_close(db);
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
 
-  int removedPosition = 0;
-  sqlite3_stmt* findStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "SELECT position FROM collection_posts WHERE collection_id = ? AND post_id = ? LIMIT 1;",
-                         -1,
-                         &findStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  const char* memberSql =
+      "SELECT 1 FROM collection_posts cp "
+      "JOIN collections c ON c.id = cp.collection_id "
+      "JOIN posts p ON p.id = cp.post_id "
+      "WHERE cp.collection_id = ? AND cp.post_id = ? AND c.is_deleted = 0 AND p.is_deleted = 0 "
+      "LIMIT 1;";
+  sqlite3_stmt* memberStmt = conn.prepare(memberSql, errorMessage);
+  if (memberStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_int64(memberStmt, 1, collectionId);
+  sqlite3_bind_int64(memberStmt, 2, postId);
+  const int memberRc = sqlite3_step(memberStmt);
+  sqlite3_reset(memberStmt);
+  if (memberRc != SQLITE_ROW) {
+    if (memberRc == SQLITE_DONE) {
+      errorCode = "COLLECTION_POST_NOT_FOUND";
+      errorMessage = "post is not in collection";
+    } else {
+      errorMessage = sqlite3_errmsg(conn.get());
+    }
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(findStmt, 1, collectionId);
-  sqlite3_bind_int64(findStmt, 2, postId);
-  if (sqlite3_step(findStmt) == SQLITE_ROW) {
-    removedPosition = sqlite3_column_int(findStmt, 0);
+
+  int64_t sortKey = 0;
+  if (!sortKeyForPosition(conn, collectionId, postId, position, sortKey, errorMessage)) {
+    rollback(conn);
+    return false;
   }
-  sqlite3_finalize(findStmt);
 
-  if (removedPosition == 0) {
-    errorCode = "COLLECTION_POST_NOT_FOUND";
-    errorMessage = "post is not in collection";
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  sqlite3_stmt* updateStmt = conn.prepare(
+      "UPDATE collection_posts SET sort_key = ? WHERE collection_id = ? AND post_id = ?;", errorMessage);
+  if (updateStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_int64(updateStmt, 1, sortKey);
+  sqlite3_bind_int64(updateStmt, 2, collectionId);
+  sqlite3_bind_int64(updateStmt, 3, postId);
+  if (sqlite3_step(updateStmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
     return false;
   }
 
-  sqlite3_stmt* deleteStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "DELETE FROM collection_posts WHERE collection_id = ? AND post_id = ?;",
-                         -1,
-                         &deleteStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  if (!positionOf(conn, collectionId, postId, sortKey, newPosition, errorMessage) ||
+      !touchCollection(conn, collectionId, 0, errorMessage)) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(deleteStmt, 1, collectionId);
-  sqlite3_bind_int64(deleteStmt, 2, postId);
-  if (sqlite3_step(deleteStmt) != SQLITE_DONE) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(deleteStmt);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
     return false;
   }
-  sqlite3_finalize(deleteStmt);
+  return true;
+}
 
-  sqlite3_stmt* reorderStmt = nullptr;
-  if (sqlite3_prepare_v2(db,
-                         "UPDATE collection_posts SET position = position - 1 "
-                         "WHERE collection_id = ? AND position > ?;",
-                         -1,
-                         &reorderStmt,
-                         nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+bool CollectionRepository::addPostsToCollection(int64_t collectionId,
+                                                const std::vector<int64_t>& postIds,
+                                                std::string& errorCode,
+                                                std::string& errorMessage) const {
+  errorCode = "DB_ERROR";
+  if (postIds.empty()) {
+    return true;
+  }
+  const std::string idArray = idArrayJson(postIds);
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
-  sqlite3_bind_int64(reorderStmt, 1, collectionId);
-  sqlite3_bind_int(reorderStmt, 2, removedPosition);
-  if (sqlite3_step(reorderStmt) != SQLITE_DONE) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(reorderStmt);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
-  sqlite3_finalize(reorderStmt);
 
-  sqlite3_stmt* updateCollectionStmt = nullptr;
-  if (sqlite3_prepare_v2(
-          db,
-          "UPDATE collections SET updated_at = strftime('%Y-%m-%dT%H:%M:%SZ','now') WHERE id = ?;",
-          -1,
-          &updateCollectionStmt,
-          nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  bool found = false;
+  if (!rowExists(conn, "SELECT 1 FROM collections WHERE id = ? AND is_deleted = 0 LIMIT 1;", collectionId, found,
+                 errorMessage)) {
+    rollback(conn);
     return false;
   }
-  sqlite3_bind_int64(updateCollectionStmt, 1, collectionId);
-  if (sqlite3_step(updateCollectionStmt) != SQLITE_DONE) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(updateCollectionStmt);
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  if (!found) {
+    rollback(conn);
+    errorCode = "COLLECTION_NOT_FOUND";
+    errorMessage = "collection not found";
     return false;
   }
-  sqlite3_finalize(updateCollectionStmt);
 
-  if (!db_.exec(db, "COMMIT;", errorMessage)) {
-    errorCode = "DB_ERROR";
-    rollback(db_, db, errorMessage);
-    sqlite3_close(db);
+  // One pass over the whole list finds the first id that is not a live post
+  // or is already a member; either rejects the batch.
+  const char* checkSql =
+      "SELECT k.value, p.id IS NULL "
+      "FROM json_each(?2) k "
+      "LEFT JOIN posts p ON p.id = k.value AND p.is_deleted = 0 "
+      "WHERE p.id IS NULL "
+      "   OR EXISTS(SELECT 1 FROM collection_posts cp WHERE cp.collection_id = ?1 AND cp.post_id = k.value) "
+      "ORDER BY k.key "
+      "LIMIT 1;";
+  sqlite3_stmt* checkStmt = conn.prepare(checkSql, errorMessage);
+  if (checkStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_int64(checkStmt, 1, collectionId);
+  sqlite3_bind_text(checkStmt, 2, idArray.c_str(), -1, SQLITE_TRANSIENT);
+  const int checkRc = sqlite3_step(checkStmt);
+  if (checkRc == SQLITE_ROW) {
+    const std::string badId = std::to_string(sqlite3_column_int64(checkStmt, 0));
+    if (sqlite3_column_int(checkStmt, 1) != 0) {
+      errorCode = "POST_NOT_FOUND";
+      errorMessage = "post " + badId + " not found";
+    } else {
+      errorCode = "COLLECTION_POST_EXISTS";
+      errorMessage = "post " + badId + " already in collection";
+    }
+    sqlite3_reset(checkStmt);
+    rollback(conn);
+    return false;
+  }
+  sqlite3_reset(checkStmt);
+  if (checkRc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
     return false;
   }
 
-  sqlite3_close(db);
+  sqlite3_stmt* maxStmt =
+      conn.prepare("SELECT MAX(sort_key) FROM collection_posts WHERE collection_id = ?;", errorMessage);
+  if (maxStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_int64(maxStmt, 1, collectionId);
+  std::optional<int64_t> last;
+  if (!queryOptionalInt64(maxStmt, conn, last, errorMessage)) {
+    rollback(conn);
+    return false;
+  }
+
+  // The whole list is appended by one statement, each id one gap after the
+  // previous in list order.
+  const char* insertSql =
+      "INSERT INTO collection_posts(collection_id, post_id, sort_key, created_at) "
+      "SELECT ?1, k.value, ?3 + (k.key + 1) * ?4, strftime('%Y-%m-%dT%H:%M:%SZ','now') "
+      "FROM json_each(?2) k;";
+  sqlite3_stmt* insertStmt = conn.prepare(insertSql, errorMessage);
+  if (insertStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_int64(insertStmt, 1, collectionId);
+  sqlite3_bind_text(insertStmt, 2, idArray.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(insertStmt, 3, last.value_or(0));
+  sqlite3_bind_int64(insertStmt, 4, kSortKeyGap);
+  if (sqlite3_step(insertStmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+
+  if (!touchCollection(conn, collectionId, static_cast<int>(postIds.size()), errorMessage)) {
+    rollback(conn);
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+  return true;
+}
+
+bool CollectionRepository::reorderCollectionPosts(int64_t collectionId,
+                                                  const std::vector<int64_t>& postIds,
+                                                  std::string& errorCode,
+                                                  std::string& errorMessage) const {
+  errorCode = "DB_ERROR";
+  if (postIds.empty()) {
+    return true;
+  }
+  const std::string idArray = idArrayJson(postIds);
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+
+  // Current keys of the listed posts in list order; NULL marks an id that is
+  // not a live member.
+  const char* keysSql =
+      "SELECT k.value, CASE WHEN p.id IS NULL THEN NULL ELSE cp.sort_key END "
+      "FROM json_each(?2) k "
+      "LEFT JOIN collection_posts cp ON cp.collection_id = ?1 AND cp.post_id = k.value "
+      "LEFT JOIN posts p ON p.id = cp.post_id AND p.is_deleted = 0 "
+      "ORDER BY k.key;";
+  sqlite3_stmt* keysStmt = conn.prepare(keysSql, errorMessage);
+  if (keysStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_int64(keysStmt, 1, collectionId);
+  sqlite3_bind_text(keysStmt, 2, idArray.c_str(), -1, SQLITE_TRANSIENT);
+
+  std::vector<int64_t> sortKeys;
+  sortKeys.reserve(postIds.size());
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(keysStmt)) == SQLITE_ROW) {
+    if (sqlite3_column_type(keysStmt, 1) == SQLITE_NULL) {
+      errorCode = "COLLECTION_POST_NOT_FOUND";
+      errorMessage = "post " + std::to_string(sqlite3_column_int64(keysStmt, 0)) + " is not in collection";
+      sqlite3_reset(keysStmt);
+      rollback(conn);
+      return false;
+    }
+    sortKeys.push_back(sqlite3_column_int64(keysStmt, 1));
+  }
+  sqlite3_reset(keysStmt);
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+
+  // The listed posts trade keys among themselves: the slots they occupy stay
+  // put and are refilled in list order, so unlisted members do not move.
+  std::sort(sortKeys.begin(), sortKeys.end());
+  sqlite3_stmt* updateStmt = conn.prepare(
+      "UPDATE collection_posts SET sort_key = ? WHERE collection_id = ? AND post_id = ?;", errorMessage);
+  if (updateStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  for (size_t i = 0; i < postIds.size(); ++i) {
+    sqlite3_reset(updateStmt);
+    sqlite3_bind_int64(updateStmt, 1, sortKeys[i]);
+    sqlite3_bind_int64(updateStmt, 2, collectionId);
+    sqlite3_bind_int64(updateStmt, 3, postIds[i]);
+    if (sqlite3_step(updateStmt) != SQLITE_DONE) {
+      errorMessage = sqlite3_errmsg(conn.get());
+      rollback(conn);
+      return false;
+    }
+  }
+
+  if (!touchCollection(conn, collectionId, 0, errorMessage)) {
+    rollback(conn);
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
   return true;
 }
 
@@ -539,11 +882,14 @@ bool CollectionRepository::listCollectionsForPost(int64_t postId,
   }
 
   const char* sql =
-      "SELECT c.id, c.name, cp.position "
+      "SELECT c.id, c.name, "
+      "(SELECT COUNT(1) FROM collection_posts other JOIN posts p ON p.id = other.post_id "
+      " WHERE other.collection_id = cp.collection_id AND p.is_deleted = 0 "
+      " AND (other.sort_key, other.post_id) <= (cp.sort_key, cp.post_id)) AS position "
       "FROM collection_posts cp "
       "JOIN collections c ON c.id = cp.collection_id "
       "WHERE cp.post_id = ? AND c.is_deleted = 0 "
-      "ORDER BY c.updated_at DESC, cp.position ASC;";
+      "ORDER BY c.updated_at DESC, position ASC;";
 
   sqlite3_stmt* stmt = nullptr;
   if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
@@ -569,104 +915,90 @@ bool CollectionRepository::listCollectionsForPost(int64_t postId,
 
 bool CollectionRepository::getCollectionPostNeighbors(int64_t collectionId,
                                                       int64_t postId,
-                                                      std::optional<Post>& prev,
-                                                      std::optional<Post>& next,
-                                                      int& currentPosition,
+                                                      CollectionNavigation& navigation,
                                                       std::string& errorCode,
                                                       std::string& errorMessage) const {
-  prev.reset();
-  next.reset();
-  currentPosition = 0;
-
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorCode = "DB_ERROR";
-    errorMessage = dbError;
+  navigation = CollectionNavigation{};
+  errorCode = "DB_ERROR";
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  sqlite3_stmt* currentStmt = nullptr;
-  const char* currentSql =
-      "SELECT cp.position "
-      "FROM collection_posts cp "
-      "JOIN collections c ON c.id = cp.collection_id "
-      "JOIN posts p ON p.id = cp.post_id "
-      "WHERE cp.collection_id = ? AND cp.post_id = ? AND c.is_deleted = 0 AND p.is_deleted = 0 "
-      "LIMIT 1;";
+  // One pass over the collection's order index yields the post's rank, the
+  // member count and both neighbours' ids and titles.
+  const char* sql =
+      "SELECT prev_id, prev_title, next_id, next_title, position, total FROM ("
+      "  SELECT cp.post_id, "
+      "    LAG(cp.post_id) OVER w AS prev_id, LAG(p.title) OVER w AS prev_title, "
+      "    LEAD(cp.post_id) OVER w AS next_id, LEAD(p.title) OVER w AS next_title, "
+      "    ROW_NUMBER() OVER w AS position, COUNT(1) OVER () AS total "
+      "  FROM collection_posts cp "
+      "  JOIN collections c ON c.id = cp.collection_id "
+      "  JOIN posts p ON p.id = cp.post_id "
+      "  WHERE cp.collection_id = ?1 AND c.is_deleted = 0 AND p.is_deleted = 0 "
+      "  WINDOW w AS (ORDER BY cp.sort_key ASC, cp.post_id ASC)"
+      ") WHERE post_id = ?2;";
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int64(stmt, 1, collectionId);
+  sqlite3_bind_int64(stmt, 2, postId);
 
-  if (sqlite3_prepare_v2(db, currentSql, -1, &currentStmt, nullptr) != SQLITE_OK) {
-    errorCode = "DB_ERROR";
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  const int rc = sqlite3_step(stmt);
+  if (rc == SQLITE_DONE) {
+    errorCode = "POST_NOT_IN_COLLECTION";
+    errorMessage = "post is not in the specified collection";
+    return false;
+  }
+  if (rc != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
 
-  sqlite3_bind_int64(currentStmt, 1, collectionId);
-  sqlite3_bind_int64(currentStmt, 2, postId);
-  if (sqlite3_step(currentStmt) == SQLITE_ROW) {
-    currentPosition = sqlite3_column_int(currentStmt, 0);
+  if (sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+    navigation.prev = CollectionNeighbor{sqlite3_column_int64(stmt, 0), textOrEmpty(stmt, 1)};
+  }
+  if (sqlite3_column_type(stmt, 2) != SQLITE_NULL) {
+    navigation.next = CollectionNeighbor{sqlite3_column_int64(stmt, 2), textOrEmpty(stmt, 3)};
   }
-  sqlite3_finalize(currentStmt);
+  navigation.position = sqlite3_column_int(stmt, 4);
+  navigation.total = sqlite3_column_int(stmt, 5);
+  sqlite3_reset(stmt);
+  return true;
+}
 
-  if (currentPosition == 0) {
-    errorCode = "POST_NOT_IN_COLLECTION";
-    errorMessage = "post is not in the specified collection";
-    sqlite3_close(db);
+bool CollectionRepository::listCollectionOrder(int64_t collectionId,
+                                               std::vector<CollectionNeighbor>& members,
+                                               std::string& errorMessage) const {
+  members.clear();
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  {
-    std::string sql =
-        "SELECT p.id, p.title, p.content_markdown, p.author_id, u.username, p.created_at, p.updated_at, p.is_deleted, "
-        "cp.position "
-        "FROM collection_posts cp "
-        "JOIN posts p ON p.id = cp.post_id "
-        "JOIN users u ON u.id = p.author_id "
-        "WHERE cp.collection_id = ? AND cp.position < ? AND p.is_deleted = 0 "
-        "ORDER BY cp.position DESC "
-        "LIMIT 1;";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-      errorCode = "DB_ERROR";
-      errorMessage = sqlite3_errmsg(db);
-      sqlite3_close(db);
-      return false;
-    }
-    sqlite3_bind_int64(stmt, 1, collectionId);
-    sqlite3_bind_int(stmt, 2, currentPosition);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-      prev = rowToPost(stmt);
-    }
-    sqlite3_finalize(stmt);
-  }
-
-  {
-    std::string sql =
-        "SELECT p.id, p.title, p.content_markdown, p.author_id, u.username, p.created_at, p.updated_at, p.is_deleted, "
-        "cp.position "
-        "FROM collection_posts cp "
-        "JOIN posts p ON p.id = cp.post_id "
-        "JOIN users u ON u.id = p.author_id "
-        "WHERE cp.collection_id = ? AND cp.position > ? AND p.is_deleted = 0 "
-        "ORDER BY cp.position ASC "
-        "LIMIT 1;";
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-      errorCode = "DB_ERROR";
-      errorMessage = sqlite3_errmsg(db);
-      sqlite3_close(db);
-      return false;
-    }
-    sqlite3_bind_int64(stmt, 1, collectionId);
-    sqlite3_bind_int(stmt, 2, currentPosition);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-      next = rowToPost(stmt);
-    }
-    sqlite3_finalize(stmt);
+  const char* sql =
+      "SELECT cp.post_id, p.title "
+      "FROM collection_posts cp "
+      "JOIN collections c ON c.id = cp.collection_id "
+      "JOIN posts p ON p.id = cp.post_id "
+      "WHERE cp.collection_id = ? AND c.is_deleted = 0 AND p.is_deleted = 0 "
+      "ORDER BY cp.sort_key ASC, cp.post_id ASC;";
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
   }
+  sqlite3_bind_int64(stmt, 1, collectionId);
 
-  sqlite3_close(db);
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    members.push_back(CollectionNeighbor{sqlite3_column_int64(stmt, 0), textOrEmpty(stmt, 1)});
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
   return true;
 }
 
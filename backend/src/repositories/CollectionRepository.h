@@ -41,18 +41,47 @@ class CollectionRepository {
                                 std::string& errorCode,
                                 std::string& errorMessage) const;
 
+  // Moves a member to the 1-based `position` among the collection's live
+  // posts, clamped to the end, by rewriting only its own sort key.
+  // `newPosition` is where it ended up.
+  bool movePostInCollection(int64_t collectionId,
+                            int64_t postId,
+                            int position,
+                            int& newPosition,
+                            std::string& errorCode,
+                            std::string& errorMessage) const;
+
+  // Appends `postIds` in list order in one transaction. The batch is
+  // rejected if any id is not a live post or is already a member.
+  bool addPostsToCollection(int64_t collectionId,
+                            const std::vector<int64_t>& postIds,
+                            std::string& errorCode,
+                            std::string& errorMessage) const;
+
+  // Puts the listed members in list order within the slots they already
+  // occupy. Listing every member is a full reorder; unlisted members keep
+  // their places. Ids must be distinct live members.
+  bool reorderCollectionPosts(int64_t collectionId,
+                              const std::vector<int64_t>& postIds,
+                              std::string& errorCode,
+                              std::string& errorMessage) const;
+
   bool listCollectionsForPost(int64_t postId,
                               std::vector<PostCollectionMembership>& memberships,
                               std::string& errorMessage) const;
 
   bool getCollectionPostNeighbors(int64_t collectionId,
                                   int64_t postId,
-                                  std::optional<Post>& prev,
-                                  std::optional<Post>& next,
-                                  int& currentPosition,
+                                  CollectionNavigation& navigation,
                                   std::string& errorCode,
                                   std::string& errorMessage) const;
 
+  // Live member posts of a live collection in order; empty when the
+  // collection does not exist or was deleted.
+  bool listCollectionOrder(int64_t collectionId,
+                           std::vector<CollectionNeighbor>& members,
+                           std::string& errorMessage) const;
+
  private:
   const Database& db_;
 };
@@ -0,0 +1,91 @@
+#include "repositories/CommentPageCache.h"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+namespace blog {
+
+CommentPageCache::CommentPageCache(const InteractionRepository& interactionRepository,
+                                   size_t maxPosts,
+                                   metrics::MetricsRegistry& metrics)
+    : interactionRepository_(interactionRepository),
+      capacityPerShard_((maxPosts + kShardCount - 1) / kShardCount),
+      hits_(metrics.counter("blog_cache_lookups_total", "Cache lookups by cache and result",
+                            {{"cache", "comment_pages"}, {"result", "hit"}})),
+      misses_(metrics.counter("blog_cache_lookups_total", "Cache lookups by cache and result",
+                              {{"cache", "comment_pages"}, {"result", "miss"}})) {}
+
+CommentPageCache::Shard& CommentPageCache::shardFor(int64_t postId) {
+  return shards_[static_cast<uint64_t>(postId) % kShardCount];
+}
+
+void CommentPageCache::slice(const Page& page, int pageSize, std::vector<Comment>& comments, bool& hasMore) {
+  const size_t count = std::min(page.comments.size(), static_cast<size_t>(pageSize));
+  comments.assign(page.comments.begin(), page.comments.begin() + static_cast<std::ptrdiff_t>(count));
+  hasMore = page.comments.size() > count || page.hasMore;
+}
+
+bool CommentPageCache::firstPage(int64_t postId,
+                                 int pageSize,
+                                 std::vector<Comment>& comments,
+                                 bool& hasMore,
+                                 int& total,
+                                 std::string& errorMessage) {
+  pageSize = std::clamp(pageSize, 1, kMaxPageSize);
+
+  Shard& shard = shardFor(postId);
+  uint64_t epoch = 0;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.posts.find(postId);
+    if (it != shard.posts.end()) {
+      shard.recency.splice(shard.recency.begin(), shard.recency, it->second.recency);
+      slice(*it->second.page, pageSize, comments, hasMore);
+      total = it->second.page->total;
+      hits_.inc();
+      return true;
+    }
+    epoch = shard.epoch;
+  }
+  misses_.inc();
+
+  // One extra row tells whether a second page exists.
+  auto page = std::make_shared<Page>();
+  if (!interactionRepository_.listCommentsPage(postId, std::nullopt, kMaxPageSize + 1, page->comments, errorMessage) ||
+      !interactionRepository_.countComments(postId, page->total, errorMessage)) {
+    return false;
+  }
+  if (page->comments.size() > static_cast<size_t>(kMaxPageSize)) {
+    page->comments.pop_back();
+    page->hasMore = true;
+  }
+  slice(*page, pageSize, comments, hasMore);
+  total = page->total;
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (capacityPerShard_ == 0 || shard.epoch != epoch || shard.posts.count(postId) > 0) {
+    return true;
+  }
+  if (shard.posts.size() >= capacityPerShard_) {
+    shard.posts.erase(shard.recency.back());
+    shard.recency.pop_back();
+  }
+  shard.recency.push_front(postId);
+  shard.posts.emplace(postId, Entry{std::move(page), shard.recency.begin()});
+  return true;
+}
+
+void CommentPageCache::invalidate(int64_t postId) {
+  Shard& shard = shardFor(postId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  ++shard.epoch;
+  const auto it = shard.posts.find(postId);
+  if (it == shard.posts.end()) {
+    return;
+  }
+  shard.recency.erase(it->second.recency);
+  shard.posts.erase(it);
+}
+
+}  // namespace blog
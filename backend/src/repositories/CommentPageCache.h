@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "metrics/MetricsRegistry.h"
+#include "models/Comment.h"
+#include "repositories/InteractionRepository.h"
+
+namespace blog {
+
+// Caches the newest comments of recently read posts, so every reader of a hot
+// thread after the first is served from memory. One entry holds up to
+// kMaxPageSize comments plus the post's comment total and answers first-page
+// requests of any smaller size. Writers call invalidate() after their
+// transaction commits; a load that raced an invalidation is served but not
+// stored.
+class CommentPageCache {
+ public:
+  static constexpr int kMaxPageSize = 50;
+
+  CommentPageCache(const InteractionRepository& interactionRepository,
+                   size_t maxPosts,
+                   metrics::MetricsRegistry& metrics);
+
+  bool firstPage(int64_t postId,
+                 int pageSize,
+                 std::vector<Comment>& comments,
+                 bool& hasMore,
+                 int& total,
+                 std::string& errorMessage);
+  void invalidate(int64_t postId);
+
+ private:
+  struct Page {
+    std::vector<Comment> comments;
+    bool hasMore = false;
+    int total = 0;
+  };
+
+  struct Entry {
+    std::shared_ptr<const Page> page;
+    std::list<int64_t>::iterator recency;
+  };
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<int64_t, Entry> posts;
+    std::list<int64_t> recency;
+    uint64_t epoch = 0;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& shardFor(int64_t postId);
+  static void slice(const Page& page, int pageSize, std::vector<Comment>& comments, bool& hasMore);
+
+  const InteractionRepository& interactionRepository_;
+  size_t capacityPerShard_;
+  metrics::Counter& hits_;
+  metrics::Counter& misses_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace blog
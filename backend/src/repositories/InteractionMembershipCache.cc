@@ -0,0 +1,94 @@
+#include "repositories/InteractionMembershipCache.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace blog {
+namespace {
+
+bool containsSorted(const std::vector<int64_t>& ids, int64_t id) {
+  return std::binary_search(ids.begin(), ids.end(), id);
+}
+
+void setSorted(std::vector<int64_t>& ids, int64_t id, bool present) {
+  const auto it = std::lower_bound(ids.begin(), ids.end(), id);
+  const bool found = it != ids.end() && *it == id;
+  if (present && !found) {
+    ids.insert(it, id);
+  } else if (!present && found) {
+    ids.erase(it);
+  }
+}
+
+}  // namespace
+
+InteractionMembershipCache::InteractionMembershipCache(size_t capacity, Loader loader)
+    : capacityPerShard_((capacity + kShardCount - 1) / kShardCount), loader_(std::move(loader)) {}
+
+bool InteractionMembershipCache::enabled() const {
+  return capacityPerShard_ > 0;
+}
+
+InteractionMembershipCache::Shard& InteractionMembershipCache::shardFor(int64_t userId) {
+  return shards_[static_cast<uint64_t>(userId) % kShardCount];
+}
+
+void InteractionMembershipCache::fillFrom(const Sets& sets,
+                                          std::unordered_map<int64_t, PostInteractionSummary>& summaries) {
+  for (auto& [postId, summary] : summaries) {
+    summary.likedByMe = containsSorted(sets.liked, postId);
+    summary.favoritedByMe = containsSorted(sets.favorited, postId);
+  }
+}
+
+bool InteractionMembershipCache::fill(int64_t userId,
+                                      std::unordered_map<int64_t, PostInteractionSummary>& summaries,
+                                      std::string& errorMessage) {
+  Shard& shard = shardFor(userId);
+  uint64_t epoch = 0;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.users.find(userId);
+    if (it != shard.users.end()) {
+      shard.recency.splice(shard.recency.begin(), shard.recency, it->second.recency);
+      fillFrom(it->second, summaries);
+      return true;
+    }
+    epoch = shard.epoch;
+  }
+
+  Sets loaded;
+  if (!loader_(userId, loaded.liked, loaded.favorited, errorMessage)) {
+    return false;
+  }
+  std::sort(loaded.liked.begin(), loaded.liked.end());
+  std::sort(loaded.favorited.begin(), loaded.favorited.end());
+  fillFrom(loaded, summaries);
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (capacityPerShard_ == 0 || shard.epoch != epoch || shard.users.count(userId) > 0) {
+    return true;
+  }
+  if (shard.users.size() >= capacityPerShard_) {
+    shard.users.erase(shard.recency.back());
+    shard.recency.pop_back();
+  }
+  shard.recency.push_front(userId);
+  loaded.recency = shard.recency.begin();
+  shard.users.emplace(userId, std::move(loaded));
+  return true;
+}
+
+void InteractionMembershipCache::apply(const InteractionToggle& toggle) {
+  Shard& shard = shardFor(toggle.userId);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  ++shard.epoch;
+  const auto it = shard.users.find(toggle.userId);
+  if (it == shard.users.end()) {
+    return;
+  }
+  auto& ids = toggle.kind == InteractionKind::Like ? it->second.liked : it->second.favorited;
+  setSorted(ids, toggle.postId, toggle.enabled);
+}
+
+}  // namespace blog
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "models/Interaction.h"
+
+namespace blog {
+
+// Per-user sets of liked and favorited post ids, kept as sorted vectors for
+// the most recently active users. Answers likedByMe/favoritedByMe for a whole
+// page with binary searches instead of two probes per post. A user's sets are
+// loaded on first use and patched in place on every acknowledged toggle; the
+// least recently used users are dropped once a shard is full.
+class InteractionMembershipCache {
+ public:
+  using Loader = std::function<bool(int64_t userId,
+                                    std::vector<int64_t>& likedPostIds,
+                                    std::vector<int64_t>& favoritedPostIds,
+                                    std::string& errorMessage)>;
+
+  InteractionMembershipCache(size_t capacity, Loader loader);
+
+  bool enabled() const;
+
+  // Sets likedByMe/favoritedByMe on every summary, keyed by post id.
+  bool fill(int64_t userId,
+            std::unordered_map<int64_t, PostInteractionSummary>& summaries,
+            std::string& errorMessage);
+  void apply(const InteractionToggle& toggle);
+
+ private:
+  struct Sets {
+    std::vector<int64_t> liked;
+    std::vector<int64_t> favorited;
+    std::list<int64_t>::iterator recency;
+  };
+
+  // `epoch` moves on every toggle for a user in the shard. A load that saw it
+  // move may have read state older than a toggle it raced with, so its result
+  // is used for that request but not cached.
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<int64_t, Sets> users;
+    std::list<int64_t> recency;
+    uint64_t epoch = 0;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& shardFor(int64_t userId);
+  static void fillFrom(const Sets& sets, std::unordered_map<int64_t, PostInteractionSummary>& summaries);
+
+  size_t capacityPerShard_;
+  Loader loader_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace blog
@@ -2,6 +2,11 @@
 
 #include <sqlite3.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+
 namespace blog {
 namespace {
 
@@ -23,6 +28,10 @@ Comment rowToComment(sqlite3_stmt* stmt) {
   comment.createdAt = textOrEmpty(stmt, 5);
   comment.updatedAt = textOrEmpty(stmt, 6);
   comment.isDeleted = sqlite3_column_int(stmt, 7) != 0;
+  comment.parentId = sqlite3_column_int64(stmt, 8);
+  comment.depth = sqlite3_column_int(stmt, 9);
+  comment.path = textOrEmpty(stmt, 10);
+  comment.replyCount = sqlite3_column_int(stmt, 11);
   return comment;
 }
 
@@ -40,129 +49,384 @@ Post rowToPost(sqlite3_stmt* stmt) {
   return post;
 }
 
-bool execLikeMutation(sqlite3* db,
-                      const char* insertSql,
-                      const char* deleteSql,
-                      int64_t postId,
-                      int64_t userId,
-                      bool enabled,
-                      std::string& errorMessage) {
-  sqlite3_stmt* stmt = nullptr;
-  const char* sql = enabled ? insertSql : deleteSql;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
+constexpr const char* kBumpStatsSql =
+    "INSERT INTO post_stats(post_id, like_count, favorite_count, comment_count) VALUES(?, ?, ?, ?) "
+    "ON CONFLICT(post_id) DO UPDATE SET "
+    "like_count = like_count + excluded.like_count, "
+    "favorite_count = favorite_count + excluded.favorite_count, "
+    "comment_count = comment_count + excluded.comment_count;";
+
+struct StatsDelta {
+  int likes = 0;
+  int favorites = 0;
+  int comments = 0;
+};
+
+constexpr int kMaxCommentDepth = 32;
+constexpr size_t kPathSegmentLength = 11;
+
+std::string pathSegment(int64_t commentId) {
+  char buffer[24];
+  std::snprintf(buffer, sizeof(buffer), "%010lld/", static_cast<long long>(commentId));
+  return buffer;
+}
+
+// Adds `delta` to reply_count of every comment named in `ancestorPath`.
+bool bumpReplyCounts(Database::Connection& conn,
+                     const std::string& ancestorPath,
+                     int delta,
+                     std::string& errorMessage) {
+  if (ancestorPath.empty()) {
+    return true;
+  }
+
+  std::string ids = "[";
+  for (size_t offset = 0; offset + kPathSegmentLength <= ancestorPath.size(); offset += kPathSegmentLength) {
+    if (offset > 0) {
+      ids += ",";
+    }
+    ids += std::to_string(std::stoll(ancestorPath.substr(offset, kPathSegmentLength - 1)));
+  }
+  ids += "]";
+
+  sqlite3_stmt* stmt = conn.prepare(
+      "UPDATE comments SET reply_count = reply_count + ?1 WHERE id IN (SELECT value FROM json_each(?2));",
+      errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int(stmt, 1, delta);
+  sqlite3_bind_text(stmt, 2, ids.c_str(), -1, SQLITE_TRANSIENT);
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+void rollback(Database::Connection& conn) {
+  sqlite3_exec(conn.get(), "ROLLBACK;", nullptr, nullptr, nullptr);
+}
+
+void appendEvents(int64_t postId, const StatsDelta& delta, std::vector<InteractionEvent>& events) {
+  if (delta.likes != 0) {
+    events.push_back(InteractionEvent{InteractionEventKind::Like, postId, delta.likes});
+  }
+  if (delta.favorites != 0) {
+    events.push_back(InteractionEvent{InteractionEventKind::Favorite, postId, delta.favorites});
+  }
+  if (delta.comments != 0) {
+    events.push_back(InteractionEvent{InteractionEventKind::Comment, postId, delta.comments});
+  }
+}
+
+// Applies `delta` to the post's post_stats row and records the matching
+// events, which the caller emits once its transaction commits.
+bool bumpStats(Database::Connection& conn,
+               int64_t postId,
+               const StatsDelta& delta,
+               std::vector<InteractionEvent>& events,
+               std::string& errorMessage) {
+  sqlite3_stmt* stmt = conn.prepare(kBumpStatsSql, errorMessage);
+  if (stmt == nullptr) {
     return false;
   }
 
   sqlite3_bind_int64(stmt, 1, postId);
-  sqlite3_bind_int64(stmt, 2, userId);
+  sqlite3_bind_int(stmt, 2, delta.likes);
+  sqlite3_bind_int(stmt, 3, delta.favorites);
+  sqlite3_bind_int(stmt, 4, delta.comments);
 
   if (sqlite3_step(stmt) != SQLITE_DONE) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
-  sqlite3_finalize(stmt);
+  appendEvents(postId, delta, events);
   return true;
 }
 
+// Applies an INSERT OR IGNORE / DELETE toggle and, only when it actually
+// changed a row, the matching post_stats delta. Runs inside the caller's
+// write transaction.
+bool applyToggle(Database::Connection& conn,
+                 const InteractionToggle& toggle,
+                 std::vector<InteractionEvent>& events,
+                 std::string& errorMessage) {
+  const bool isLike = toggle.kind == InteractionKind::Like;
+  const char* sql = nullptr;
+  if (isLike) {
+    sql = toggle.enabled ? "INSERT OR IGNORE INTO post_likes(post_id, user_id, created_at) "
+                           "VALUES(?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'));"
+                         : "DELETE FROM post_likes WHERE post_id = ? AND user_id = ?;";
+  } else {
+    sql = toggle.enabled ? "INSERT OR IGNORE INTO post_favorites(post_id, user_id, created_at) "
+                           "VALUES(?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'));"
+                         : "DELETE FROM post_favorites WHERE post_id = ? AND user_id = ?;";
+  }
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  sqlite3_bind_int64(stmt, 1, toggle.postId);
+  sqlite3_bind_int64(stmt, 2, toggle.userId);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+
+  if (sqlite3_changes(conn.get()) == 0) {
+    return true;
+  }
+
+  const int step = toggle.enabled ? 1 : -1;
+  StatsDelta delta;
+  delta.likes = isLike ? step : 0;
+  delta.favorites = isLike ? 0 : step;
+  return bumpStats(conn, toggle.postId, delta, events, errorMessage);
+}
+
 }  // namespace
 
-InteractionRepository::InteractionRepository(const Database& db) : db_(db) {}
+InteractionRepository::InteractionRepository(const Database& db, EventListener onEvent)
+    : db_(db), onEvent_(std::move(onEvent)) {}
+
+void InteractionRepository::emit(const std::vector<InteractionEvent>& events) const {
+  if (!onEvent_) {
+    return;
+  }
+  for (const auto& event : events) {
+    onEvent_(event);
+  }
+}
 
 bool InteractionRepository::getPostInteractionSummary(int64_t postId,
                                                       const std::optional<int64_t>& currentUserId,
                                                       PostInteractionSummary& summary,
                                                       std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
   const char* sql =
-      "SELECT "
-      "  (SELECT COUNT(1) FROM post_likes WHERE post_id = ?), "
-      "  (SELECT COUNT(1) FROM post_favorites WHERE post_id = ?), "
-      "  (SELECT COUNT(1) FROM comments WHERE post_id = ? AND is_deleted = 0), "
-      "  (SELECT COUNT(1) FROM post_likes WHERE post_id = ? AND user_id = ?), "
-      "  (SELECT COUNT(1) FROM post_favorites WHERE post_id = ? AND user_id = ?);";
-
-  sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+      "SELECT s.like_count, s.favorite_count, s.comment_count, "
+      "  EXISTS(SELECT 1 FROM post_likes WHERE post_id = k.post_id AND user_id = ?2), "
+      "  EXISTS(SELECT 1 FROM post_favorites WHERE post_id = k.post_id AND user_id = ?2), "
+      "  s.view_count "
+      "FROM (SELECT ?1 AS post_id) k "
+      "LEFT JOIN post_stats s ON s.post_id = k.post_id;";
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
     return false;
   }
 
-  const int64_t uid = currentUserId.value_or(0);
   sqlite3_bind_int64(stmt, 1, postId);
-  sqlite3_bind_int64(stmt, 2, postId);
-  sqlite3_bind_int64(stmt, 3, postId);
-  sqlite3_bind_int64(stmt, 4, postId);
-  sqlite3_bind_int64(stmt, 5, uid);
-  sqlite3_bind_int64(stmt, 6, postId);
-  sqlite3_bind_int64(stmt, 7, uid);
+  sqlite3_bind_int64(stmt, 2, currentUserId.value_or(0));
 
-  if (sqlite3_step(stmt) == SQLITE_ROW) {
-    summary.likeCount = sqlite3_column_int(stmt, 0);
-    summary.favoriteCount = sqlite3_column_int(stmt, 1);
-    summary.commentCount = sqlite3_column_int(stmt, 2);
-    summary.likedByMe = currentUserId.has_value() && sqlite3_column_int(stmt, 3) > 0;
-    summary.favoritedByMe = currentUserId.has_value() && sqlite3_column_int(stmt, 4) > 0;
-  } else {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+  if (sqlite3_step(stmt) != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
 
-  sqlite3_finalize(stmt);
-  sqlite3_close(db);
+  summary.likeCount = sqlite3_column_int(stmt, 0);
+  summary.favoriteCount = sqlite3_column_int(stmt, 1);
+  summary.commentCount = sqlite3_column_int(stmt, 2);
+  summary.likedByMe = currentUserId.has_value() && sqlite3_column_int(stmt, 3) > 0;
+  summary.favoritedByMe = currentUserId.has_value() && sqlite3_column_int(stmt, 4) > 0;
+  summary.viewCount = sqlite3_column_int64(stmt, 5);
   return true;
 }
 
-bool InteractionRepository::setLike(int64_t postId,
-                                    int64_t userId,
-                                    bool liked,
-                                    std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+bool InteractionRepository::getPostInteractionSummaries(
+    const std::vector<int64_t>& postIds,
+    const std::optional<int64_t>& currentUserId,
+    std::unordered_map<int64_t, PostInteractionSummary>& summaries,
+    std::string& errorMessage) const {
+  summaries.clear();
+  if (postIds.empty()) {
+    return true;
+  }
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const char* insertSql =
-      "INSERT OR IGNORE INTO post_likes(post_id, user_id, created_at) "
-      "VALUES(?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'));";
-  const char* deleteSql = "DELETE FROM post_likes WHERE post_id = ? AND user_id = ?;";
+  // The id list is bound as one JSON array so the statement text, and its
+  // cached plan, does not depend on the page size.
+  const char* sql =
+      "SELECT k.value, s.like_count, s.favorite_count, s.comment_count, "
+      "  EXISTS(SELECT 1 FROM post_likes WHERE post_id = k.value AND user_id = ?2), "
+      "  EXISTS(SELECT 1 FROM post_favorites WHERE post_id = k.value AND user_id = ?2), "
+      "  s.view_count "
+      "FROM json_each(?1) k "
+      "LEFT JOIN post_stats s ON s.post_id = k.value;";
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
 
-  const bool ok = execLikeMutation(db, insertSql, deleteSql, postId, userId, liked, errorMessage);
-  sqlite3_close(db);
-  return ok;
+  std::string idArray = "[";
+  for (size_t i = 0; i < postIds.size(); ++i) {
+    if (i > 0) {
+      idArray += ',';
+    }
+    idArray += std::to_string(postIds[i]);
+  }
+  idArray += ']';
+
+  sqlite3_bind_text(stmt, 1, idArray.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, currentUserId.value_or(0));
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    PostInteractionSummary summary;
+    summary.likeCount = sqlite3_column_int(stmt, 1);
+    summary.favoriteCount = sqlite3_column_int(stmt, 2);
+    summary.commentCount = sqlite3_column_int(stmt, 3);
+    summary.likedByMe = currentUserId.has_value() && sqlite3_column_int(stmt, 4) > 0;
+    summary.favoritedByMe = currentUserId.has_value() && sqlite3_column_int(stmt, 5) > 0;
+    summary.viewCount = sqlite3_column_int64(stmt, 6);
+    summaries[sqlite3_column_int64(stmt, 0)] = summary;
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+bool InteractionRepository::addPostViews(const std::vector<std::pair<int64_t, int64_t>>& views,
+                                         std::string& errorMessage) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  const char* sql =
+      "INSERT INTO post_stats(post_id, view_count) VALUES(?, ?) "
+      "ON CONFLICT(post_id) DO UPDATE SET view_count = view_count + excluded.view_count;";
+
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+
+  std::vector<InteractionEvent> events;
+  events.reserve(views.size());
+  for (const auto& [postId, count] : views) {
+    events.push_back(InteractionEvent{InteractionEventKind::View, postId, count});
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, 1, postId);
+    sqlite3_bind_int64(stmt, 2, count);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+      errorMessage = sqlite3_errmsg(conn.get());
+      rollback(conn);
+      return false;
+    }
+  }
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+  emit(events);
+  return true;
+}
+
+bool InteractionRepository::listInteractedPostIds(int64_t userId,
+                                                  std::vector<int64_t>& likedPostIds,
+                                                  std::vector<int64_t>& favoritedPostIds,
+                                                  std::string& errorMessage) const {
+  likedPostIds.clear();
+  favoritedPostIds.clear();
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  const char* sql =
+      "SELECT 0, post_id FROM post_likes WHERE user_id = ?1 "
+      "UNION ALL "
+      "SELECT 1, post_id FROM post_favorites WHERE user_id = ?1;";
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  sqlite3_bind_int64(stmt, 1, userId);
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    auto& ids = sqlite3_column_int(stmt, 0) == 0 ? likedPostIds : favoritedPostIds;
+    ids.push_back(sqlite3_column_int64(stmt, 1));
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+bool InteractionRepository::setLike(int64_t postId,
+                                    int64_t userId,
+                                    bool liked,
+                                    std::string& errorMessage) const {
+  return applyToggles({InteractionToggle{InteractionKind::Like, postId, userId, liked}}, errorMessage);
 }
 
 bool InteractionRepository::setFavorite(int64_t postId,
                                         int64_t userId,
                                         bool favorited,
                                         std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+  return applyToggles({InteractionToggle{InteractionKind::Favorite, postId, userId, favorited}}, errorMessage);
+}
+
+bool InteractionRepository::applyToggles(const std::vector<InteractionToggle>& toggles,
+                                         std::string& errorMessage,
+                                         const std::function<void()>& beforeCommit) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const char* insertSql =
-      "INSERT OR IGNORE INTO post_favorites(post_id, user_id, created_at) "
-      "VALUES(?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'));";
-  const char* deleteSql = "DELETE FROM post_favorites WHERE post_id = ? AND user_id = ?;";
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
 
-  const bool ok = execLikeMutation(db, insertSql, deleteSql, postId, userId, favorited, errorMessage);
-  sqlite3_close(db);
-  return ok;
+  std::vector<InteractionEvent> events;
+  for (const auto& toggle : toggles) {
+    if (!applyToggle(conn, toggle, events, errorMessage)) {
+      rollback(conn);
+      return false;
+    }
+  }
+
+  if (beforeCommit) {
+    beforeCommit();
+  }
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+  emit(events);
+  return true;
 }
 
 bool InteractionRepository::listFavoritePostsByUser(int64_t userId,
@@ -264,10 +528,7 @@ bool InteractionRepository::listComments(int64_t postId,
     return false;
   }
 
-  const char* countSql =
-      "SELECT COUNT(1) "
-      "FROM comments "
-      "WHERE post_id = ? AND is_deleted = 0;";
+  const char* countSql = "SELECT COALESCE((SELECT comment_count FROM post_stats WHERE post_id = ?), 0);";
 
   sqlite3_stmt* countStmt = nullptr;
   if (sqlite3_prepare_v2(db, countSql, -1, &countStmt, nullptr) != SQLITE_OK) {
@@ -283,11 +544,12 @@ bool InteractionRepository::listComments(int64_t postId,
   sqlite3_finalize(countStmt);
 
   const char* sql =
-      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted "
+      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted, "
+      "c.parent_id, c.depth, c.path, c.reply_count "
       "FROM comments c "
       "JOIN users u ON u.id = c.user_id "
       "WHERE c.post_id = ? AND c.is_deleted = 0 "
-      "ORDER BY c.created_at DESC "
+      "ORDER BY c.created_at DESC, c.id DESC "
       "LIMIT ? OFFSET ?;";
 
   sqlite3_stmt* stmt = nullptr;
@@ -310,65 +572,263 @@ bool InteractionRepository::listComments(int64_t postId,
   return true;
 }
 
+bool InteractionRepository::listCommentsPage(int64_t postId,
+                                             const std::optional<CommentCursor>& after,
+                                             int limit,
+                                             std::vector<Comment>& comments,
+                                             std::string& errorMessage) const {
+  comments.clear();
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  // Two statements rather than "?2 IS NULL OR ..." so both keep a plain
+  // range scan on idx_comments_post_keyset.
+  const char* firstSql =
+      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted, "
+      "c.parent_id, c.depth, c.path, c.reply_count "
+      "FROM comments c "
+      "JOIN users u ON u.id = c.user_id "
+      "WHERE c.post_id = ?1 AND c.is_deleted = 0 "
+      "ORDER BY c.created_at DESC, c.id DESC "
+      "LIMIT ?4;";
+  const char* afterSql =
+      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted, "
+      "c.parent_id, c.depth, c.path, c.reply_count "
+      "FROM comments c "
+      "JOIN users u ON u.id = c.user_id "
+      "WHERE c.post_id = ?1 AND c.is_deleted = 0 AND (c.created_at, c.id) < (?2, ?3) "
+      "ORDER BY c.created_at DESC, c.id DESC "
+      "LIMIT ?4;";
+
+  sqlite3_stmt* stmt = conn.prepare(after.has_value() ? afterSql : firstSql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  sqlite3_bind_int64(stmt, 1, postId);
+  if (after.has_value()) {
+    sqlite3_bind_text(stmt, 2, after->createdAt.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, after->id);
+  }
+  sqlite3_bind_int(stmt, 4, limit);
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    comments.push_back(rowToComment(stmt));
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+bool InteractionRepository::listCommentTree(int64_t postId,
+                                            const std::string& rootPath,
+                                            const std::string& afterPath,
+                                            int limit,
+                                            std::vector<Comment>& comments,
+                                            std::string& errorMessage) const {
+  comments.clear();
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  // Deleted comments that still have live replies are kept as placeholders so
+  // the replies stay attached to the thread.
+  const char* sql =
+      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted, "
+      "c.parent_id, c.depth, c.path, c.reply_count "
+      "FROM comments c "
+      "JOIN users u ON u.id = c.user_id "
+      "WHERE c.post_id = ?1 AND c.path > ?2 AND c.path < ?3 AND (c.is_deleted = 0 OR c.reply_count > 0) "
+      "ORDER BY c.path "
+      "LIMIT ?4;";
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  const std::string lower = std::max(rootPath, afterPath);
+  const std::string upper = rootPath + "~";
+  sqlite3_bind_int64(stmt, 1, postId);
+  sqlite3_bind_text(stmt, 2, lower.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_text(stmt, 3, upper.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int(stmt, 4, limit);
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    comments.push_back(rowToComment(stmt));
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+bool InteractionRepository::countComments(int64_t postId, int& total, std::string& errorMessage) const {
+  total = 0;
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  sqlite3_stmt* stmt =
+      conn.prepare("SELECT COALESCE((SELECT comment_count FROM post_stats WHERE post_id = ?), 0);", errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int64(stmt, 1, postId);
+  if (sqlite3_step(stmt) != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  total = sqlite3_column_int(stmt, 0);
+  return true;
+}
+
 bool InteractionRepository::createComment(int64_t postId,
                                           int64_t userId,
                                           const std::string& content,
+                                          const std::optional<int64_t>& parentId,
                                           Comment& out,
+                                          std::string& errorCode,
                                           std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+  errorCode = "DB_ERROR";
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+
+  std::string parentPath;
+  int depth = 0;
+  if (parentId.has_value()) {
+    sqlite3_stmt* parentStmt = conn.prepare(
+        "SELECT path, depth FROM comments WHERE id = ? AND post_id = ? AND is_deleted = 0;", errorMessage);
+    if (parentStmt == nullptr) {
+      rollback(conn);
+      return false;
+    }
+    sqlite3_bind_int64(parentStmt, 1, *parentId);
+    sqlite3_bind_int64(parentStmt, 2, postId);
+    const int rc = sqlite3_step(parentStmt);
+    if (rc != SQLITE_ROW) {
+      if (rc == SQLITE_DONE) {
+        errorCode = "COMMENT_NOT_FOUND";
+        errorMessage = "parent comment not found";
+      } else {
+        errorMessage = sqlite3_errmsg(conn.get());
+      }
+      sqlite3_reset(parentStmt);
+      rollback(conn);
+      return false;
+    }
+    parentPath = textOrEmpty(parentStmt, 0);
+    depth = sqlite3_column_int(parentStmt, 1) + 1;
+    sqlite3_reset(parentStmt);
+    if (depth > kMaxCommentDepth) {
+      errorCode = "VALIDATION_ERROR";
+      errorMessage = "reply depth limit reached";
+      rollback(conn);
+      return false;
+    }
+  }
+
   const char* insertSql =
-      "INSERT INTO comments(post_id, user_id, content, created_at, updated_at, is_deleted) "
-      "VALUES(?, ?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'), strftime('%Y-%m-%dT%H:%M:%SZ','now'), 0);";
+      "INSERT INTO comments(post_id, user_id, content, created_at, updated_at, is_deleted, parent_id, depth) "
+      "VALUES(?, ?, ?, strftime('%Y-%m-%dT%H:%M:%SZ','now'), strftime('%Y-%m-%dT%H:%M:%SZ','now'), 0, ?, ?);";
 
-  sqlite3_stmt* insertStmt = nullptr;
-  if (sqlite3_prepare_v2(db, insertSql, -1, &insertStmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* insertStmt = conn.prepare(insertSql, errorMessage);
+  if (insertStmt == nullptr) {
+    rollback(conn);
     return false;
   }
   sqlite3_bind_int64(insertStmt, 1, postId);
   sqlite3_bind_int64(insertStmt, 2, userId);
   sqlite3_bind_text(insertStmt, 3, content.c_str(), -1, SQLITE_TRANSIENT);
+  if (parentId.has_value()) {
+    sqlite3_bind_int64(insertStmt, 4, *parentId);
+  } else {
+    sqlite3_bind_null(insertStmt, 4);
+  }
+  sqlite3_bind_int(insertStmt, 5, depth);
 
   if (sqlite3_step(insertStmt) != SQLITE_DONE) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(insertStmt);
-    sqlite3_close(db);
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+
+  const int64_t newId = sqlite3_last_insert_rowid(conn.get());
+
+  // The path ends with the row's own id, so it is set once the id exists.
+  const std::string path = parentPath + pathSegment(newId);
+  sqlite3_stmt* pathStmt = conn.prepare("UPDATE comments SET path = ? WHERE id = ?;", errorMessage);
+  if (pathStmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+  sqlite3_bind_text(pathStmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(pathStmt, 2, newId);
+  if (sqlite3_step(pathStmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+
+  if (!bumpReplyCounts(conn, parentPath, 1, errorMessage)) {
+    rollback(conn);
+    return false;
+  }
+
+  StatsDelta delta;
+  delta.comments = 1;
+  std::vector<InteractionEvent> events;
+  if (!bumpStats(conn, postId, delta, events, errorMessage)) {
+    rollback(conn);
     return false;
   }
-  sqlite3_finalize(insertStmt);
 
-  const int64_t newId = sqlite3_last_insert_rowid(db);
   const char* querySql =
-      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted "
+      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted, "
+      "c.parent_id, c.depth, c.path, c.reply_count "
       "FROM comments c "
       "JOIN users u ON u.id = c.user_id "
       "WHERE c.id = ? LIMIT 1;";
 
-  sqlite3_stmt* queryStmt = nullptr;
-  if (sqlite3_prepare_v2(db, querySql, -1, &queryStmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* queryStmt = conn.prepare(querySql, errorMessage);
+  if (queryStmt == nullptr) {
+    rollback(conn);
     return false;
   }
   sqlite3_bind_int64(queryStmt, 1, newId);
-  if (sqlite3_step(queryStmt) == SQLITE_ROW) {
-    out = rowToComment(queryStmt);
-  } else {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(queryStmt);
-    sqlite3_close(db);
+  if (sqlite3_step(queryStmt) != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
     return false;
   }
+  out = rowToComment(queryStmt);
+  sqlite3_reset(queryStmt);
 
-  sqlite3_finalize(queryStmt);
-  sqlite3_close(db);
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+  emit(events);
   return true;
 }
 
@@ -380,7 +840,8 @@ std::optional<Comment> InteractionRepository::findCommentById(int64_t commentId,
   }
 
   const char* sql =
-      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted "
+      "SELECT c.id, c.post_id, c.user_id, u.username, c.content, c.created_at, c.updated_at, c.is_deleted, "
+      "c.parent_id, c.depth, c.path, c.reply_count "
       "FROM comments c "
       "JOIN users u ON u.id = c.user_id "
       "WHERE c.id = ? AND (? = 1 OR c.is_deleted = 0) "
@@ -404,40 +865,68 @@ std::optional<Comment> InteractionRepository::findCommentById(int64_t commentId,
   return result;
 }
 
-bool InteractionRepository::softDeleteComment(int64_t commentId, std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+bool InteractionRepository::softDeleteComment(int64_t commentId,
+                                              std::string& errorCode,
+                                              std::string& errorMessage) const {
+  errorCode = "DB_ERROR";
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
 
   const char* sql =
       "UPDATE comments SET is_deleted = 1, updated_at = strftime('%Y-%m-%dT%H:%M:%SZ','now') "
-      "WHERE id = ? AND is_deleted = 0;";
+      "WHERE id = ? AND is_deleted = 0 RETURNING post_id, path;";
 
-  sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    rollback(conn);
     return false;
   }
   sqlite3_bind_int64(stmt, 1, commentId);
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+  const int rc = sqlite3_step(stmt);
+  if (rc == SQLITE_DONE) {
+    rollback(conn);
+    errorCode = "COMMENT_NOT_FOUND";
+    errorMessage = "comment not found";
+    return false;
+  }
+  if (rc != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+  const int64_t postId = sqlite3_column_int64(stmt, 0);
+  const std::string path = textOrEmpty(stmt, 1);
+  sqlite3_reset(stmt);
+
+  // Replies below stay live; only the ancestors lose a descendant.
+  const std::string ancestorPath = path.size() >= kPathSegmentLength ? path.substr(0, path.size() - kPathSegmentLength) : "";
+  if (!bumpReplyCounts(conn, ancestorPath, -1, errorMessage)) {
+    rollback(conn);
     return false;
   }
-  const int changed = sqlite3_changes(db);
-  sqlite3_finalize(stmt);
-  sqlite3_close(db);
 
-  if (changed == 0) {
-    errorMessage = "comment not found";
+  StatsDelta delta;
+  delta.comments = -1;
+  std::vector<InteractionEvent> events;
+  if (!bumpStats(conn, postId, delta, events, errorMessage)) {
+    rollback(conn);
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
     return false;
   }
+  emit(events);
   return true;
 }
 
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <functional>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "db/Database.h"
@@ -13,15 +16,39 @@ namespace blog {
 
 class InteractionRepository {
  public:
-  explicit InteractionRepository(const Database& db);
+  using EventListener = std::function<void(const InteractionEvent&)>;
+
+  // `onEvent` sees every committed counter change, on the writing thread.
+  explicit InteractionRepository(const Database& db, EventListener onEvent = nullptr);
 
   bool getPostInteractionSummary(int64_t postId,
                                  const std::optional<int64_t>& currentUserId,
                                  PostInteractionSummary& summary,
                                  std::string& errorMessage) const;
+  // Summaries for a page of posts in one query; ids without stats rows map to
+  // zero counts.
+  bool getPostInteractionSummaries(const std::vector<int64_t>& postIds,
+                                   const std::optional<int64_t>& currentUserId,
+                                   std::unordered_map<int64_t, PostInteractionSummary>& summaries,
+                                   std::string& errorMessage) const;
+
+  // Adds (post id, views) pairs to post_stats.view_count in one transaction.
+  bool addPostViews(const std::vector<std::pair<int64_t, int64_t>>& views, std::string& errorMessage) const;
+  // Every post the user has liked and favorited, unordered.
+  bool listInteractedPostIds(int64_t userId,
+                             std::vector<int64_t>& likedPostIds,
+                             std::vector<int64_t>& favoritedPostIds,
+                             std::string& errorMessage) const;
 
   bool setLike(int64_t postId, int64_t userId, bool liked, std::string& errorMessage) const;
   bool setFavorite(int64_t postId, int64_t userId, bool favorited, std::string& errorMessage) const;
+  // Applies a batch of like/favorite toggles and their post_stats deltas in
+  // one write transaction; all or nothing. `beforeCommit` runs once every
+  // toggle is written and just before COMMIT, so a caller can exclude
+  // readers for the commit alone rather than the whole transaction.
+  bool applyToggles(const std::vector<InteractionToggle>& toggles,
+                    std::string& errorMessage,
+                    const std::function<void()>& beforeCommit = nullptr) const;
   bool listFavoritePostsByUser(int64_t userId,
                                int page,
                                int pageSize,
@@ -38,18 +65,49 @@ class InteractionRepository {
                     int& total,
                     std::string& errorMessage) const;
 
+  // Keyset page in (created_at DESC, id DESC) order, starting after `after`
+  // or at the newest comment.
+  bool listCommentsPage(int64_t postId,
+                        const std::optional<CommentCursor>& after,
+                        int limit,
+                        std::vector<Comment>& comments,
+                        std::string& errorMessage) const;
+
+  // One range scan over idx_comments_post_path in thread order (depth-first,
+  // siblings oldest first). An empty `rootPath` covers the whole post,
+  // otherwise only that comment's descendants; `afterPath` is the path of the
+  // last comment of the previous page, or empty.
+  bool listCommentTree(int64_t postId,
+                       const std::string& rootPath,
+                       const std::string& afterPath,
+                       int limit,
+                       std::vector<Comment>& comments,
+                       std::string& errorMessage) const;
+
+  // Live (not deleted) comments, from the denormalized post_stats counter.
+  bool countComments(int64_t postId, int& total, std::string& errorMessage) const;
+
+  // Fails with COMMENT_NOT_FOUND unless `parentId` is a live comment on the
+  // same post, and with VALIDATION_ERROR past 32 levels; DB_ERROR otherwise.
   bool createComment(int64_t postId,
                      int64_t userId,
                      const std::string& content,
+                     const std::optional<int64_t>& parentId,
                      Comment& out,
+                     std::string& errorCode,
                      std::string& errorMessage) const;
 
   std::optional<Comment> findCommentById(int64_t commentId, bool includeDeleted = false) const;
 
-  bool softDeleteComment(int64_t commentId, std::string& errorMessage) const;
+  // Fails with COMMENT_NOT_FOUND when the comment is missing or already
+  // deleted; DB_ERROR otherwise.
+  bool softDeleteComment(int64_t commentId, std::string& errorCode, std::string& errorMessage) const;
 
  private:
+  void emit(const std::vector<InteractionEvent>& events) const;
+
   const Database& db_;
+  EventListener onEvent_;
 };
 
 }  // namespace blog
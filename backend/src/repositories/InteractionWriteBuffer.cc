@@ -0,0 +1,388 @@
+#include "repositories/InteractionWriteBuffer.h"
+
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace blog {
+namespace {
+
+// New keys are refused once this many times maxPending entries are waiting,
+// which only happens while flushes keep failing.
+constexpr size_t kBacklogFactor = 8;
+// A toggle that fails this many flushes on its own is dropped.
+constexpr int kMaxFlushAttempts = 8;
+// Failed flushes wait the flush interval doubled per consecutive failure, up
+// to 2^kMaxBackoffShift intervals.
+constexpr int kMaxBackoffShift = 6;
+
+}  // namespace
+
+size_t InteractionWriteBuffer::KeyHash::operator()(const Key& key) const {
+  const size_t h1 = std::hash<int64_t>{}(key.postId);
+  const size_t h2 = std::hash<int64_t>{}(key.userId);
+  return (h1 * 31 + h2) * 2 + (key.kind == InteractionKind::Like ? 0 : 1);
+}
+
+InteractionWriteBuffer::InteractionWriteBuffer(const InteractionRepository& interactionRepository,
+                                               const PostViewCounter& postViewCounter,
+                                               const AppConfig& config)
+    : interactionRepository_(interactionRepository),
+      postViewCounter_(postViewCounter),
+      writeBehind_(config.interactionWriteMode == "write_behind"),
+      flushIntervalMs_(std::max(10, config.interactionFlushIntervalMs)),
+      maxPending_(static_cast<size_t>(std::max(1, config.interactionFlushMaxPending))),
+      membership_(static_cast<size_t>(std::max(0, config.interactionMembershipCacheUsers)),
+                  [this](int64_t userId,
+                         std::vector<int64_t>& likedPostIds,
+                         std::vector<int64_t>& favoritedPostIds,
+                         std::string& errorMessage) {
+                    return loadMembership(userId, likedPostIds, favoritedPostIds, errorMessage);
+                  }) {}
+
+InteractionWriteBuffer::~InteractionWriteBuffer() {
+  stop();
+}
+
+void InteractionWriteBuffer::start() {
+  if (!writeBehind_ || flusher_.joinable()) {
+    return;
+  }
+  flusher_ = std::thread([this]() { runFlusher(); });
+}
+
+void InteractionWriteBuffer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  if (flusher_.joinable()) {
+    flusher_.join();
+  }
+
+  std::string errorMessage;
+  if (!flush(errorMessage)) {
+    LOG_ERROR << "final interaction flush failed, pending toggles lost: " << errorMessage;
+  }
+}
+
+bool InteractionWriteBuffer::writeBehind() const {
+  return writeBehind_;
+}
+
+int InteractionWriteBuffer::flushIntervalMs() const {
+  return flushIntervalMs_;
+}
+
+size_t InteractionWriteBuffer::pendingCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.size();
+}
+
+void InteractionWriteBuffer::adjustDelta(const Key& key, int change) {
+  if (change == 0) {
+    return;
+  }
+  auto& delta = postDeltas_[key.postId];
+  if (key.kind == InteractionKind::Like) {
+    delta.likes += change;
+  } else {
+    delta.favorites += change;
+  }
+  if (delta.likes == 0 && delta.favorites == 0) {
+    postDeltas_.erase(key.postId);
+  }
+}
+
+void InteractionWriteBuffer::updateEntry(const Key& key, Entry& entry, bool desired) {
+  // An entry contributes (desired - persisted) to the post's visible counts.
+  adjustDelta(key, static_cast<int>(desired) - static_cast<int>(entry.desired));
+  entry.desired = desired;
+}
+
+bool InteractionWriteBuffer::setToggle(const InteractionToggle& toggle, std::string& errorMessage) {
+  if (!writeBehind_) {
+    if (!interactionRepository_.applyToggles({toggle}, errorMessage)) {
+      return false;
+    }
+    membership_.apply(toggle);
+    return true;
+  }
+
+  const Key key{toggle.kind, toggle.postId, toggle.userId};
+  bool known = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = pending_.find(key);
+    if (it != pending_.end()) {
+      known = true;
+      updateEntry(key, it->second, toggle.enabled);
+      if (!it->second.inFlight && it->second.desired == it->second.persisted) {
+        pending_.erase(it);
+      }
+    }
+  }
+  if (known) {
+    membership_.apply(toggle);
+    return true;
+  }
+
+  // First toggle for this key: learn the stored state with a read, so counts
+  // can be overlaid without touching the writer.
+  PostInteractionSummary stored;
+  if (!interactionRepository_.getPostInteractionSummary(toggle.postId, toggle.userId, stored, errorMessage)) {
+    return false;
+  }
+  const bool persisted = toggle.kind == InteractionKind::Like ? stored.likedByMe : stored.favoritedByMe;
+
+  bool full = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() >= maxPending_ * kBacklogFactor && pending_.find(key) == pending_.end()) {
+      errorMessage = "interaction write buffer is full";
+      return false;
+    }
+    Entry fresh;
+    fresh.desired = persisted;
+    fresh.persisted = persisted;
+    auto& entry = pending_.try_emplace(key, fresh).first->second;
+    updateEntry(key, entry, toggle.enabled);
+    if (!entry.inFlight && entry.desired == entry.persisted) {
+      pending_.erase(key);
+    }
+    full = pending_.size() >= maxPending_;
+  }
+  membership_.apply(toggle);
+  if (full) {
+    wake_.notify_one();
+  }
+  return true;
+}
+
+bool InteractionWriteBuffer::getSummary(int64_t postId,
+                                        const std::optional<int64_t>& currentUserId,
+                                        PostInteractionSummary& summary,
+                                        std::string& errorMessage) const {
+  std::unordered_map<int64_t, PostInteractionSummary> summaries;
+  if (!getSummaries({postId}, currentUserId, summaries, errorMessage)) {
+    return false;
+  }
+  summary = summaries[postId];
+  return true;
+}
+
+bool InteractionWriteBuffer::getSummaries(const std::vector<int64_t>& postIds,
+                                          const std::optional<int64_t>& currentUserId,
+                                          std::unordered_map<int64_t, PostInteractionSummary>& summaries,
+                                          std::string& errorMessage) const {
+  std::shared_lock<std::shared_mutex> commitLock(commitMutex_, std::defer_lock);
+  if (writeBehind_) {
+    commitLock.lock();
+  }
+
+  // With the membership cache the query only fetches counts; likedByMe and
+  // favoritedByMe come from the user's in-memory sets.
+  const bool useMembership = currentUserId.has_value() && membership_.enabled();
+  const std::optional<int64_t> probeUserId = useMembership ? std::nullopt : currentUserId;
+  if (!interactionRepository_.getPostInteractionSummaries(postIds, probeUserId, summaries, errorMessage)) {
+    return false;
+  }
+  if (useMembership && !membership_.fill(*currentUserId, summaries, errorMessage)) {
+    return false;
+  }
+  for (auto& [postId, summary] : summaries) {
+    summary.viewCount += postViewCounter_.pending(postId);
+  }
+  if (!writeBehind_) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& [postId, summary] : summaries) {
+    overlay(postId, currentUserId, summary);
+  }
+  return true;
+}
+
+bool InteractionWriteBuffer::loadMembership(int64_t userId,
+                                            std::vector<int64_t>& likedPostIds,
+                                            std::vector<int64_t>& favoritedPostIds,
+                                            std::string& errorMessage) const {
+  // Called from getSummaries, which already holds commitMutex_ in
+  // write_behind mode, so no batch commits between this read and the
+  // pending overlay below.
+  if (!interactionRepository_.listInteractedPostIds(userId, likedPostIds, favoritedPostIds, errorMessage)) {
+    return false;
+  }
+  if (!writeBehind_) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& [key, entry] : pending_) {
+    if (key.userId != userId || entry.desired == entry.persisted) {
+      continue;
+    }
+    auto& ids = key.kind == InteractionKind::Like ? likedPostIds : favoritedPostIds;
+    if (entry.desired) {
+      ids.push_back(key.postId);
+    } else {
+      ids.erase(std::remove(ids.begin(), ids.end(), key.postId), ids.end());
+    }
+  }
+  return true;
+}
+
+void InteractionWriteBuffer::overlay(int64_t postId,
+                                     const std::optional<int64_t>& currentUserId,
+                                     PostInteractionSummary& summary) const {
+  const auto delta = postDeltas_.find(postId);
+  if (delta != postDeltas_.end()) {
+    summary.likeCount += delta->second.likes;
+    summary.favoriteCount += delta->second.favorites;
+  }
+  if (currentUserId.has_value()) {
+    const auto like = pending_.find(Key{InteractionKind::Like, postId, *currentUserId});
+    if (like != pending_.end()) {
+      summary.likedByMe = like->second.desired;
+    }
+    const auto favorite = pending_.find(Key{InteractionKind::Favorite, postId, *currentUserId});
+    if (favorite != pending_.end()) {
+      summary.favoritedByMe = favorite->second.desired;
+    }
+  }
+}
+
+bool InteractionWriteBuffer::flush(std::string& errorMessage) {
+  std::lock_guard<std::mutex> flushLock(flushMutex_);
+
+  std::vector<InteractionToggle> batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batch.reserve(pending_.size());
+    for (auto& [key, entry] : pending_) {
+      entry.inFlight = true;
+      batch.push_back(InteractionToggle{key.kind, key.postId, key.userId, entry.desired});
+    }
+  }
+  if (batch.empty()) {
+    return true;
+  }
+  if (commit(batch, errorMessage)) {
+    return true;
+  }
+  if (batch.size() == 1) {
+    settleFailed(batch, errorMessage);
+    return false;
+  }
+
+  // The batch is all or nothing, so one toggle SQLite refuses (its post was
+  // purged, say) would fail every retry. Apply them one by one instead, so
+  // the rest land and only the offender counts a failure.
+  LOG_WARN << "interaction batch of " << batch.size() << " failed, applying toggles one by one: " << errorMessage;
+  bool ok = true;
+  for (const auto& toggle : batch) {
+    std::string toggleError;
+    if (!commit({toggle}, toggleError)) {
+      settleFailed({toggle}, toggleError);
+      errorMessage = toggleError;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+bool InteractionWriteBuffer::commit(const std::vector<InteractionToggle>& toggles, std::string& errorMessage) {
+  // The transaction is written without blocking readers; commitMutex_ is
+  // only taken for the COMMIT itself and the rebase below.
+  std::unique_lock<std::shared_mutex> commitLock(commitMutex_, std::defer_lock);
+  if (!interactionRepository_.applyToggles(toggles, errorMessage, [&commitLock]() { commitLock.lock(); })) {
+    return false;
+  }
+
+  // Entries stay in the map while in flight so reads keep overlaying them.
+  // The flushed value becomes the persisted baseline; entries not toggled
+  // again meanwhile are then no-ops and can go.
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& toggle : toggles) {
+    const Key key{toggle.kind, toggle.postId, toggle.userId};
+    const auto it = pending_.find(key);
+    if (it == pending_.end()) {
+      continue;
+    }
+    it->second.inFlight = false;
+    it->second.failures = 0;
+    adjustDelta(key, static_cast<int>(it->second.persisted) - static_cast<int>(toggle.enabled));
+    it->second.persisted = toggle.enabled;
+    if (it->second.desired == it->second.persisted) {
+      pending_.erase(it);
+    }
+  }
+  return true;
+}
+
+void InteractionWriteBuffer::settleFailed(const std::vector<InteractionToggle>& toggles,
+                                          const std::string& errorMessage) {
+  std::vector<InteractionToggle> reverted;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& toggle : toggles) {
+      const Key key{toggle.kind, toggle.postId, toggle.userId};
+      const auto it = pending_.find(key);
+      if (it == pending_.end()) {
+        continue;
+      }
+      Entry& entry = it->second;
+      entry.inFlight = false;
+      if (++entry.failures >= kMaxFlushAttempts) {
+        LOG_ERROR << "dropping interaction toggle for post " << key.postId << " user " << key.userId << " after "
+                  << entry.failures << " failed flushes: " << errorMessage;
+        updateEntry(key, entry, entry.persisted);
+        reverted.push_back(InteractionToggle{key.kind, key.postId, key.userId, entry.persisted});
+      }
+      if (entry.desired == entry.persisted) {
+        pending_.erase(it);
+      }
+    }
+  }
+  for (const auto& toggle : reverted) {
+    membership_.apply(toggle);
+  }
+}
+
+void InteractionWriteBuffer::runFlusher() {
+  int failures = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    if (failures == 0) {
+      wake_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_), [this]() {
+        return stopping_ || pending_.size() >= maxPending_;
+      });
+    } else {
+      // After a failure a full buffer must not wake the flusher, or it would
+      // go straight back into another failing transaction.
+      const auto backoff = std::chrono::milliseconds(flushIntervalMs_) * (1 << std::min(failures - 1, kMaxBackoffShift));
+      wake_.wait_for(lock, backoff, [this]() { return stopping_; });
+    }
+    if (stopping_) {
+      break;
+    }
+
+    lock.unlock();
+    std::string errorMessage;
+    if (flush(errorMessage)) {
+      failures = 0;
+    } else {
+      ++failures;
+      LOG_WARN << "interaction flush failed " << failures << " time(s) in a row, backing off: " << errorMessage;
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace blog
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "app/AppConfig.h"
+#include "models/Interaction.h"
+#include "repositories/InteractionMembershipCache.h"
+#include "repositories/InteractionRepository.h"
+#include "repositories/PostViewCounter.h"
+
+namespace blog {
+
+// Write-behind buffer for like/favorite toggles. In write_behind mode a toggle
+// only updates an in-memory entry per (kind, post, user); repeated toggles
+// coalesce and entries that end where they started are dropped. A background
+// thread applies the rest in one transaction every flush interval, or sooner
+// once maxPending entries are waiting. Summaries overlay the pending state, so
+// callers see their own writes before they reach SQLite.
+//
+// When a batch fails its toggles are retried one per transaction, so a toggle
+// SQLite keeps refusing cannot hold back the rest; after repeated failures it
+// is dropped and logged. Failed flushes back off exponentially, and once the
+// buffer holds several times maxPending entries new keys are refused.
+//
+// Acknowledged toggles that have not been flushed are lost if the process
+// crashes; stop() flushes them on a clean shutdown. In sync mode every toggle
+// is its own transaction, as before.
+class InteractionWriteBuffer {
+ public:
+  InteractionWriteBuffer(const InteractionRepository& interactionRepository,
+                         const PostViewCounter& postViewCounter,
+                         const AppConfig& config);
+  ~InteractionWriteBuffer();
+
+  InteractionWriteBuffer(const InteractionWriteBuffer&) = delete;
+  InteractionWriteBuffer& operator=(const InteractionWriteBuffer&) = delete;
+
+  void start();
+  void stop();
+
+  bool writeBehind() const;
+  int flushIntervalMs() const;
+  // Toggles waiting for the flusher.
+  size_t pendingCount() const;
+
+  bool setToggle(const InteractionToggle& toggle, std::string& errorMessage);
+  bool getSummary(int64_t postId,
+                  const std::optional<int64_t>& currentUserId,
+                  PostInteractionSummary& summary,
+                  std::string& errorMessage) const;
+  bool getSummaries(const std::vector<int64_t>& postIds,
+                    const std::optional<int64_t>& currentUserId,
+                    std::unordered_map<int64_t, PostInteractionSummary>& summaries,
+                    std::string& errorMessage) const;
+  bool flush(std::string& errorMessage);
+
+ private:
+  struct Key {
+    InteractionKind kind;
+    int64_t postId;
+    int64_t userId;
+
+    bool operator==(const Key& other) const {
+      return kind == other.kind && postId == other.postId && userId == other.userId;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    bool desired = false;
+    bool persisted = false;
+    bool inFlight = false;
+    // Consecutive failed flushes of this entry on its own.
+    int failures = 0;
+  };
+
+  struct PostDelta {
+    int likes = 0;
+    int favorites = 0;
+  };
+
+  void updateEntry(const Key& key, Entry& entry, bool desired);
+  void adjustDelta(const Key& key, int change);
+  bool loadMembership(int64_t userId,
+                      std::vector<int64_t>& likedPostIds,
+                      std::vector<int64_t>& favoritedPostIds,
+                      std::string& errorMessage) const;
+  void overlay(int64_t postId, const std::optional<int64_t>& currentUserId, PostInteractionSummary& summary) const;
+  bool commit(const std::vector<InteractionToggle>& toggles, std::string& errorMessage);
+  void settleFailed(const std::vector<InteractionToggle>& toggles, const std::string& errorMessage);
+  void runFlusher();
+
+  const InteractionRepository& interactionRepository_;
+  const PostViewCounter& postViewCounter_;
+  const bool writeBehind_;
+  const int flushIntervalMs_;
+  const size_t maxPending_;
+
+  mutable std::mutex mutex_;
+  std::unordered_map<Key, Entry, KeyHash> pending_;
+  std::unordered_map<int64_t, PostDelta> postDeltas_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+
+  std::mutex flushMutex_;
+  // Held shared by summary reads and exclusively around a batch's COMMIT and
+  // the rebase of its entries, so a read never sees a batch both in SQLite
+  // and in the overlay.
+  mutable std::shared_mutex commitMutex_;
+  mutable InteractionMembershipCache membership_;
+  std::thread flusher_;
+};
+
+}  // namespace blog
@@ -2,6 +2,8 @@
 
 #include <sqlite3.h>
 
+#include <utility>
+
 namespace blog {
 namespace {
 
@@ -28,7 +30,14 @@ Post rowToPost(sqlite3_stmt* stmt) {
 
 }  // namespace
 
-PostRepository::PostRepository(const Database& db) : db_(db) {}
+PostRepository::PostRepository(const Database& db, EventListener onEvent)
+    : db_(db), onEvent_(std::move(onEvent)) {}
+
+void PostRepository::emit(const PostEvent& event) const {
+  if (onEvent_) {
+    onEvent_(event);
+  }
+}
 
 bool PostRepository::listPosts(int page,
                                int pageSize,
@@ -148,6 +157,53 @@ bool PostRepository::listPostsByAuthor(int64_t authorId,
   return true;
 }
 
+bool PostRepository::listPostsByIds(const std::vector<int64_t>& ids,
+                                    std::vector<Post>& posts,
+                                    std::string& errorMessage) const {
+  posts.clear();
+  if (ids.empty()) {
+    return true;
+  }
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  const char* sql =
+      "SELECT p.id, p.title, p.content_markdown, p.author_id, u.username, p.created_at, p.updated_at, p.is_deleted "
+      "FROM json_each(?) k "
+      "JOIN posts p ON p.id = k.value "
+      "JOIN users u ON u.id = p.author_id "
+      "WHERE p.is_deleted = 0 "
+      "ORDER BY k.key;";
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  std::string idArray = "[";
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (i > 0) {
+      idArray += ',';
+    }
+    idArray += std::to_string(ids[i]);
+  }
+  idArray += ']';
+  sqlite3_bind_text(stmt, 1, idArray.c_str(), -1, SQLITE_TRANSIENT);
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    posts.push_back(rowToPost(stmt));
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
 std::optional<Post> PostRepository::findById(int64_t id, bool includeDeleted) const {
   std::string dbError;
   sqlite3* db = db_.open(dbError);
@@ -156,9 +212,11 @@ std::optional<Post> PostRepository::findById(int64_t id, bool includeDeleted) co
   }
 
   const char* sql =
-      "SELECT p.id, p.title, p.content_markdown, p.author_id, u.username, p.created_at, p.updated_at, p.is_deleted "
+      "SELECT p.id, p.title, p.content_markdown, p.author_id, u.username, p.created_at, p.updated_at, p.is_deleted, "
+      "  COALESCE(s.view_count, 0) "
       "FROM posts p "
       "JOIN users u ON u.id = p.author_id "
+      "LEFT JOIN post_stats s ON s.post_id = p.id "
       "WHERE p.id = ? AND (? = 1 OR p.is_deleted = 0) "
       "LIMIT 1;";
 
@@ -174,6 +232,7 @@ std::optional<Post> PostRepository::findById(int64_t id, bool includeDeleted) co
   std::optional<Post> post;
   if (sqlite3_step(stmt) == SQLITE_ROW) {
     post = rowToPost(stmt);
+    post->viewCount = sqlite3_column_int64(stmt, 8);
   }
 
   sqlite3_finalize(stmt);
@@ -236,6 +295,7 @@ bool PostRepository::createPost(const std::string& title,
 
   sqlite3_finalize(queryStmt);
   sqlite3_close(db);
+  emit(PostEvent{PostEventKind::Created, out});
   return true;
 }
 
@@ -281,6 +341,10 @@ bool PostRepository::updatePost(int64_t id,
     return false;
   }
 
+  Post updated;
+  updated.id = id;
+  updated.title = title;
+  emit(PostEvent{PostEventKind::Updated, updated});
   return true;
 }
 
@@ -321,6 +385,10 @@ bool PostRepository::softDeletePost(int64_t id, std::string& errorMessage) const
     return false;
   }
 
+  Post deleted;
+  deleted.id = id;
+  deleted.isDeleted = true;
+  emit(PostEvent{PostEventKind::Deleted, deleted});
   return true;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <optional>
 #include <string>
 #include <vector>
@@ -11,7 +12,11 @@ namespace blog {
 
 class PostRepository {
  public:
-  explicit PostRepository(const Database& db);
+  using EventListener = std::function<void(const PostEvent&)>;
+
+  // `onEvent` sees every successful create, update and delete, on the
+  // writing thread.
+  explicit PostRepository(const Database& db, EventListener onEvent = nullptr);
 
   bool listPosts(int page,
                  int pageSize,
@@ -26,6 +31,10 @@ class PostRepository {
                          int& total,
                          std::string& errorMessage) const;
 
+  // Active posts among `ids`, in the order given; deleted or missing ids are
+  // skipped.
+  bool listPostsByIds(const std::vector<int64_t>& ids, std::vector<Post>& posts, std::string& errorMessage) const;
+
   std::optional<Post> findById(int64_t id, bool includeDeleted = false) const;
 
   bool createPost(const std::string& title,
@@ -42,7 +51,10 @@ class PostRepository {
   bool softDeletePost(int64_t id, std::string& errorMessage) const;
 
  private:
+  void emit(const PostEvent& event) const;
+
   const Database& db_;
+  EventListener onEvent_;
 };
 
 }  // namespace blog
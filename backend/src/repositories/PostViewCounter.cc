@@ -0,0 +1,84 @@
+#include "repositories/PostViewCounter.h"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace blog {
+
+PostViewCounter::PostViewCounter(const InteractionRepository& interactionRepository)
+    : interactionRepository_(interactionRepository) {}
+
+PostViewCounter::Shard& PostViewCounter::shardFor(int64_t postId) {
+  return shards_[static_cast<uint64_t>(postId) % kShardCount];
+}
+
+const PostViewCounter::Shard& PostViewCounter::shardFor(int64_t postId) const {
+  return shards_[static_cast<uint64_t>(postId) % kShardCount];
+}
+
+void PostViewCounter::record(int64_t postId) {
+  add(postId, 1);
+}
+
+void PostViewCounter::add(int64_t postId, int64_t views) {
+  Shard& shard = shardFor(postId);
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    const auto it = shard.counts.find(postId);
+    if (it != shard.counts.end()) {
+      it->second->fetch_add(views, std::memory_order_relaxed);
+      return;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  auto& slot = shard.counts[postId];
+  if (!slot) {
+    slot = std::make_unique<std::atomic<int64_t>>(0);
+  }
+  slot->fetch_add(views, std::memory_order_relaxed);
+}
+
+int64_t PostViewCounter::pending(int64_t postId) const {
+  const Shard& shard = shardFor(postId);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  const auto it = shard.counts.find(postId);
+  if (it == shard.counts.end()) {
+    return 0;
+  }
+  return it->second->load(std::memory_order_relaxed);
+}
+
+bool PostViewCounter::flush(std::string& errorMessage) {
+  // Each shard is swapped out under its lock, so increments either land in
+  // the batch or in the fresh map. Until the batch commits its views are in
+  // neither pending() nor SQLite; counts dip by at most one batch meanwhile.
+  std::vector<std::pair<int64_t, int64_t>> batch;
+  for (auto& shard : shards_) {
+    std::unordered_map<int64_t, std::unique_ptr<std::atomic<int64_t>>> taken;
+    {
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      taken.swap(shard.counts);
+    }
+    for (const auto& [postId, count] : taken) {
+      const int64_t views = count->load(std::memory_order_relaxed);
+      if (views > 0) {
+        batch.emplace_back(postId, views);
+      }
+    }
+  }
+  if (batch.empty()) {
+    return true;
+  }
+
+  if (!interactionRepository_.addPostViews(batch, errorMessage)) {
+    for (const auto& [postId, views] : batch) {
+      add(postId, views);
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace blog
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "repositories/InteractionRepository.h"
+
+namespace blog {
+
+// Counts post views in memory and adds them to post_stats.view_count in one
+// batched transaction per flush, so a read never waits on a write. Counters
+// are sharded by post id; a view of a post that is already counted only takes
+// a shared lock and an atomic increment.
+//
+// Views not yet flushed are lost if the process crashes; flush() is called on
+// a timer and once more on shutdown.
+class PostViewCounter {
+ public:
+  explicit PostViewCounter(const InteractionRepository& interactionRepository);
+
+  void record(int64_t postId);
+  // Views counted since the last successful flush.
+  int64_t pending(int64_t postId) const;
+  bool flush(std::string& errorMessage);
+
+ private:
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<int64_t, std::unique_ptr<std::atomic<int64_t>>> counts;
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& shardFor(int64_t postId);
+  const Shard& shardFor(int64_t postId) const;
+  void add(int64_t postId, int64_t views);
+
+  const InteractionRepository& interactionRepository_;
+  std::array<Shard, kShardCount> shards_;
+};
+
+}  // namespace blog
@@ -0,0 +1,135 @@
+#include "repositories/TrendingRepository.h"
+
+#include <sqlite3.h>
+
+namespace blog {
+namespace {
+
+void rollback(Database::Connection& conn) {
+  sqlite3_exec(conn.get(), "ROLLBACK;", nullptr, nullptr, nullptr);
+}
+
+}  // namespace
+
+TrendingRepository::TrendingRepository(const Database& db) : db_(db) {}
+
+bool TrendingRepository::loadSnapshot(std::vector<TrendingScore>& scores, std::string& errorMessage) const {
+  scores.clear();
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  sqlite3_stmt* stmt = conn.prepare("SELECT post_id, score, snapshot_at_ms FROM trending_scores;", errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    TrendingScore score;
+    score.postId = sqlite3_column_int64(stmt, 0);
+    score.score = sqlite3_column_double(stmt, 1);
+    score.atMs = sqlite3_column_int64(stmt, 2);
+    scores.push_back(score);
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+bool TrendingRepository::saveSnapshot(const std::vector<TrendingScore>& scores, std::string& errorMessage) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+
+  if (sqlite3_exec(conn.get(), "DELETE FROM trending_scores;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+
+  sqlite3_stmt* stmt = conn.prepare(
+      "INSERT INTO trending_scores(post_id, score, snapshot_at_ms) VALUES(?, ?, ?);", errorMessage);
+  if (stmt == nullptr) {
+    rollback(conn);
+    return false;
+  }
+
+  for (const auto& score : scores) {
+    sqlite3_reset(stmt);
+    sqlite3_bind_int64(stmt, 1, score.postId);
+    sqlite3_bind_double(stmt, 2, score.score);
+    sqlite3_bind_int64(stmt, 3, score.atMs);
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+      errorMessage = sqlite3_errmsg(conn.get());
+      rollback(conn);
+      return false;
+    }
+  }
+
+  if (sqlite3_exec(conn.get(), "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    rollback(conn);
+    return false;
+  }
+  return true;
+}
+
+bool TrendingRepository::listRecentEvents(int64_t windowSeconds,
+                                          std::vector<AgedInteractionEvent>& events,
+                                          std::string& errorMessage) const {
+  events.clear();
+
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
+    return false;
+  }
+
+  // Ages are computed in SQL so created_at never has to be parsed here.
+  const char* sql =
+      "WITH bound(since) AS (SELECT strftime('%Y-%m-%dT%H:%M:%SZ', 'now', '-' || ?1 || ' seconds')) "
+      "SELECT 0, post_id, (julianday('now') - julianday(created_at)) * 86400.0 "
+      "FROM post_likes, bound WHERE created_at >= bound.since "
+      "UNION ALL "
+      "SELECT 1, post_id, (julianday('now') - julianday(created_at)) * 86400.0 "
+      "FROM post_favorites, bound WHERE created_at >= bound.since "
+      "UNION ALL "
+      "SELECT 2, post_id, (julianday('now') - julianday(created_at)) * 86400.0 "
+      "FROM comments, bound WHERE created_at >= bound.since AND is_deleted = 0;";
+
+  sqlite3_stmt* stmt = conn.prepare(sql, errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
+  sqlite3_bind_int64(stmt, 1, windowSeconds);
+
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    AgedInteractionEvent aged;
+    const int kind = sqlite3_column_int(stmt, 0);
+    aged.event.kind = kind == 0 ? InteractionEventKind::Like
+                      : kind == 1 ? InteractionEventKind::Favorite
+                                  : InteractionEventKind::Comment;
+    aged.event.postId = sqlite3_column_int64(stmt, 1);
+    aged.event.delta = 1;
+    aged.ageSeconds = sqlite3_column_double(stmt, 2);
+    events.push_back(aged);
+  }
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace blog
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "db/Database.h"
+#include "models/Interaction.h"
+
+namespace blog {
+
+struct TrendingScore {
+  int64_t postId = 0;
+  double score = 0.0;
+  int64_t atMs = 0;
+};
+
+// A past interaction used to seed the ranking when there is no snapshot.
+struct AgedInteractionEvent {
+  InteractionEvent event;
+  double ageSeconds = 0.0;
+};
+
+class TrendingRepository {
+ public:
+  explicit TrendingRepository(const Database& db);
+
+  bool loadSnapshot(std::vector<TrendingScore>& scores, std::string& errorMessage) const;
+  // Replaces the stored snapshot with `scores` in one transaction.
+  bool saveSnapshot(const std::vector<TrendingScore>& scores, std::string& errorMessage) const;
+  // Likes, favorites and live comments created within the last
+  // `windowSeconds`, with their age. Only used at startup.
+  bool listRecentEvents(int64_t windowSeconds,
+                        std::vector<AgedInteractionEvent>& events,
+                        std::string& errorMessage) const;
+
+ private:
+  const Database& db_;
+};
+
+}  // namespace blog
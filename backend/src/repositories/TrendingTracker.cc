@@ -0,0 +1,157 @@
+#include "repositories/TrendingTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace blog {
+namespace {
+
+// Rebase before e^(lambda * (t - epoch)) can lose precision or overflow.
+constexpr double kMaxExponent = 40.0;
+// Scores that fall below this (after unlikes, say) are dropped.
+constexpr double kMinScore = 1e-6;
+// Without a snapshot, seed from this many half-lives of history.
+constexpr double kSeedHalfLives = 8.0;
+
+}  // namespace
+
+TrendingTracker::TrendingTracker(const TrendingRepository& trendingRepository, const AppConfig& config)
+    : trendingRepository_(trendingRepository),
+      lambdaPerMs_(std::log(2.0) / (std::max(1, config.trendingHalfLifeMinutes) * 60000.0)),
+      maxTracked_(static_cast<size_t>(std::max(1, config.trendingMaxTracked))),
+      epochMs_(nowMs()) {}
+
+int64_t TrendingTracker::nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+double TrendingTracker::weightFor(InteractionEventKind kind) {
+  switch (kind) {
+    case InteractionEventKind::Like:
+      return 3.0;
+    case InteractionEventKind::Favorite:
+      return 5.0;
+    case InteractionEventKind::Comment:
+      return 4.0;
+    case InteractionEventKind::View:
+      return 0.2;
+  }
+  return 0.0;
+}
+
+double TrendingTracker::decayToLocked(int64_t atMs) const {
+  return std::exp(-lambdaPerMs_ * static_cast<double>(atMs - epochMs_));
+}
+
+void TrendingTracker::rebaseLocked(int64_t atMs) {
+  const double factor = decayToLocked(atMs);
+  ranked_.clear();
+  for (auto it = scores_.begin(); it != scores_.end();) {
+    it->second *= factor;
+    if (it->second < kMinScore) {
+      it = scores_.erase(it);
+      continue;
+    }
+    ranked_.emplace(it->second, it->first);
+    ++it;
+  }
+  epochMs_ = atMs;
+}
+
+void TrendingTracker::addLocked(int64_t postId, double weight, int64_t atMs) {
+  if (lambdaPerMs_ * static_cast<double>(atMs - epochMs_) > kMaxExponent) {
+    rebaseLocked(atMs);
+  }
+
+  const double scaled = weight * std::exp(lambdaPerMs_ * static_cast<double>(atMs - epochMs_));
+  const auto it = scores_.find(postId);
+  const double previous = it != scores_.end() ? it->second : 0.0;
+  const double next = previous + scaled;
+  if (it != scores_.end()) {
+    ranked_.erase({previous, postId});
+  }
+
+  // Compare against the floor in current (not epoch-relative) terms.
+  if (next * decayToLocked(atMs) < kMinScore) {
+    if (it != scores_.end()) {
+      scores_.erase(it);
+    }
+    return;
+  }
+
+  scores_[postId] = next;
+  ranked_.emplace(next, postId);
+  if (scores_.size() > maxTracked_) {
+    const auto lowest = ranked_.begin();
+    scores_.erase(lowest->second);
+    ranked_.erase(lowest);
+  }
+}
+
+void TrendingTracker::record(const InteractionEvent& event) {
+  const double weight = weightFor(event.kind) * static_cast<double>(event.delta);
+  if (weight == 0.0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  addLocked(event.postId, weight, nowMs());
+}
+
+std::vector<std::pair<int64_t, double>> TrendingTracker::top(size_t limit) const {
+  std::vector<std::pair<int64_t, double>> result;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const double factor = decayToLocked(nowMs());
+  for (auto it = ranked_.rbegin(); it != ranked_.rend() && result.size() < limit; ++it) {
+    result.emplace_back(it->second, it->first * factor);
+  }
+  return result;
+}
+
+bool TrendingTracker::load(std::string& errorMessage) {
+  std::vector<TrendingScore> stored;
+  if (!trendingRepository_.loadSnapshot(stored, errorMessage)) {
+    return false;
+  }
+
+  const int64_t now = nowMs();
+  if (!stored.empty()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : stored) {
+      const double decayed = entry.score * std::exp(-lambdaPerMs_ * static_cast<double>(now - entry.atMs));
+      addLocked(entry.postId, decayed, now);
+    }
+    return true;
+  }
+
+  const auto windowSeconds = static_cast<int64_t>(kSeedHalfLives * std::log(2.0) / lambdaPerMs_ / 1000.0);
+  std::vector<AgedInteractionEvent> recent;
+  if (!trendingRepository_.listRecentEvents(windowSeconds, recent, errorMessage)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& aged : recent) {
+    const double weight = weightFor(aged.event.kind) * static_cast<double>(aged.event.delta);
+    addLocked(aged.event.postId, weight * std::exp(-lambdaPerMs_ * aged.ageSeconds * 1000.0), now);
+  }
+  return true;
+}
+
+bool TrendingTracker::snapshot(std::string& errorMessage) const {
+  std::vector<TrendingScore> scores;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t now = nowMs();
+    const double factor = decayToLocked(now);
+    scores.reserve(scores_.size());
+    for (const auto& [postId, score] : scores_) {
+      scores.push_back(TrendingScore{postId, score * factor, now});
+    }
+  }
+  return trendingRepository_.saveSnapshot(scores, errorMessage);
+}
+
+}  // namespace blog
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "app/AppConfig.h"
+#include "models/Interaction.h"
+#include "repositories/TrendingRepository.h"
+
+namespace blog {
+
+// Ranks posts by exponentially decayed interaction weight, updated from
+// InteractionRepository events instead of aggregating on every request.
+//
+// Decay is applied lazily: an event at time t adds w * e^(lambda * (t - epoch))
+// to the post's stored score, so every stored score shares the factor
+// e^(-lambda * (now - epoch)) and the ranking never needs rescoring as time
+// passes. When that exponent grows large, all scores are rebased to a new
+// epoch. A score-ordered set beside the id map gives the top K and the
+// eviction victim once more than maxTracked posts are held.
+class TrendingTracker {
+ public:
+  TrendingTracker(const TrendingRepository& trendingRepository, const AppConfig& config);
+
+  // Restores the last snapshot, or seeds from recent interactions if there is
+  // none. Call before serving.
+  bool load(std::string& errorMessage);
+  bool snapshot(std::string& errorMessage) const;
+
+  void record(const InteractionEvent& event);
+  // Up to `limit` (post id, score now) pairs, highest first.
+  std::vector<std::pair<int64_t, double>> top(size_t limit) const;
+
+ private:
+  static double weightFor(InteractionEventKind kind);
+  static int64_t nowMs();
+
+  void addLocked(int64_t postId, double weight, int64_t atMs);
+  void rebaseLocked(int64_t atMs);
+  double decayToLocked(int64_t atMs) const;
+
+  const TrendingRepository& trendingRepository_;
+  const double lambdaPerMs_;
+  const size_t maxTracked_;
+
+  mutable std::mutex mutex_;
+  int64_t epochMs_;
+  std::unordered_map<int64_t, double> scores_;
+  std::set<std::pair<double, int64_t>> ranked_;
+};
+
+}  // namespace blog
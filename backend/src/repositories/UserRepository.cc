@@ -2,6 +2,8 @@
 
 #include <sqlite3.h>
 
+#include "tracing/RequestTrace.h"
+
 namespace blog {
 namespace {
 
@@ -24,11 +26,38 @@ User rowToUser(sqlite3_stmt* stmt) {
   return user;
 }
 
+UserTokenState rowToTokenState(sqlite3_stmt* stmt) {
+  UserTokenState state;
+  state.userId = sqlite3_column_int64(stmt, 0);
+  state.tokenVersion = sqlite3_column_int64(stmt, 1);
+  state.isBanned = sqlite3_column_int(stmt, 2) != 0;
+  return state;
+}
+
+// Steps an UPDATE ... RETURNING id, token_version, is_banned for one user.
+bool readTokenState(const Database::Connection& conn,
+                    sqlite3_stmt* stmt,
+                    UserTokenState& state,
+                    std::string& errorMessage) {
+  const int rc = sqlite3_step(stmt);
+  if (rc == SQLITE_DONE) {
+    errorMessage = "user not found";
+    return false;
+  }
+  if (rc != SQLITE_ROW) {
+    errorMessage = sqlite3_errmsg(conn.get());
+    return false;
+  }
+  state = rowToTokenState(stmt);
+  return true;
+}
+
 }  // namespace
 
 UserRepository::UserRepository(const Database& db) : db_(db) {}
 
 std::optional<User> UserRepository::findByUsername(const std::string& username) const {
+  const tracing::ScopedSpan span(tracing::Stage::UserLookup);
   std::string error;
   sqlite3* db = db_.open(error);
   if (db == nullptr) {
@@ -58,6 +87,7 @@ std::optional<User> UserRepository::findByUsername(const std::string& username)
 }
 
 std::optional<User> UserRepository::findById(int64_t id) const {
+  const tracing::ScopedSpan span(tracing::Stage::UserLookup);
   std::string error;
   sqlite3* db = db_.open(error);
   if (db == nullptr) {
@@ -262,164 +292,127 @@ bool UserRepository::listUsers(int page,
   return true;
 }
 
-bool UserRepository::updateRole(int64_t userId, const std::string& role, std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+bool UserRepository::updateRole(int64_t userId,
+                                const std::string& role,
+                                UserTokenState& state,
+                                std::string& errorMessage) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const char* sql = "UPDATE users SET role = ? WHERE id = ?;";
-  sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* stmt = conn.prepare(
+      "UPDATE users SET role = ?, token_version = token_version + 1 WHERE id = ? "
+      "RETURNING id, token_version, is_banned;",
+      errorMessage);
+  if (stmt == nullptr) {
     return false;
   }
 
   sqlite3_bind_text(stmt, 1, role.c_str(), -1, SQLITE_TRANSIENT);
   sqlite3_bind_int64(stmt, 2, userId);
+  return readTokenState(conn, stmt, state, errorMessage);
+}
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+bool UserRepository::updateBanStatus(int64_t userId,
+                                     bool isBanned,
+                                     UserTokenState& state,
+                                     std::string& errorMessage) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const int changed = sqlite3_changes(db);
-  sqlite3_finalize(stmt);
-
-  if (changed == 0) {
-    sqlite3_stmt* existsStmt = nullptr;
-    if (sqlite3_prepare_v2(db, "SELECT COUNT(1) FROM users WHERE id = ?;", -1, &existsStmt, nullptr) !=
-        SQLITE_OK) {
-      errorMessage = sqlite3_errmsg(db);
-      sqlite3_close(db);
-      return false;
-    }
-    sqlite3_bind_int64(existsStmt, 1, userId);
-    const int rc = sqlite3_step(existsStmt);
-    const bool exists = (rc == SQLITE_ROW && sqlite3_column_int(existsStmt, 0) > 0);
-    sqlite3_finalize(existsStmt);
-    sqlite3_close(db);
-    if (exists) {
-      return true;
-    }
-    errorMessage = "user not found";
+  // Unbanning bumps the version too: it orders concurrent ban changes for
+  // TokenVersionStore and costs nothing, since a banned user holds no
+  // current token.
+  sqlite3_stmt* stmt = conn.prepare(
+      "UPDATE users SET is_banned = ?, token_version = token_version + 1 WHERE id = ? "
+      "RETURNING id, token_version, is_banned;",
+      errorMessage);
+  if (stmt == nullptr) {
     return false;
   }
 
-  sqlite3_close(db);
-  return true;
+  sqlite3_bind_int(stmt, 1, isBanned ? 1 : 0);
+  sqlite3_bind_int64(stmt, 2, userId);
+  return readTokenState(conn, stmt, state, errorMessage);
 }
 
-bool UserRepository::updateBanStatus(int64_t userId, bool isBanned, std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+bool UserRepository::updatePasswordHash(int64_t userId,
+                                        const std::string& passwordHash,
+                                        UserTokenState& state,
+                                        std::string& errorMessage) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const char* sql = "UPDATE users SET is_banned = ? WHERE id = ?;";
-  sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* stmt = conn.prepare(
+      "UPDATE users SET password_hash = ?, token_version = token_version + 1 WHERE id = ? "
+      "RETURNING id, token_version, is_banned;",
+      errorMessage);
+  if (stmt == nullptr) {
     return false;
   }
 
-  sqlite3_bind_int(stmt, 1, isBanned ? 1 : 0);
+  sqlite3_bind_text(stmt, 1, passwordHash.c_str(), -1, SQLITE_TRANSIENT);
   sqlite3_bind_int64(stmt, 2, userId);
+  return readTokenState(conn, stmt, state, errorMessage);
+}
 
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
+bool UserRepository::replacePasswordHash(int64_t userId,
+                                         const std::string& expectedHash,
+                                         const std::string& newHash,
+                                         bool& replaced,
+                                         std::string& errorMessage) const {
+  replaced = false;
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const int changed = sqlite3_changes(db);
-  sqlite3_finalize(stmt);
+  sqlite3_stmt* stmt =
+      conn.prepare("UPDATE users SET password_hash = ? WHERE id = ? AND password_hash = ?;", errorMessage);
+  if (stmt == nullptr) {
+    return false;
+  }
 
-  if (changed == 0) {
-    sqlite3_stmt* existsStmt = nullptr;
-    if (sqlite3_prepare_v2(db, "SELECT COUNT(1) FROM users WHERE id = ?;", -1, &existsStmt, nullptr) !=
-        SQLITE_OK) {
-      errorMessage = sqlite3_errmsg(db);
-      sqlite3_close(db);
-      return false;
-    }
-    sqlite3_bind_int64(existsStmt, 1, userId);
-    const int rc = sqlite3_step(existsStmt);
-    const bool exists = (rc == SQLITE_ROW && sqlite3_column_int(existsStmt, 0) > 0);
-    sqlite3_finalize(existsStmt);
-    sqlite3_close(db);
-    if (exists) {
-      return true;
-    }
-    errorMessage = "user not found";
+  sqlite3_bind_text(stmt, 1, newHash.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, userId);
+  sqlite3_bind_text(stmt, 3, expectedHash.c_str(), -1, SQLITE_TRANSIENT);
+
+  if (sqlite3_step(stmt) != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
 
-  sqlite3_close(db);
+  replaced = sqlite3_changes(conn.get()) > 0;
   return true;
 }
 
-bool UserRepository::updatePasswordHash(int64_t userId,
-                                        const std::string& passwordHash,
-                                        std::string& errorMessage) const {
-  std::string dbError;
-  sqlite3* db = db_.open(dbError);
-  if (db == nullptr) {
-    errorMessage = dbError;
+bool UserRepository::listTokenStates(std::vector<UserTokenState>& states, std::string& errorMessage) const {
+  auto conn = db_.acquire(errorMessage);
+  if (!conn) {
     return false;
   }
 
-  const char* sql = "UPDATE users SET password_hash = ? WHERE id = ?;";
-  sqlite3_stmt* stmt = nullptr;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_close(db);
+  sqlite3_stmt* stmt = conn.prepare(
+      "SELECT id, token_version, is_banned FROM users WHERE token_version > 0 OR is_banned = 1;", errorMessage);
+  if (stmt == nullptr) {
     return false;
   }
 
-  sqlite3_bind_text(stmt, 1, passwordHash.c_str(), -1, SQLITE_TRANSIENT);
-  sqlite3_bind_int64(stmt, 2, userId);
-
-  if (sqlite3_step(stmt) != SQLITE_DONE) {
-    errorMessage = sqlite3_errmsg(db);
-    sqlite3_finalize(stmt);
-    sqlite3_close(db);
-    return false;
+  states.clear();
+  int rc = SQLITE_ROW;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    states.push_back(rowToTokenState(stmt));
   }
 
-  const int changed = sqlite3_changes(db);
-  sqlite3_finalize(stmt);
-
-  if (changed == 0) {
-    sqlite3_stmt* existsStmt = nullptr;
-    if (sqlite3_prepare_v2(db, "SELECT COUNT(1) FROM users WHERE id = ?;", -1, &existsStmt, nullptr) !=
-        SQLITE_OK) {
-      errorMessage = sqlite3_errmsg(db);
-      sqlite3_close(db);
-      return false;
-    }
-    sqlite3_bind_int64(existsStmt, 1, userId);
-    const int rc = sqlite3_step(existsStmt);
-    const bool exists = (rc == SQLITE_ROW && sqlite3_column_int(existsStmt, 0) > 0);
-    sqlite3_finalize(existsStmt);
-    sqlite3_close(db);
-    if (exists) {
-      return true;
-    }
-    errorMessage = "user not found";
+  if (rc != SQLITE_DONE) {
+    errorMessage = sqlite3_errmsg(conn.get());
     return false;
   }
-
-  sqlite3_close(db);
   return true;
 }
 
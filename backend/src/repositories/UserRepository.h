@@ -34,9 +34,25 @@ class UserRepository {
                  int& total,
                  std::string& errorMessage) const;
 
-  bool updateRole(int64_t userId, const std::string& role, std::string& errorMessage) const;
-  bool updateBanStatus(int64_t userId, bool isBanned, std::string& errorMessage) const;
-  bool updatePasswordHash(int64_t userId, const std::string& passwordHash, std::string& errorMessage) const;
+  // Role, ban and password changes bump token_version in the same
+  // statement, so the change and the revocation of older access tokens
+  // commit together.
+  bool updateRole(int64_t userId, const std::string& role, UserTokenState& state, std::string& errorMessage) const;
+  bool updateBanStatus(int64_t userId, bool isBanned, UserTokenState& state, std::string& errorMessage) const;
+  bool updatePasswordHash(int64_t userId,
+                          const std::string& passwordHash,
+                          UserTokenState& state,
+                          std::string& errorMessage) const;
+  // Users with a non-zero token version or a ban.
+  bool listTokenStates(std::vector<UserTokenState>& states, std::string& errorMessage) const;
+
+  // Swaps the hash only if it still equals expectedHash, so a background
+  // rehash never overwrites a password changed in the meantime.
+  bool replacePasswordHash(int64_t userId,
+                           const std::string& expectedHash,
+                           const std::string& newHash,
+                           bool& replaced,
+                           std::string& errorMessage) const;
 
  private:
   const Database& db_;
@@ -0,0 +1,83 @@
+#include "tracing/RequestTrace.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace blog::tracing {
+namespace {
+
+thread_local RequestTrace* activeTrace = nullptr;
+
+constexpr size_t kMaxStatementChars = 256;
+
+}  // namespace
+
+const char* stageName(Stage stage) {
+  switch (stage) {
+    case Stage::Route:
+      return "route";
+    case Stage::Auth:
+      return "auth";
+    case Stage::UserLookup:
+      return "user";
+    case Stage::PasswordHash:
+      return "hash";
+    case Stage::Db:
+      return "db";
+    case Stage::Json:
+      return "json";
+    case Stage::Handler:
+      return "app";
+  }
+  return "other";
+}
+
+int64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+RequestTrace::RequestTrace(bool keepSpans)
+    : keepSpans_(keepSpans),
+      startNanos_(nowNanos()),
+      startUnixNanos_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::system_clock::now().time_since_epoch())
+                          .count()) {
+  if (keepSpans_) {
+    spans_.reserve(16);
+  }
+}
+
+void RequestTrace::record(Stage stage, int64_t startNanos, int64_t endNanos) {
+  const auto index = static_cast<size_t>(stage);
+  totals_[index] += endNanos - startNanos;
+  ++counts_[index];
+  if (keepSpans_) {
+    spans_.push_back(Span{stage, startNanos, endNanos, {}});
+  }
+}
+
+void RequestTrace::recordStatement(int64_t startNanos, int64_t endNanos, const char* sql) {
+  record(Stage::Db, startNanos, endNanos);
+  if (keepSpans_ && sql != nullptr) {
+    spans_.back().detail.assign(sql, strnlen(sql, kMaxStatementChars));
+  }
+}
+
+void RequestTrace::finish(int64_t endNanos) {
+  endNanos_ = endNanos;
+}
+
+RequestTrace* currentTrace() {
+  return activeTrace;
+}
+
+ActiveTrace::ActiveTrace(RequestTrace* trace) : previous_(activeTrace) {
+  activeTrace = trace;
+}
+
+ActiveTrace::~ActiveTrace() {
+  activeTrace = previous_;
+}
+
+}  // namespace blog::tracing
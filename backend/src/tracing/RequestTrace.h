@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blog::tracing {
+
+enum class Stage : uint8_t {
+  Route,         // pre-routing advices and routing
+  Auth,          // bearer token parsing and JWT verification
+  UserLookup,    // UserRepository reads by id or username
+  PasswordHash,  // Argon2 hashing and verification
+  Db,            // one SQLite statement
+  Json,          // response envelope serialisation
+  Handler,       // from the pre-handling advice to the handler's callback
+};
+constexpr size_t kStageCount = 7;
+
+// Short name used in Server-Timing, the access log and exported spans.
+const char* stageName(Stage stage);
+
+// steady_clock in nanoseconds.
+int64_t nowNanos();
+
+struct Span {
+  Stage stage;
+  int64_t startNanos;
+  int64_t endNanos;
+  // SQL text for Db spans.
+  std::string detail;
+};
+
+// Stage timings of one request. Totals are always kept; individual spans only
+// when the trace will be exported. A trace is only touched by the IO thread
+// running its request until finish(), and read-only afterwards.
+class RequestTrace {
+ public:
+  explicit RequestTrace(bool keepSpans);
+
+  void record(Stage stage, int64_t startNanos, int64_t endNanos);
+  void recordStatement(int64_t startNanos, int64_t endNanos, const char* sql);
+  void markHandlerStart(int64_t nanos) { handlerStartNanos_ = nanos; }
+  void finish(int64_t endNanos);
+
+  bool keepsSpans() const { return keepSpans_; }
+  int64_t startNanos() const { return startNanos_; }
+  int64_t endNanos() const { return endNanos_; }
+  // 0 until the pre-handling advice runs; requests answered before routing
+  // never reach it.
+  int64_t handlerStartNanos() const { return handlerStartNanos_; }
+  // Wall-clock time of startNanos(), for exporters.
+  int64_t startUnixNanos() const { return startUnixNanos_; }
+  int64_t totalNanos(Stage stage) const { return totals_[static_cast<size_t>(stage)]; }
+  uint32_t count(Stage stage) const { return counts_[static_cast<size_t>(stage)]; }
+  const std::vector<Span>& spans() const { return spans_; }
+
+ private:
+  const bool keepSpans_;
+  const int64_t startNanos_;
+  const int64_t startUnixNanos_;
+  int64_t handlerStartNanos_ = 0;
+  int64_t endNanos_ = 0;
+  std::array<int64_t, kStageCount> totals_{};
+  std::array<uint32_t, kStageCount> counts_{};
+  std::vector<Span> spans_;
+};
+
+// The trace of the request the calling thread is serving, or null when
+// tracing is off or the thread is outside a request. Spans recorded with no
+// current trace cost one thread-local load.
+RequestTrace* currentTrace();
+
+// Makes `trace` current for the lifetime of the scope.
+class ActiveTrace {
+ public:
+  explicit ActiveTrace(RequestTrace* trace);
+  ~ActiveTrace();
+
+  ActiveTrace(const ActiveTrace&) = delete;
+  ActiveTrace& operator=(const ActiveTrace&) = delete;
+
+ private:
+  RequestTrace* previous_;
+};
+
+// Records its own lifetime as a span of the current trace, if any.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(Stage stage) : stage_(stage), trace_(currentTrace()) {
+    if (trace_ != nullptr) {
+      startNanos_ = nowNanos();
+    }
+  }
+  ~ScopedSpan() {
+    if (trace_ != nullptr) {
+      trace_->record(stage_, startNanos_, nowNanos());
+    }
+  }
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+ private:
+  const Stage stage_;
+  RequestTrace* const trace_;
+  int64_t startNanos_ = 0;
+};
+
+}  // namespace blog::tracing
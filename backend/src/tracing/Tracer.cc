@@ -0,0 +1,380 @@
+#include "tracing/Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <utility>
+
+#include "utils/FastRandom.h"
+#include "utils/JsonResponse.h"
+#include "utils/JsonWriter.h"
+
+namespace blog::tracing {
+namespace {
+
+constexpr char kTraceAttribute[] = "tracing.trace";
+constexpr size_t kExportBufferTraces = 4096;
+constexpr int kExportIntervalMs = 1000;
+constexpr size_t kBatchBytes = 256 * 1024;
+
+// OTLP SpanKind values.
+constexpr int kSpanKindInternal = 1;
+constexpr int kSpanKindServer = 2;
+constexpr int kSpanKindClient = 3;
+
+const char* methodName(drogon::HttpMethod method) {
+  switch (method) {
+    case drogon::Get:
+      return "GET";
+    case drogon::Post:
+      return "POST";
+    case drogon::Head:
+      return "HEAD";
+    case drogon::Put:
+      return "PUT";
+    case drogon::Delete:
+      return "DELETE";
+    case drogon::Options:
+      return "OPTIONS";
+    case drogon::Patch:
+      return "PATCH";
+    default:
+      return "OTHER";
+  }
+}
+
+void appendMillis(std::string& out, const char* name, int64_t nanos) {
+  char buffer[64];
+  const int written = std::snprintf(buffer, sizeof(buffer), "%s;dur=%.3f", name, static_cast<double>(nanos) / 1e6);
+  if (!out.empty()) {
+    out += ", ";
+  }
+  out.append(buffer, static_cast<size_t>(std::max(0, written)));
+}
+
+std::string serverTiming(const RequestTrace& trace) {
+  std::string header;
+  header.reserve(128);
+  for (size_t i = 0; i < kStageCount; ++i) {
+    const auto stage = static_cast<Stage>(i);
+    if (trace.count(stage) == 0) {
+      continue;
+    }
+    appendMillis(header, stageName(stage), trace.totalNanos(stage));
+    if (stage == Stage::Db) {
+      const uint32_t statements = trace.count(stage);
+      header += ";desc=\"" + std::to_string(statements) + (statements == 1 ? " statement\"" : " statements\"");
+    }
+  }
+  appendMillis(header, "total", trace.endNanos() - trace.startNanos());
+  return header;
+}
+
+bool isLowerHex(std::string_view text) {
+  return std::all_of(text.begin(), text.end(), [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); });
+}
+
+// W3C traceparent: "00-<32 hex trace id>-<16 hex parent id>-<2 hex flags>".
+bool parseTraceParent(const std::string& header, std::string& traceId, std::string& parentId) {
+  if (header.size() < 55 || header.compare(0, 3, "00-") != 0 || header[35] != '-' || header[52] != '-') {
+    return false;
+  }
+  const std::string_view view(header);
+  const auto trace = view.substr(3, 32);
+  const auto parent = view.substr(36, 16);
+  if (!isLowerHex(trace) || !isLowerHex(parent) || trace == std::string(32, '0') || parent == std::string(16, '0')) {
+    return false;
+  }
+  traceId.assign(trace);
+  parentId.assign(parent);
+  return true;
+}
+
+void writeStringAttribute(utils::JsonWriter& writer, const char* key, std::string_view value) {
+  writer.beginObject();
+  writer.field("key", key);
+  writer.key("value").beginObject().field("stringValue", value).endObject();
+  writer.endObject();
+}
+
+void writeIntAttribute(utils::JsonWriter& writer, const char* key, int64_t value) {
+  // Protobuf JSON encodes 64-bit integers as strings.
+  writer.beginObject();
+  writer.field("key", key);
+  writer.key("value").beginObject().field("intValue", std::to_string(value)).endObject();
+  writer.endObject();
+}
+
+}  // namespace
+
+Tracer::Tracer(const AppConfig& config, metrics::MetricsRegistry& registry)
+    : enabled_(config.traceEnabled),
+      serverTiming_(config.traceServerTiming),
+      exportSamplePercent_(config.traceExportPath.empty() ? 0 : std::clamp(config.traceExportSamplePercent, 0, 100)),
+      exportRing_(kExportBufferTraces),
+      exportFile_(config.traceExportPath,
+                  static_cast<uint64_t>(std::max(0, config.traceExportMaxMegabytes)) * 1024 * 1024,
+                  config.traceExportMaxFiles),
+      exported_(registry.counter("blog_trace_exports_total", "Traces handed to the OTLP file exporter by outcome",
+                                 {{"outcome", "written"}})),
+      exportDropped_(registry.counter("blog_trace_exports_total",
+                                      "Traces handed to the OTLP file exporter by outcome",
+                                      {{"outcome", "dropped"}})),
+      idGenerator_(std::random_device{}()) {}
+
+Tracer::~Tracer() {
+  stop();
+}
+
+const RequestTrace* Tracer::find(const drogon::HttpRequestPtr& req) {
+  const auto& attributes = req->attributes();
+  if (!attributes->find(kTraceAttribute)) {
+    return nullptr;
+  }
+  return attributes->get<std::shared_ptr<RequestTrace>>(kTraceAttribute).get();
+}
+
+void Tracer::install() {
+  if (!enabled_) {
+    return;
+  }
+  drogon::app().registerPreRoutingAdvice([this](const drogon::HttpRequestPtr& req,
+                                                drogon::AdviceCallback&&,
+                                                drogon::AdviceChainCallback&& chainCallback) {
+    onRequest(req, std::move(chainCallback));
+  });
+  drogon::app().registerPostRoutingAdvice([](const drogon::HttpRequestPtr&,
+                                             drogon::AdviceCallback&&,
+                                             drogon::AdviceChainCallback&& chainCallback) {
+    if (RequestTrace* trace = currentTrace()) {
+      trace->record(Stage::Route, trace->startNanos(), nowNanos());
+    }
+    chainCallback();
+  });
+  drogon::app().registerPreHandlingAdvice([](const drogon::HttpRequestPtr&,
+                                             drogon::AdviceCallback&&,
+                                             drogon::AdviceChainCallback&& chainCallback) {
+    if (RequestTrace* trace = currentTrace()) {
+      trace->markHandlerStart(nowNanos());
+    }
+    chainCallback();
+  });
+  drogon::app().registerPostHandlingAdvice(
+      [this](const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) { onResponse(req, resp); });
+}
+
+void Tracer::start() {
+  if (exportSamplePercent_ == 0 || exporter_.joinable()) {
+    return;
+  }
+  if (!exportFile_.open()) {
+    LOG_ERROR << "failed to open trace export file " << exportFile_.path() << ", traces will not be exported";
+    return;
+  }
+  exporter_ = std::thread([this]() { runExporter(); });
+}
+
+void Tracer::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  if (exporter_.joinable()) {
+    exporter_.join();
+  }
+  exportFile_.close();
+}
+
+bool Tracer::sampleForExport() const {
+  if (exportSamplePercent_ == 0) {
+    return false;
+  }
+  return static_cast<int>(utils::threadLocalRandom() % 100) < exportSamplePercent_;
+}
+
+void Tracer::onRequest(const drogon::HttpRequestPtr& req, drogon::AdviceChainCallback&& chainCallback) {
+  auto trace = std::make_shared<RequestTrace>(sampleForExport());
+  RequestTrace* raw = trace.get();
+  req->attributes()->insert(kTraceAttribute, std::move(trace));
+  // Routing, filters, the handler and the post-handling advices all run
+  // inside this call for synchronous handlers. Work a handler defers to
+  // another thread or a later loop iteration is not attributed.
+  ActiveTrace active(raw);
+  chainCallback();
+}
+
+void Tracer::onResponse(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp) {
+  const auto& attributes = req->attributes();
+  if (!attributes->find(kTraceAttribute)) {
+    return;
+  }
+  const auto& trace = attributes->get<std::shared_ptr<RequestTrace>>(kTraceAttribute);
+  if (!trace || trace->endNanos() != 0) {
+    return;
+  }
+  const int64_t now = nowNanos();
+  if (trace->handlerStartNanos() != 0) {
+    trace->record(Stage::Handler, trace->handlerStartNanos(), now);
+  }
+  trace->finish(now);
+
+  if (serverTiming_) {
+    resp->addHeader("Server-Timing", serverTiming(*trace));
+  }
+  if (!trace->keepsSpans() || !exporter_.joinable()) {
+    return;
+  }
+
+  ExportedTrace exported;
+  exported.trace = trace;
+  exported.method = req->method();
+  exported.status = static_cast<int>(resp->statusCode());
+  exported.path = req->path();
+  exported.route = std::string(req->getMatchedPathPattern());
+  exported.requestId = utils::getRequestId(req);
+  exported.traceParent = req->getHeader("traceparent");
+  if (!exportRing_.tryPush(std::move(exported))) {
+    exportDropped_.inc();
+    return;
+  }
+  if (exportRing_.size() >= exportRing_.capacity() / 2) {
+    wake_.notify_one();
+  }
+}
+
+void Tracer::runExporter() {
+  std::string batch;
+  batch.reserve(kBatchBytes + 16 * 1024);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    wake_.wait_for(lock, std::chrono::milliseconds(kExportIntervalMs), [this]() {
+      return stopping_ || exportRing_.size() >= exportRing_.capacity() / 2;
+    });
+    lock.unlock();
+    drain(batch);
+    lock.lock();
+  }
+  lock.unlock();
+  drain(batch);
+}
+
+void Tracer::drain(std::string& batch) {
+  ExportedTrace exported;
+  uint64_t count = 0;
+  while (exportRing_.tryPop(exported)) {
+    appendOtlp(exported, batch);
+    exported.trace.reset();
+    ++count;
+    if (batch.size() >= kBatchBytes) {
+      exportFile_.write(batch);
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    exportFile_.write(batch);
+    batch.clear();
+  }
+  exportRing_.publishHead();
+  exported_.inc(count);
+}
+
+std::string Tracer::randomHex(size_t bytes) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string hex;
+  hex.reserve(bytes * 2);
+  uint64_t bits = 0;
+  for (size_t i = 0; i < bytes; ++i) {
+    if (i % 8 == 0) {
+      bits = idGenerator_();
+    }
+    const auto byte = static_cast<unsigned>(bits & 0xff);
+    bits >>= 8;
+    hex.push_back(kDigits[byte >> 4]);
+    hex.push_back(kDigits[byte & 0xf]);
+  }
+  return hex;
+}
+
+void Tracer::appendOtlp(const ExportedTrace& exported, std::string& out) {
+  const RequestTrace& trace = *exported.trace;
+  std::string traceId;
+  std::string remoteParentId;
+  if (!parseTraceParent(exported.traceParent, traceId, remoteParentId)) {
+    traceId = randomHex(16);
+    remoteParentId.clear();
+  }
+  const std::string rootId = randomHex(8);
+  const auto unixNanos = [&trace](int64_t steadyNanos) {
+    return std::to_string(trace.startUnixNanos() + (steadyNanos - trace.startNanos()));
+  };
+  const std::string route = exported.route.empty() ? exported.path : exported.route;
+
+  utils::JsonWriter writer(1024 + trace.spans().size() * 256);
+  writer.beginObject();
+  writer.key("resourceSpans").beginArray().beginObject();
+  writer.key("resource").beginObject();
+  writer.key("attributes").beginArray();
+  writeStringAttribute(writer, "service.name", "blog_api");
+  writer.endArray();
+  writer.endObject();
+  writer.key("scopeSpans").beginArray().beginObject();
+  writer.key("scope").beginObject().field("name", "blog.tracing").endObject();
+  writer.key("spans").beginArray();
+
+  writer.beginObject();
+  writer.field("traceId", traceId);
+  writer.field("spanId", rootId);
+  if (!remoteParentId.empty()) {
+    writer.field("parentSpanId", remoteParentId);
+  }
+  writer.field("name", std::string(methodName(exported.method)) + " " + route);
+  writer.field("kind", kSpanKindServer);
+  writer.field("startTimeUnixNano", unixNanos(trace.startNanos()));
+  writer.field("endTimeUnixNano", unixNanos(trace.endNanos()));
+  writer.key("attributes").beginArray();
+  writeStringAttribute(writer, "http.request.method", methodName(exported.method));
+  writeStringAttribute(writer, "url.path", exported.path);
+  if (!exported.route.empty()) {
+    writeStringAttribute(writer, "http.route", exported.route);
+  }
+  writeIntAttribute(writer, "http.response.status_code", exported.status);
+  writeStringAttribute(writer, "blog.request_id", exported.requestId);
+  writer.endArray();
+  // STATUS_CODE_ERROR for server errors only, as the HTTP conventions say.
+  writer.key("status").beginObject();
+  if (exported.status >= 500) {
+    writer.field("code", 2);
+  }
+  writer.endObject();
+  writer.endObject();
+
+  for (const Span& span : trace.spans()) {
+    writer.beginObject();
+    writer.field("traceId", traceId);
+    writer.field("spanId", randomHex(8));
+    writer.field("parentSpanId", rootId);
+    writer.field("name", stageName(span.stage));
+    writer.field("kind", span.stage == Stage::Db ? kSpanKindClient : kSpanKindInternal);
+    writer.field("startTimeUnixNano", unixNanos(span.startNanos));
+    writer.field("endTimeUnixNano", unixNanos(span.endNanos));
+    if (span.stage == Stage::Db) {
+      writer.key("attributes").beginArray();
+      writeStringAttribute(writer, "db.system", "sqlite");
+      if (!span.detail.empty()) {
+        writeStringAttribute(writer, "db.statement", span.detail);
+      }
+      writer.endArray();
+    }
+    writer.endObject();
+  }
+
+  writer.endArray();
+  writer.endObject().endArray();
+  writer.endObject().endArray();
+  writer.endObject();
+  out += writer.str();
+  out.push_back('\n');
+}
+
+}  // namespace blog::tracing
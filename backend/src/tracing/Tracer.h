@@ -0,0 +1,92 @@
+#pragma once
+
+#include <drogon/drogon.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "app/AppConfig.h"
+#include "logging/MpscRing.h"
+#include "logging/RotatingFile.h"
+#include "metrics/MetricsRegistry.h"
+#include "tracing/RequestTrace.h"
+
+namespace blog::tracing {
+
+// Request-scoped stage tracing. The pre-routing advice creates a
+// RequestTrace, keeps it in the request attributes and makes it current on
+// the IO thread while drogon routes, filters and runs the handler; code along
+// the way records spans with ScopedSpan, and SQLite statements report through
+// Database's profile hook. The post-handling advice closes the trace and adds
+// a Server-Timing header with the per-stage totals; the access log picks them
+// up from the same trace.
+//
+// With an export path set, a sample of traces keep every span and are
+// written by a background thread as OTLP/JSON lines (one
+// ExportTraceServiceRequest per request), which the OpenTelemetry
+// Collector's otlpjsonfile receiver can read. The file rotates on its own
+// size and count limits, independent of the access log's.
+//
+// When tracing is disabled no advice is installed, no trace is created and a
+// span costs a thread-local load.
+class Tracer {
+ public:
+  Tracer(const AppConfig& config, metrics::MetricsRegistry& registry);
+  ~Tracer();
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  // Call after HttpMetrics::install() and before AccessLog::install(), so
+  // the trace covers the remaining advices and is closed before the access
+  // log reads it.
+  void install();
+  void start();
+  void stop();
+
+  // The trace of `req`, or null when tracing is off.
+  static const RequestTrace* find(const drogon::HttpRequestPtr& req);
+
+ private:
+  struct ExportedTrace {
+    std::shared_ptr<const RequestTrace> trace;
+    drogon::HttpMethod method = drogon::Invalid;
+    int status = 0;
+    std::string path;
+    std::string route;
+    std::string requestId;
+    std::string traceParent;
+  };
+
+  void onRequest(const drogon::HttpRequestPtr& req, drogon::AdviceChainCallback&& chainCallback);
+  void onResponse(const drogon::HttpRequestPtr& req, const drogon::HttpResponsePtr& resp);
+  bool sampleForExport() const;
+  void runExporter();
+  void drain(std::string& batch);
+  void appendOtlp(const ExportedTrace& exported, std::string& out);
+  std::string randomHex(size_t bytes);
+
+  const bool enabled_;
+  const bool serverTiming_;
+  const int exportSamplePercent_;
+
+  logging::MpscRing<ExportedTrace> exportRing_;
+  logging::RotatingFile exportFile_;
+  metrics::Counter& exported_;
+  metrics::Counter& exportDropped_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread exporter_;
+
+  // Exporter thread only.
+  std::mt19937_64 idGenerator_;
+};
+
+}  // namespace blog::tracing
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace blog::utils {
+
+// xorshift64* with one state per thread: cheap, lock-free randomness for
+// sampling decisions on IO threads. Not for anything security related.
+inline uint64_t threadLocalRandom() {
+  thread_local uint64_t state = [] {
+    const auto seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return (seed ^ reinterpret_cast<uintptr_t>(&state)) | 1;
+  }();
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+}  // namespace blog::utils
@@ -3,45 +3,77 @@
 #include <drogon/drogon.h>
 
 #include <string>
+#include <utility>
 
+#include "tracing/RequestTrace.h"
 #include "utils/ApiError.h"
+#include "utils/JsonWriter.h"
 
 namespace blog::utils {
 
+// The caller's X-Request-Id, or an id generated once per request and kept in
+// its attributes, so the response envelope and the access log agree.
 inline std::string getRequestId(const drogon::HttpRequestPtr& req) {
   const auto incoming = req->getHeader("X-Request-Id");
   if (!incoming.empty()) {
     return incoming;
   }
-  return drogon::utils::getUuid();
+  constexpr char kGeneratedIdAttribute[] = "requestId";
+  const auto& attributes = req->attributes();
+  if (attributes->find(kGeneratedIdAttribute)) {
+    return attributes->get<std::string>(kGeneratedIdAttribute);
+  }
+  std::string generated = drogon::utils::getUuid();
+  attributes->insert(kGeneratedIdAttribute, generated);
+  return generated;
+}
+
+inline drogon::HttpResponsePtr makeJsonResponse(std::string body, int status) {
+  auto resp = drogon::HttpResponse::newHttpResponse();
+  resp->setStatusCode(static_cast<drogon::HttpStatusCode>(status));
+  resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+  resp->setBody(std::move(body));
+  return resp;
+}
+
+// Success envelope whose data is streamed by `writeData(JsonWriter&)`, so
+// list endpoints never materialise a Json::Value for their items.
+template <typename WriteData>
+drogon::HttpResponsePtr makeSuccessWith(WriteData&& writeData,
+                                        const std::string& requestId,
+                                        int status = 200,
+                                        const std::string& message = "success",
+                                        size_t reserveBytes = 4096) {
+  const tracing::ScopedSpan span(tracing::Stage::Json);
+  JsonWriter writer(reserveBytes);
+  writer.beginObject();
+  writer.field("code", "OK");
+  writer.field("message", message);
+  writer.key("data");
+  writeData(writer);
+  writer.field("requestId", requestId);
+  writer.endObject();
+  return makeJsonResponse(writer.release(), status);
 }
 
 inline drogon::HttpResponsePtr makeSuccess(const Json::Value& data,
                                            const std::string& requestId,
                                            int status = 200,
                                            const std::string& message = "success") {
-  Json::Value body(Json::objectValue);
-  body["code"] = "OK";
-  body["message"] = message;
-  body["data"] = data;
-  body["requestId"] = requestId;
-
-  auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
-  resp->setStatusCode(static_cast<drogon::HttpStatusCode>(status));
-  return resp;
+  return makeSuccessWith([&data](JsonWriter& writer) { writer.value(data); }, requestId, status, message, 512);
 }
 
 inline drogon::HttpResponsePtr makeError(const blog::ApiError& error,
                                          const std::string& requestId) {
-  Json::Value body(Json::objectValue);
-  body["code"] = error.code;
-  body["message"] = error.message;
-  body["details"] = error.details;
-  body["requestId"] = requestId;
-
-  auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
-  resp->setStatusCode(static_cast<drogon::HttpStatusCode>(error.httpStatus));
-  return resp;
+  const tracing::ScopedSpan span(tracing::Stage::Json);
+  JsonWriter writer(256);
+  writer.beginObject();
+  writer.field("code", error.code);
+  writer.field("message", error.message);
+  writer.field("details", error.details);
+  writer.field("requestId", requestId);
+  writer.endObject();
+  return makeJsonResponse(writer.release(), error.httpStatus);
 }
 
 }  // namespace blog::utils
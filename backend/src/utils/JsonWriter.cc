@@ -0,0 +1,184 @@
+#include "utils/JsonWriter.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace blog::utils {
+
+JsonWriter::JsonWriter(size_t reserveBytes) { out_.reserve(reserveBytes); }
+
+void JsonWriter::separate() {
+  if (afterKey_) {
+    afterKey_ = false;
+  } else if (needComma_) {
+    out_.push_back(',');
+  }
+}
+
+JsonWriter& JsonWriter::beginObject() {
+  separate();
+  out_.push_back('{');
+  needComma_ = false;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  out_.push_back('}');
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  separate();
+  out_.push_back('[');
+  needComma_ = false;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  out_.push_back(']');
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+  if (needComma_) {
+    out_.push_back(',');
+  }
+  appendEscaped(name);
+  out_.push_back(':');
+  afterKey_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+  separate();
+  appendEscaped(text);
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t number) {
+  separate();
+  char buffer[24];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(number));
+  out_.append(buffer, static_cast<size_t>(length));
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+  if (!std::isfinite(number)) {
+    return null();
+  }
+  separate();
+  // Same precision jsoncpp writes with, so switching writers keeps values.
+  char buffer[32];
+  const int length = std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+  out_.append(buffer, static_cast<size_t>(length));
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag) {
+  separate();
+  out_.append(flag ? "true" : "false");
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+  separate();
+  out_.append("null");
+  needComma_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const Json::Value& tree) {
+  switch (tree.type()) {
+    case Json::nullValue:
+      return null();
+    case Json::intValue:
+      return value(static_cast<int64_t>(tree.asLargestInt()));
+    case Json::uintValue: {
+      separate();
+      out_.append(std::to_string(tree.asLargestUInt()));
+      needComma_ = true;
+      return *this;
+    }
+    case Json::realValue:
+      return value(tree.asDouble());
+    case Json::booleanValue:
+      return value(tree.asBool());
+    case Json::stringValue: {
+      const char* begin = nullptr;
+      const char* end = nullptr;
+      tree.getString(&begin, &end);
+      return value(std::string_view(begin, static_cast<size_t>(end - begin)));
+    }
+    case Json::arrayValue:
+      beginArray();
+      for (const auto& item : tree) {
+        value(item);
+      }
+      return endArray();
+    case Json::objectValue:
+      beginObject();
+      for (auto it = tree.begin(); it != tree.end(); ++it) {
+        const char* end = nullptr;
+        const char* name = it.memberName(&end);
+        key(std::string_view(name, static_cast<size_t>(end - name)));
+        value(*it);
+      }
+      return endObject();
+  }
+  return null();
+}
+
+void JsonWriter::appendEscaped(std::string_view text) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  out_.push_back('"');
+  // Copy clean runs in one append; only quotes, backslashes and control
+  // characters need rewriting. UTF-8 passes through, as drogon emits it.
+  size_t runStart = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    const auto c = static_cast<unsigned char>(text[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    out_.append(text.data() + runStart, i - runStart);
+    runStart = i + 1;
+    switch (c) {
+      case '"':
+        out_.append("\\\"");
+        break;
+      case '\\':
+        out_.append("\\\\");
+        break;
+      case '\b':
+        out_.append("\\b");
+        break;
+      case '\f':
+        out_.append("\\f");
+        break;
+      case '\n':
+        out_.append("\\n");
+        break;
+      case '\r':
+        out_.append("\\r");
+        break;
+      case '\t':
+        out_.append("\\t");
+        break;
+      default:
+        out_.append("\\u00");
+        out_.push_back(kHex[c >> 4]);
+        out_.push_back(kHex[c & 0x0f]);
+        break;
+    }
+  }
+  out_.append(text.data() + runStart, text.size() - runStart);
+  out_.push_back('"');
+}
+
+}  // namespace blog::utils
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace blog::utils {
+
+// Appends compact JSON straight into one reserved string, escaping as it
+// goes, so hot responses skip building a Json::Value tree and serialising
+// it a second time. The caller is responsible for balanced begin/end calls;
+// the writer only tracks where commas go.
+class JsonWriter {
+ public:
+  explicit JsonWriter(size_t reserveBytes = 1024);
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+
+  JsonWriter& key(std::string_view name);
+
+  JsonWriter& value(std::string_view text);
+  JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+  JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+  JsonWriter& value(int64_t number);
+  JsonWriter& value(int number) { return value(static_cast<int64_t>(number)); }
+  JsonWriter& value(double number);
+  JsonWriter& value(bool flag);
+  // Serialises an existing tree, for payloads that are still built as DOM.
+  JsonWriter& value(const Json::Value& tree);
+  JsonWriter& null();
+
+  template <typename T>
+  JsonWriter& field(std::string_view name, const T& v) {
+    key(name);
+    return value(v);
+  }
+
+  // Grows the buffer ahead of a write whose size the caller can estimate.
+  void reserveMore(size_t bytes) { out_.reserve(out_.size() + bytes); }
+
+  const std::string& str() const { return out_; }
+  std::string release() { return std::move(out_); }
+
+ private:
+  void separate();
+  void appendEscaped(std::string_view text);
+
+  std::string out_;
+  // True once the innermost open container holds an element.
+  bool needComma_ = false;
+  bool afterKey_ = false;
+};
+
+}  // namespace blog::utils
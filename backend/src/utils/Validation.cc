@@ -142,4 +142,20 @@ Pagination readPagination(const drogon::HttpRequestPtr& req,
   return p;
 }
 
+bool includeRequested(const drogon::HttpRequestPtr& req, const std::string& field) {
+  const std::string raw = req->getParameter("include");
+  size_t start = 0;
+  while (start <= raw.size()) {
+    size_t end = raw.find(',', start);
+    if (end == std::string::npos) {
+      end = raw.size();
+    }
+    if (raw.compare(start, end - start, field) == 0) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
 }  // namespace blog::utils
@@ -30,5 +30,7 @@ Pagination readPagination(const drogon::HttpRequestPtr& req,
                           int maxPageSize,
                           blog::ApiError& error,
                           bool& ok);
+// True when the comma-separated "include" query parameter lists `field`.
+bool includeRequested(const drogon::HttpRequestPtr& req, const std::string& field);
 
 }  // namespace blog::utils
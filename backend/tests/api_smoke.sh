@@ -9,9 +9,10 @@ USER_PASS="UserPass123!"
 USER_NEW_PASS="UserPass456!"
 COOKIE_FILE="$(mktemp)"
 ADMIN_COOKIE_FILE="$(mktemp)"
+STREAM_FILE="$(mktemp)"
 
 cleanup() {
-  rm -f "$COOKIE_FILE" "$ADMIN_COOKIE_FILE"
+  rm -f "$COOKIE_FILE" "$ADMIN_COOKIE_FILE" "$STREAM_FILE"
 }
 trap cleanup EXIT
 
@@ -38,6 +39,10 @@ USER_TOKEN=$(echo "$LOGIN_RESP" | jq -r '.data.accessToken')
 [ "$USER_TOKEN" != "null" ]
 
 echo "[3/17] Create post #1"
+# Listen on the post stream while creating, to see the post.created event.
+curl -sSN --max-time 3 "$BASE_URL/api/posts/stream" >"$STREAM_FILE" 2>/dev/null &
+STREAM_PID=$!
+sleep 1
 CREATE_RESP=$(curl -sS -X POST "$BASE_URL/api/posts" \
   -H 'Content-Type: application/json' \
   -H "Authorization: Bearer $USER_TOKEN" \
@@ -45,6 +50,9 @@ CREATE_RESP=$(curl -sS -X POST "$BASE_URL/api/posts" \
 POST_ID=$(echo "$CREATE_RESP" | jq -r '.data.id')
 
 [ "$POST_ID" != "null" ]
+wait "$STREAM_PID" || true
+grep -q '^event: post.created$' "$STREAM_FILE"
+grep -q "^data: {\"id\":$POST_ID," "$STREAM_FILE"
 
 echo "[4/17] Create post #2"
 CREATE_RESP_2=$(curl -sS -X POST "$BASE_URL/api/posts" \
@@ -85,10 +93,22 @@ curl -sS -X POST "$BASE_URL/api/collections/$COLLECTION_ID/posts" \
 
 echo "[7/17] Verify collection detail and prev/next navigation"
 curl -sS "$BASE_URL/api/collections/$COLLECTION_ID" \
-  | jq -e ".data.total == 2 and .data.posts[0].id == $POST_ID and .data.posts[1].id == $POST_ID_2" >/dev/null
+  | jq -e ".data.total == 2 and .data.collection.postCount == 2 and .data.posts[0].id == $POST_ID and .data.posts[1].id == $POST_ID_2" >/dev/null
 
 curl -sS "$BASE_URL/api/posts/$POST_ID/collections?collectionId=$COLLECTION_ID" \
-  | jq -e ".data.navigation.currentPosition == 1 and .data.navigation.next.id == $POST_ID_2" >/dev/null
+  | jq -e ".data.navigation.currentPosition == 1 and .data.navigation.total == 2 and .data.navigation.next.id == $POST_ID_2 and .data.navigation.next.title != null" >/dev/null
+
+curl -sS -X PUT "$BASE_URL/api/collections/$COLLECTION_ID/posts/$POST_ID_2" \
+  -H 'Content-Type: application/json' \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  -d '{"position":1}' \
+  | jq -e '.data.position == 1' >/dev/null
+
+curl -sS "$BASE_URL/api/collections/$COLLECTION_ID" \
+  | jq -e ".data.posts[0].id == $POST_ID_2 and .data.posts[1].id == $POST_ID and .data.posts[1].collectionPosition == 2" >/dev/null
+
+curl -sS "$BASE_URL/api/posts/$POST_ID/collections?collectionId=$COLLECTION_ID" \
+  | jq -e ".data.navigation.currentPosition == 2 and .data.navigation.prev.id == $POST_ID_2 and .data.navigation.next == null" >/dev/null
 
 echo "[8/17] Remove one post from collection and verify reorder"
 curl -sS -X DELETE "$BASE_URL/api/collections/$COLLECTION_ID/posts/$POST_ID" \
@@ -96,7 +116,7 @@ curl -sS -X DELETE "$BASE_URL/api/collections/$COLLECTION_ID/posts/$POST_ID" \
   | jq -e '.data.removed == true' >/dev/null
 
 curl -sS "$BASE_URL/api/collections/$COLLECTION_ID" \
-  | jq -e ".data.total == 1 and .data.posts[0].id == $POST_ID_2 and .data.posts[0].collectionPosition == 1" >/dev/null
+  | jq -e ".data.total == 1 and .data.collection.postCount == 1 and .data.posts[0].id == $POST_ID_2 and .data.posts[0].collectionPosition == 1" >/dev/null
 
 echo "[9/17] Search post"
 curl -sS "$BASE_URL/api/search?q=JWT&page=1&pageSize=10" \
@@ -118,6 +138,10 @@ curl -sS "$BASE_URL/api/me/favorites?page=1&pageSize=10" \
   -H "Authorization: Bearer $USER_TOKEN" \
   | jq -e ".data.total >= 1 and .data.items[0].id == $POST_ID" >/dev/null
 
+curl -sS "$BASE_URL/api/posts?page=1&pageSize=50&include=stats" \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  | jq -e "[.data.items[] | select(.id == $POST_ID)][0].stats | .likeCount == 1 and .likedByMe == true and .favoritedByMe == true" >/dev/null
+
 curl -sS -X PUT "$BASE_URL/api/posts/$POST_ID_2/favorite" \
   -H "Authorization: Bearer $USER_TOKEN" \
   | jq -e '.data.favoritedByMe == true and .data.favoriteCount == 1' >/dev/null
@@ -144,6 +168,46 @@ COMMENT_ID=$(echo "$COMMENT_RESP" | jq -r '.data.id')
 curl -sS "$BASE_URL/api/posts/$POST_ID/comments?page=1&pageSize=10" \
   | jq -e ".data.total >= 1 and .data.items[0].id == $COMMENT_ID" >/dev/null
 
+COMMENT_ID_2=$(curl -sS -X POST "$BASE_URL/api/posts/$POST_ID/comments" \
+  -H 'Content-Type: application/json' \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  -d '{"content":"第二条评论"}' | jq -r '.data.id')
+[ "$COMMENT_ID_2" != "null" ]
+
+# Keyset paging: the newest comment first, then the older one via nextCursor.
+FIRST_COMMENTS=$(curl -sS "$BASE_URL/api/posts/$POST_ID/comments?cursor=&pageSize=1")
+echo "$FIRST_COMMENTS" | jq -e ".data.items[0].id == $COMMENT_ID_2 and .data.nextCursor != null" >/dev/null
+NEXT_CURSOR=$(echo "$FIRST_COMMENTS" | jq -r '.data.nextCursor | @uri')
+curl -sS "$BASE_URL/api/posts/$POST_ID/comments?cursor=$NEXT_CURSOR&pageSize=1" \
+  | jq -e ".data.items[0].id == $COMMENT_ID" >/dev/null
+
+curl -sS -o /dev/null -w '%{http_code}' "$BASE_URL/api/posts/$POST_ID/comments?cursor=bogus" | grep -q '^400$'
+
+REPLY_ID=$(curl -sS -X POST "$BASE_URL/api/posts/$POST_ID/comments" \
+  -H 'Content-Type: application/json' \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  -d "{\"content\":\"回复第一条\",\"parentId\":$COMMENT_ID}" | jq -r '.data.id')
+[ "$REPLY_ID" != "null" ]
+
+# Thread order is depth-first: the first comment, its reply, then the second.
+curl -sS "$BASE_URL/api/posts/$POST_ID/comments/thread?pageSize=10" \
+  | jq -e "[.data.items[].id] == [$COMMENT_ID, $REPLY_ID, $COMMENT_ID_2] and .data.items[0].replyCount == 1 and .data.items[1].depth == 1" >/dev/null
+
+curl -sS "$BASE_URL/api/comments/$COMMENT_ID/replies" \
+  | jq -e ".data.total == 1 and .data.items[0].id == $REPLY_ID and .data.items[0].parentId == $COMMENT_ID" >/dev/null
+
+curl -sS -X DELETE "$BASE_URL/api/comments/$REPLY_ID" \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  | jq -e '.data.deleted == true' >/dev/null
+
+curl -sS -X DELETE "$BASE_URL/api/comments/$COMMENT_ID_2" \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  | jq -e '.data.deleted == true' >/dev/null
+
+# The cached first page is dropped when a comment is deleted.
+curl -sS "$BASE_URL/api/posts/$POST_ID/comments?cursor=&pageSize=1" \
+  | jq -e ".data.items[0].id == $COMMENT_ID" >/dev/null
+
 curl -sS -X DELETE "$BASE_URL/api/comments/$COMMENT_ID" \
   -H "Authorization: Bearer $USER_TOKEN" \
   | jq -e '.data.deleted == true' >/dev/null
@@ -169,7 +233,8 @@ USER_TOKEN=$(echo "$REFRESH_RESP" | jq -r '.data.accessToken')
 
 [ "$USER_TOKEN" != "null" ]
 
-echo "[12/17] Change password and verify old password invalid"
+echo "[12/17] Change password and verify old password and access token invalid"
+PRE_CHANGE_TOKEN="$USER_TOKEN"
 CHANGE_RESP=$(curl -sS -b "$COOKIE_FILE" -c "$COOKIE_FILE" -X POST "$BASE_URL/api/auth/change-password" \
   -H 'Content-Type: application/json' \
   -H "Authorization: Bearer $USER_TOKEN" \
@@ -182,6 +247,15 @@ OLD_LOGIN_STATUS=$(curl -sS -o /tmp/old_password_login.json -w '%{http_code}' -X
   -d "{\"username\":\"$USER_NAME\",\"password\":\"$USER_PASS\"}")
 [ "$OLD_LOGIN_STATUS" = "401" ]
 
+REVOKED_STATUS=$(curl -sS -o /tmp/revoked_token.json -w '%{http_code}' "$BASE_URL/api/me/posts" \
+  -H "Authorization: Bearer $PRE_CHANGE_TOKEN")
+[ "$REVOKED_STATUS" = "401" ]
+jq -e '.code == "AUTH_INVALID_TOKEN"' /tmp/revoked_token.json >/dev/null
+
+# The token issued by the change itself carries the bumped version.
+curl -sS "$BASE_URL/api/me/posts" -H "Authorization: Bearer $USER_TOKEN" \
+  | jq -e '.data.items != null' >/dev/null
+
 echo "[13/17] Login with new password"
 NEW_LOGIN_RESP=$(curl -sS -c "$COOKIE_FILE" -X POST "$BASE_URL/api/auth/login" \
   -H 'Content-Type: application/json' \
@@ -215,6 +289,11 @@ curl -sS -X PUT "$BASE_URL/api/admin/users/$USER_ID/ban" \
   -d '{"isBanned":true}' \
   | jq -e '.data.isBanned == true' >/dev/null
 
+BANNED_STATUS=$(curl -sS -o /tmp/banned_token.json -w '%{http_code}' "$BASE_URL/api/me/posts" \
+  -H "Authorization: Bearer $USER_TOKEN")
+[ "$BANNED_STATUS" = "403" ]
+jq -e '.code == "USER_BANNED"' /tmp/banned_token.json >/dev/null
+
 curl -sS -X PUT "$BASE_URL/api/admin/users/$USER_ID/ban" \
   -H 'Content-Type: application/json' \
   -H "Authorization: Bearer $ADMIN_TOKEN" \
@@ -229,6 +308,15 @@ curl -sS -X DELETE "$BASE_URL/api/posts/$POST_ID_2" \
   -H "Authorization: Bearer $ADMIN_TOKEN" \
   | jq -e '.data.deleted == true' >/dev/null
 
+curl -sS "$BASE_URL/api/collections/$COLLECTION_ID" \
+  | jq -e '.data.collection.postCount == 0 and .data.total == 0' >/dev/null
+
+METRICS=$(curl -sS "$BASE_URL/api/admin/metrics" -H "Authorization: Bearer $ADMIN_TOKEN")
+echo "$METRICS" | grep -q 'blog_http_request_duration_seconds_count{route="/api/posts/{1}",method="PUT",status="2xx"}'
+echo "$METRICS" | grep -q 'blog_cache_lookups_total{cache="comment_pages",result="miss"}'
+echo "$METRICS" | grep -q '^blog_http_requests_in_flight '
+echo "$METRICS" | grep -q 'blog_access_log_records_total{outcome="written"}'
+
 echo "[17/17] Completed all checks"
 
 echo "Smoke test completed successfully."
@@ -0,0 +1,98 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+BASE_URL="${BASE_URL:-http://localhost:8080}"
+POST_COUNT="${POST_COUNT:-50}"
+USER_NAME="batch_$RANDOM"
+USER_PASS="BatchPass123!"
+WORK_DIR="$(mktemp -d)"
+
+cleanup() {
+  rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+if ! command -v jq >/dev/null 2>&1; then
+  echo "jq is required for this test script"
+  exit 1
+fi
+
+# Prints the summed curl time_total of a timings file in milliseconds.
+total_ms() {
+  awk '{ s += $1 } END { printf "%.1f", s * 1000 }' "$1"
+}
+
+echo "[1/5] Register user and create $POST_COUNT posts"
+USER_TOKEN=$(curl -sS -X POST "$BASE_URL/api/auth/register" \
+  -H 'Content-Type: application/json' \
+  -d "{\"username\":\"$USER_NAME\",\"password\":\"$USER_PASS\"}" \
+  | jq -r '.data.accessToken')
+[ "$USER_TOKEN" != "null" ]
+
+POST_IDS=()
+for i in $(seq 1 "$POST_COUNT"); do
+  POST_IDS+=("$(curl -sS -X POST "$BASE_URL/api/posts" \
+    -H 'Content-Type: application/json' \
+    -H "Authorization: Bearer $USER_TOKEN" \
+    -d "{\"title\":\"Batch $i\",\"contentMarkdown\":\"batch post $i\"}" \
+    | jq -r '.data.id')")
+done
+ID_ARRAY=$(printf '%s\n' "${POST_IDS[@]}" | jq -s -c '.')
+REVERSED_ARRAY=$(echo "$ID_ARRAY" | jq -c 'reverse')
+
+create_collection() {
+  curl -sS -X POST "$BASE_URL/api/collections" \
+    -H 'Content-Type: application/json' \
+    -H "Authorization: Bearer $USER_TOKEN" \
+    -d "{\"name\":\"$1 $RANDOM\",\"description\":\"batch timing\"}" \
+    | jq -r '.data.id'
+}
+SINGLE_ID=$(create_collection "Per-item")
+BATCH_ID=$(create_collection "Batch")
+
+echo "[2/5] Add posts one request at a time"
+: > "$WORK_DIR/single_add"
+for post_id in "${POST_IDS[@]}"; do
+  curl -sS -o /dev/null -w '%{time_total}\n' -X POST "$BASE_URL/api/collections/$SINGLE_ID/posts" \
+    -H 'Content-Type: application/json' \
+    -H "Authorization: Bearer $USER_TOKEN" \
+    -d "{\"postId\":$post_id}" >> "$WORK_DIR/single_add"
+done
+
+echo "[3/5] Add posts in one batch request"
+curl -sS -o "$WORK_DIR/batch_resp" -w '%{time_total}\n' -X POST "$BASE_URL/api/collections/$BATCH_ID/posts:batch" \
+  -H 'Content-Type: application/json' \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  -d "{\"postIds\":$ID_ARRAY}" > "$WORK_DIR/batch_add"
+jq -e ".data.added == $POST_COUNT" "$WORK_DIR/batch_resp" >/dev/null
+
+curl -sS "$BASE_URL/api/collections/$SINGLE_ID" | jq -c '[.data.posts[].id]' > "$WORK_DIR/single_order"
+curl -sS "$BASE_URL/api/collections/$BATCH_ID" | jq -c '[.data.posts[].id]' > "$WORK_DIR/batch_order"
+[ "$(cat "$WORK_DIR/single_order")" = "$ID_ARRAY" ]
+[ "$(cat "$WORK_DIR/batch_order")" = "$ID_ARRAY" ]
+
+echo "[4/5] Reverse both collections: per-item moves vs one order request"
+: > "$WORK_DIR/single_move"
+position=1
+for post_id in $(echo "$REVERSED_ARRAY" | jq -r '.[]'); do
+  curl -sS -o /dev/null -w '%{time_total}\n' -X PUT "$BASE_URL/api/collections/$SINGLE_ID/posts/$post_id" \
+    -H 'Content-Type: application/json' \
+    -H "Authorization: Bearer $USER_TOKEN" \
+    -d "{\"position\":$position}" >> "$WORK_DIR/single_move"
+  position=$((position + 1))
+done
+
+curl -sS -o "$WORK_DIR/order_resp" -w '%{time_total}\n' -X PUT "$BASE_URL/api/collections/$BATCH_ID/order" \
+  -H 'Content-Type: application/json' \
+  -H "Authorization: Bearer $USER_TOKEN" \
+  -d "{\"postIds\":$REVERSED_ARRAY}" > "$WORK_DIR/batch_move"
+jq -e ".data.reordered == $POST_COUNT" "$WORK_DIR/order_resp" >/dev/null
+
+[ "$(curl -sS "$BASE_URL/api/collections/$SINGLE_ID" | jq -c '[.data.posts[].id]')" = "$REVERSED_ARRAY" ]
+[ "$(curl -sS "$BASE_URL/api/collections/$BATCH_ID" | jq -c '[.data.posts[].id]')" = "$REVERSED_ARRAY" ]
+
+echo "[5/5] Timing summary ($POST_COUNT posts)"
+echo "add:     per-item=$(total_ms "$WORK_DIR/single_add")ms batch=$(total_ms "$WORK_DIR/batch_add")ms"
+echo "reorder: per-item=$(total_ms "$WORK_DIR/single_move")ms batch=$(total_ms "$WORK_DIR/batch_move")ms"
+
+echo "Collection batch test completed successfully."
@@ -0,0 +1,66 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+BASE_URL="${BASE_URL:-http://localhost:8080}"
+ROUNDS="${ROUNDS:-20}"
+CONCURRENCY="${CONCURRENCY:-16}"
+USER_NAME="race_$RANDOM"
+USER_PASS="RacePass123!"
+WORK_DIR="$(mktemp -d)"
+
+cleanup() {
+  rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+if ! command -v jq >/dev/null 2>&1; then
+  echo "jq is required for this test script"
+  exit 1
+fi
+
+echo "[1/3] Register user: $USER_NAME"
+curl -sS -c "$WORK_DIR/cookies" -X POST "$BASE_URL/api/auth/register" \
+  -H 'Content-Type: application/json' \
+  -d "{\"username\":\"$USER_NAME\",\"password\":\"$USER_PASS\"}" \
+  | jq -e '.data.accessToken != null' >/dev/null
+
+echo "[2/3] Fire $CONCURRENCY concurrent refreshes with the same token, $ROUNDS rounds"
+: > "$WORK_DIR/latencies"
+for round in $(seq 1 "$ROUNDS"); do
+  for i in $(seq 1 "$CONCURRENCY"); do
+    curl -sS -o /dev/null -b "$WORK_DIR/cookies" -c "$WORK_DIR/jar.$i" \
+      -w '%{http_code} %{time_total}\n' -X POST "$BASE_URL/api/auth/refresh" > "$WORK_DIR/result.$i" &
+  done
+  wait
+
+  winners=0
+  winner_jar=""
+  for i in $(seq 1 "$CONCURRENCY"); do
+    read -r status latency < "$WORK_DIR/result.$i"
+    echo "$latency" >> "$WORK_DIR/latencies"
+    if [ "$status" = "200" ]; then
+      winners=$((winners + 1))
+      winner_jar="$WORK_DIR/jar.$i"
+    elif [ "$status" != "401" ]; then
+      echo "round $round: unexpected status $status"
+      exit 1
+    fi
+  done
+
+  if [ "$winners" -ne 1 ]; then
+    echo "round $round: expected exactly one winner, got $winners"
+    exit 1
+  fi
+  cp "$winner_jar" "$WORK_DIR/cookies"
+done
+
+echo "[3/3] Latency summary"
+sort -n "$WORK_DIR/latencies" | awk '
+  { v[NR] = $1 }
+  END {
+    p50 = v[int(NR * 0.50 + 0.5) > 0 ? int(NR * 0.50 + 0.5) : 1]
+    p99 = v[int(NR * 0.99 + 0.5) > 0 ? int(NR * 0.99 + 0.5) : 1]
+    printf "requests=%d p50=%.1fms p99=%.1fms max=%.1fms\n", NR, p50 * 1000, p99 * 1000, v[NR] * 1000
+  }'
+
+echo "Refresh race test completed successfully."
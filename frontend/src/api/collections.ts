@@ -28,6 +28,26 @@ export function addPostToCollection(collectionId: number, postId: number): Promi
   });
 }
 
+export function addPostsToCollection(
+  collectionId: number,
+  postIds: number[]
+): Promise<{ collectionId: number; added: number }> {
+  return apiRequest<{ collectionId: number; added: number }>(`/api/collections/${collectionId}/posts:batch`, {
+    method: "POST",
+    body: JSON.stringify({ postIds })
+  });
+}
+
+export function reorderCollection(
+  collectionId: number,
+  postIds: number[]
+): Promise<{ collectionId: number; reordered: number }> {
+  return apiRequest<{ collectionId: number; reordered: number }>(`/api/collections/${collectionId}/order`, {
+    method: "PUT",
+    body: JSON.stringify({ postIds })
+  });
+}
+
 export function removePostFromCollection(
   collectionId: number,
   postId: number
@@ -40,6 +60,20 @@ export function removePostFromCollection(
   );
 }
 
+export function moveCollectionPost(
+  collectionId: number,
+  postId: number,
+  position: number
+): Promise<{ collectionId: number; postId: number; position: number }> {
+  return apiRequest<{ collectionId: number; postId: number; position: number }>(
+    `/api/collections/${collectionId}/posts/${postId}`,
+    {
+      method: "PUT",
+      body: JSON.stringify({ position })
+    }
+  );
+}
+
 export function getPostCollections(postId: number, collectionId?: number): Promise<PostCollectionsData> {
   const suffix = collectionId ? `?collectionId=${collectionId}` : "";
   return apiRequest<PostCollectionsData>(`/api/posts/${postId}/collections${suffix}`, {
@@ -1,5 +1,5 @@
 import { apiRequest } from "./client";
-import type { CommentItem, InteractionSummary, PagedComments } from "../types/interaction";
+import type { CommentItem, CommentThreadPage, InteractionSummary, PagedComments } from "../types/interaction";
 import type { PagedPosts } from "../types/post";
 
 export function getPostInteractions(postId: number): Promise<InteractionSummary> {
@@ -63,10 +63,26 @@ export function listComments(postId: number, page = 1, pageSize = 10): Promise<P
   });
 }
 
-export function createComment(postId: number, content: string): Promise<CommentItem> {
+export function listCommentThread(postId: number, cursor = "", pageSize = 20): Promise<CommentThreadPage> {
+  const params = new URLSearchParams({ cursor, pageSize: String(pageSize) });
+  return apiRequest<CommentThreadPage>(`/api/posts/${postId}/comments/thread?${params.toString()}`, {
+    method: "GET",
+    skipAuth: true
+  });
+}
+
+export function listCommentReplies(commentId: number, cursor = "", pageSize = 20): Promise<CommentThreadPage> {
+  const params = new URLSearchParams({ cursor, pageSize: String(pageSize) });
+  return apiRequest<CommentThreadPage>(`/api/comments/${commentId}/replies?${params.toString()}`, {
+    method: "GET",
+    skipAuth: true
+  });
+}
+
+export function createComment(postId: number, content: string, parentId?: number): Promise<CommentItem> {
   return apiRequest<CommentItem>(`/api/posts/${postId}/comments`, {
     method: "POST",
-    body: JSON.stringify({ content })
+    body: JSON.stringify(parentId ? { content, parentId } : { content })
   });
 }
 
@@ -0,0 +1,45 @@
+import type { LiveInteractionCounts } from "../types/interaction";
+import type { PostStreamEvent } from "../types/post";
+
+interface CountsFrame {
+  type: "counts";
+  posts: LiveInteractionCounts[];
+}
+
+// Follows live interaction counts for `postIds` over /ws/interactions and
+// returns a function that closes the connection.
+export function subscribeInteractionCounts(
+  postIds: number[],
+  onCounts: (counts: LiveInteractionCounts) => void
+): () => void {
+  const protocol = window.location.protocol === "https:" ? "wss:" : "ws:";
+  const socket = new WebSocket(`${protocol}//${window.location.host}/ws/interactions`);
+
+  socket.addEventListener("open", () => {
+    socket.send(JSON.stringify({ type: "subscribe", postIds }));
+  });
+  socket.addEventListener("message", (event) => {
+    const frame = JSON.parse(String(event.data)) as CountsFrame | { type: string };
+    if (frame.type === "counts") {
+      (frame as CountsFrame).posts.forEach(onCounts);
+    }
+  });
+
+  return () => socket.close();
+}
+
+// Follows /api/posts/stream; EventSource reconnects on its own. Returns a
+// function that closes the stream.
+export function subscribePostStream(
+  onEvent: (event: PostStreamEvent) => void,
+  onOverflow: () => void
+): () => void {
+  const source = new EventSource("/api/posts/stream");
+  (["post.created", "post.updated", "post.deleted"] as const).forEach((type) => {
+    source.addEventListener(type, (event) => {
+      onEvent({ type, ...(JSON.parse((event as MessageEvent).data) as Omit<PostStreamEvent, "type">) });
+    });
+  });
+  source.addEventListener("overflow", onOverflow);
+  return () => source.close();
+}
@@ -7,7 +7,7 @@ interface PostPayload {
 }
 
 export function listPosts(page = 1, pageSize = 10): Promise<PagedPosts> {
-  return apiRequest<PagedPosts>(`/api/posts?page=${page}&pageSize=${pageSize}`, {
+  return apiRequest<PagedPosts>(`/api/posts?page=${page}&pageSize=${pageSize}&include=stats`, {
     method: "GET",
     skipAuth: true
   });
@@ -4,7 +4,7 @@ import { apiRequest } from "./client";
 export function searchPosts(q: string, page = 1, pageSize = 10): Promise<PagedPosts & { q: string }> {
   const query = encodeURIComponent(q);
   return apiRequest<PagedPosts & { q: string }>(
-    `/api/search?q=${query}&page=${page}&pageSize=${pageSize}`,
+    `/api/search?q=${query}&page=${page}&pageSize=${pageSize}&include=stats`,
     {
       method: "GET",
       skipAuth: true
@@ -29,6 +29,11 @@ export function PostCard({ post }: PostCardProps) {
         <time className="meta-pill" dateTime={post.createdAt} title={formatAbsoluteDateTime(post.createdAt)}>
           发布时间：{formatAbsoluteDateTime(post.createdAt)}
         </time>
+        {post.stats ? (
+          <span className="meta-pill">
+            赞 {post.stats.likeCount} · 收藏 {post.stats.favoriteCount} · 评论 {post.stats.commentCount}
+          </span>
+        ) : null}
       </div>
     </article>
   );
@@ -1,6 +1,7 @@
 import { useEffect, useMemo, useState } from "react";
 import { ChevronLeft, ChevronRight, Clock, Lock, PenLine, Search } from "lucide-react";
 import { Link, useNavigate } from "react-router-dom";
+import { subscribePostStream } from "../api/live";
 import { listPosts } from "../api/posts";
 import { useAuthState } from "../store/authStore";
 import type { Post } from "../types/post";
@@ -29,6 +30,29 @@ export function HomePage() {
   const [total, setTotal] = useState(0);
   const [loading, setLoading] = useState(false);
   const [error, setError] = useState("");
+  const [newPostCount, setNewPostCount] = useState(0);
+  const [reloadKey, setReloadKey] = useState(0);
+
+  useEffect(() => {
+    return subscribePostStream(
+      (event) => {
+        if (event.type === "post.created") {
+          setNewPostCount((prev) => prev + 1);
+        } else if (event.type === "post.updated") {
+          setItems((prev) => prev.map((post) => (post.id === event.id ? { ...post, title: event.title ?? post.title } : post)));
+        } else {
+          setItems((prev) => prev.filter((post) => post.id !== event.id));
+        }
+      },
+      () => setNewPostCount((prev) => Math.max(prev, 1))
+    );
+  }, []);
+
+  const showNewPosts = () => {
+    setNewPostCount(0);
+    setPage(1);
+    setReloadKey((prev) => prev + 1);
+  };
 
   useEffect(() => {
     const run = async () => {
@@ -46,7 +70,7 @@ export function HomePage() {
     };
 
     void run();
-  }, [page, pageSize]);
+  }, [page, pageSize, reloadKey]);
 
   const totalPages = useMemo(() => Math.max(1, Math.ceil(total / pageSize)), [total, pageSize]);
 
@@ -93,6 +117,12 @@ export function HomePage() {
             <span className="text-sm text-muted-foreground">共 {total} 篇</span>
           </div>
 
+          {newPostCount > 0 ? (
+            <Button variant="outline" className="w-full mb-4" onClick={showNewPosts}>
+              有 {newPostCount} 篇新文章，点击查看
+            </Button>
+          ) : null}
+
           {loading ? <p className="text-sm text-muted-foreground">加载中...</p> : null}
           {error ? <p className="text-sm text-destructive">{error}</p> : null}
 
@@ -28,6 +28,7 @@ import {
   unlikePost
 } from "../api/interactions";
 import { addPostToCollection, getPostCollections, listMyCollections } from "../api/collections";
+import { subscribeInteractionCounts } from "../api/live";
 import { deletePost, getPost } from "../api/posts";
 import { useAuthState } from "../store/authStore";
 import type { Collection, CollectionNavigation, PostCollectionMembership } from "../types/collection";
@@ -187,6 +188,23 @@ export function PostDetailPage() {
     void loadComments(post.id, commentPage);
   }, [post, commentPage]);
 
+  useEffect(() => {
+    if (!post) return;
+    return subscribeInteractionCounts([post.id], (counts) => {
+      setInteractionSummary((prev) =>
+        prev
+          ? {
+              ...prev,
+              likeCount: counts.likeCount,
+              favoriteCount: counts.favoriteCount,
+              commentCount: counts.commentCount,
+              viewCount: counts.viewCount
+            }
+          : prev
+      );
+    });
+  }, [post?.id]);
+
   useEffect(() => {
     if (!auth.user) {
       setMyCollections([]);
@@ -374,6 +392,7 @@ export function PostDetailPage() {
                   <Clock className="w-3.5 h-3.5" />
                   更新于 {formatAbsoluteDateTime(post.updatedAt)}
                 </span>
+                {post.viewCount !== undefined ? <span>阅读 {post.viewCount}</span> : null}
               </div>
             </div>
           </div>
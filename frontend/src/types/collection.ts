@@ -23,11 +23,17 @@ export interface PostCollectionMembership {
   position: number;
 }
 
+export interface CollectionNeighbor {
+  id: number;
+  title: string;
+}
+
 export interface CollectionNavigation {
   collectionId: number;
   currentPosition: number;
-  prev: Post | null;
-  next: Post | null;
+  total: number;
+  prev: CollectionNeighbor | null;
+  next: CollectionNeighbor | null;
 }
 
 export interface PostCollectionsData {
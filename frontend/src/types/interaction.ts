@@ -2,8 +2,25 @@ export interface InteractionSummary {
   likeCount: number;
   favoriteCount: number;
   commentCount: number;
+  viewCount?: number;
   likedByMe: boolean;
   favoritedByMe: boolean;
+  persistence?: InteractionPersistence;
+}
+
+export interface LiveInteractionCounts {
+  postId: number;
+  likeCount: number;
+  favoriteCount: number;
+  commentCount: number;
+  viewCount: number;
+  newComments?: number;
+}
+
+export interface InteractionPersistence {
+  mode: "sync" | "write_behind";
+  durable: boolean;
+  flushWithinMs?: number;
 }
 
 export interface CommentItem {
@@ -15,6 +32,9 @@ export interface CommentItem {
   createdAt: string;
   updatedAt: string;
   isDeleted: boolean;
+  parentId?: number | null;
+  depth?: number;
+  replyCount?: number;
 }
 
 export interface PagedComments {
@@ -23,3 +43,10 @@ export interface PagedComments {
   pageSize: number;
   total: number;
 }
+
+export interface CommentThreadPage {
+  items: CommentItem[];
+  pageSize: number;
+  total: number;
+  nextCursor: string | null;
+}
@@ -1,3 +1,5 @@
+import type { InteractionSummary } from "./interaction";
+
 export interface Post {
   id: number;
   title: string;
@@ -9,6 +11,8 @@ export interface Post {
   favoritedAt?: string;
   isDeleted: boolean;
   collectionPosition?: number;
+  viewCount?: number;
+  stats?: InteractionSummary;
 }
 
 export interface PagedPosts {
@@ -19,3 +23,12 @@ export interface PagedPosts {
   q?: string;
   order?: "asc" | "desc";
 }
+
+export interface PostStreamEvent {
+  type: "post.created" | "post.updated" | "post.deleted";
+  id: number;
+  title?: string;
+  authorId?: number;
+  authorUsername?: string;
+  createdAt?: string;
+}
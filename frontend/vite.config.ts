@@ -17,6 +17,10 @@ export default defineConfig({
         target: "http://localhost:8080",
         changeOrigin: true,
         secure: false
+      },
+      "/ws": {
+        target: "ws://localhost:8080",
+        ws: true
       }
     }
   }